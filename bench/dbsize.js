@@ -4,6 +4,14 @@ const { FullNode } = require("hsd");
 const fs = require("fs");
 var path = require("path");
 
+// Pass --bulk-load to catch up with the bulk load profile,
+// and compare the time and size against a run without it.
+const bulkLoad = process.argv.includes("--bulk-load");
+
+// Pass --backend=lmdb to index into the LMDB backend.
+const backendArg = process.argv.find(arg => arg.startsWith("--backend="));
+const backend = backendArg ? backendArg.split("=")[1] : "leveldb";
+
 const node = new FullNode({
   network: "testnet",
   apiKey: "api-key",
@@ -15,9 +23,13 @@ const node = new FullNode({
   listen: true,
   indexTx: true,
   indexAddress: true,
+  nomenclateBulkLoad: bulkLoad,
+  nomenclateBackend: backend,
   plugins: [require("../lib/index.js")]
 });
 
+const start = Date.now();
+
 let directory = ".hsd/benchmark/testnet/nomenclate";
 
 (async () => {
@@ -60,13 +72,18 @@ async function waitForChainSynced(node) {
 function checkNomenclateDBSize(node) {
   let total = 0;
   fs.readdirSync(directory).forEach(file => {
-    if (path.extname(file) === ".ldb") {
+    if (path.extname(file) === ".ldb" || path.extname(file) === ".mdb") {
       console.log(file);
       total += getFilesizeInMB(file);
     }
   });
 
-  console.log("Level DB Size: %d MB", total);
+  console.log("Database Size (%s): %d MB", backend, total);
+  console.log(
+    "Synced in %d seconds (bulk load: %s)",
+    (Date.now() - start) / 1000,
+    bulkLoad
+  );
 }
 
 function getFilesizeInMB(filename) {
@@ -0,0 +1,137 @@
+"use strict";
+
+// Compare the compiled JSON serializers against `res.json`.
+//
+//   node bench/serializer.js --rows=1000 --runs=2000
+//
+// Serializes address history and unspent pages of `rows` rows
+// and verbose transactions, both as the routes used to (build
+// the object, then `JSON.stringify` as `res.json` does) and with
+// the compiled serializers, checking both give the same JSON.
+
+const assert = require("bsert");
+const random = require("bcrypto/lib/random");
+const { TX, Input, Output, Outpoint, Address } = require("hsd");
+const HTTP = require("../lib/http");
+const { JSONWriter } = require("../lib/serializer");
+
+const args = parseArgs(process.argv.slice(2));
+
+const rows = parseInt(args.rows || "1000", 10);
+const runs = parseInt(args.runs || "2000", 10);
+const inputs = parseInt(args.inputs || "2", 10);
+const outputs = parseInt(args.outputs || "2", 10);
+
+const { serializers } = HTTP;
+const writer = new JSONWriter();
+
+// What `txToJSON` needs of the server.
+const server = {
+  client: { getTip: () => ({ height: 100000 }) },
+  addrToJSON: HTTP.prototype.addrToJSON
+};
+
+const history = { total: rows, offset: 0, limit: rows, pruned_height: 0 };
+const unspent = { total: rows, offset: 0, limit: rows };
+
+history.result = [];
+unspent.result = [];
+
+for (let i = 0; i < rows; i++) {
+  const tx_hash = random.randomBytes(32).toString("hex");
+  const height = 50000 + i;
+
+  history.result.push({ tx_hash, height });
+  unspent.result.push({ tx_hash, height, tx_pos: i % 4, value: i * 1000 });
+}
+
+const tx = new TX();
+
+for (let i = 0; i < inputs; i++) {
+  const input = Input.fromOutpoint(new Outpoint(random.randomBytes(32), i));
+  input.witness.items.push(random.randomBytes(65), random.randomBytes(33));
+  tx.inputs.push(input);
+}
+
+for (let i = 0; i < outputs; i++) {
+  const address = Address.fromHash(random.randomBytes(20), 0);
+  tx.outputs.push(new Output({ value: 1000000 * (i + 1), address }));
+}
+
+const ctx = {
+  entry: null,
+  height: 100000,
+  time: 1550000000,
+  coinbase: tx.isCoinbase(),
+  hex: true
+};
+
+compare("history", runs, () => stringify(history), () =>
+  serialize(serializers.history, history)
+);
+
+compare("unspent", runs, () => stringify(unspent), () =>
+  serialize(serializers.unspent, unspent)
+);
+
+compare(
+  "tx",
+  runs * 100,
+  () => {
+    const json = HTTP.prototype.txToJSON.call(server, tx, ctx.entry);
+    json.time = ctx.time;
+    json.hex = tx.toHex();
+    return stringify(json);
+  },
+  () => serialize(serializers.tx, tx, ctx)
+);
+
+function stringify(json) {
+  return Buffer.from(JSON.stringify(json, null, 2) + "\n", "utf8");
+}
+
+function serialize(fn, value, ctx) {
+  writer.reset();
+  fn(writer, value, ctx);
+  writer.raw("\n");
+  return writer.render();
+}
+
+function compare(name, ops, before, after) {
+  assert.deepStrictEqual(
+    JSON.parse(after().toString("utf8")),
+    JSON.parse(before().toString("utf8"))
+  );
+
+  const a = time(ops, before);
+  const b = time(ops, after);
+
+  console.log(
+    "%s: res.json %d ops/s, compiled %d ops/s (%sx)",
+    name,
+    Math.round(a),
+    Math.round(b),
+    (b / a).toFixed(2)
+  );
+}
+
+function time(ops, fn) {
+  const start = process.hrtime();
+
+  for (let i = 0; i < ops; i++) fn();
+
+  const [sec, ns] = process.hrtime(start);
+
+  return ops / (sec + ns / 1e9);
+}
+
+function parseArgs(argv) {
+  const args = {};
+
+  for (const arg of argv) {
+    const [key, value] = arg.replace(/^--/, "").split("=");
+    args[key] = value != null ? value : true;
+  }
+
+  return args;
+}
@@ -0,0 +1,147 @@
+"use strict";
+
+// Compare storage backends on the index's write and read paths.
+//
+//   node bench/storage.js --backend=lmdb --rows=1000000
+//
+// Writes `rows` funding rows spread over a pool of addresses (plus
+// a txid row for each), then times random txid lookups and full
+// address history scans.
+
+const path = require("path");
+const os = require("os");
+const fs = require("bfile");
+const random = require("bcrypto/lib/random");
+const backend = require("../lib/backend");
+const layout = require("../lib/layout");
+const util = require("../lib/util");
+
+const args = parseArgs(process.argv.slice(2));
+
+const type = args.backend || "leveldb";
+const rows = parseInt(args.rows || "1000000", 10);
+const addrs = parseInt(args.addresses || "10000", 10);
+const batchSize = parseInt(args.batch || "10000", 10);
+const lookups = parseInt(args.lookups || "100000", 10);
+const scans = parseInt(args.scans || "1000", 10);
+const location =
+  args.location || path.join(os.tmpdir(), `nomenclate-bench-${type}`);
+
+(async () => {
+  await fs.remove(location);
+
+  const db = backend.create({
+    backend: type,
+    location,
+    memory: false,
+    cacheSize: 16 << 20,
+    compression: true
+  });
+
+  await db.open();
+
+  console.log("Backend: %s (%s)", type, location);
+
+  const pool = [];
+  const txids = [];
+
+  for (let i = 0; i < addrs; i++) pool.push(random.randomBytes(32));
+
+  // Writes
+  let start = process.hrtime();
+
+  for (let i = 0; i < rows; i += batchSize) {
+    const b = db.batch();
+
+    for (let j = i; j < Math.min(i + batchSize, rows); j++) {
+      const txid = random.randomBytes(32);
+      const height = Math.floor(j / 100);
+      const value = util.fromU32(height);
+
+      b.put(layout.o.encode(pool[j % addrs], height, j % 100, txid), value);
+      b.put(layout.t.encode(txid), value);
+
+      if (j % Math.ceil(rows / lookups) === 0) txids.push(txid);
+    }
+
+    await b.write();
+  }
+
+  report("write", rows * 2, start);
+
+  // Point lookups
+  start = process.hrtime();
+
+  for (let i = 0; i < lookups; i++) {
+    const txid = txids[i % txids.length];
+    const raw = await db.get(layout.t.encode(txid));
+    if (!raw) throw new Error("Missing row.");
+  }
+
+  report("get", lookups, start);
+
+  // History scans
+  start = process.hrtime();
+
+  let scanned = 0;
+
+  for (let i = 0; i < scans; i++) {
+    const hash = pool[i % addrs];
+    const iter = db.iterator({
+      gte: layout.o.min(hash),
+      lte: layout.o.max(hash),
+      values: true
+    });
+
+    await iter.each(() => {
+      scanned += 1;
+    });
+  }
+
+  report("scan", scans, start);
+  console.log("  %d rows per scan", Math.round(scanned / scans));
+
+  await db.close();
+
+  console.log("Size on disk: %d MB", Math.round((await dirSize(location)) / 1e6));
+
+  if (!args.keep) await fs.remove(location);
+})().catch(err => {
+  console.error(err.stack);
+  process.exit(1);
+});
+
+function report(name, ops, start) {
+  const [sec, ns] = process.hrtime(start);
+  const ms = sec * 1000 + ns / 1e6;
+
+  console.log(
+    "%s: %d ops in %d ms (%d ops/s)",
+    name,
+    ops,
+    Math.round(ms),
+    Math.round((ops / ms) * 1000)
+  );
+}
+
+async function dirSize(dir) {
+  let total = 0;
+
+  for (const name of await fs.readdir(dir)) {
+    const stat = await fs.stat(path.join(dir, name));
+    total += stat.size;
+  }
+
+  return total;
+}
+
+function parseArgs(argv) {
+  const args = {};
+
+  for (const arg of argv) {
+    const [key, value] = arg.replace(/^--/, "").split("=");
+    args[key] = value != null ? value : true;
+  }
+
+  return args;
+}
@@ -0,0 +1,202 @@
+/*!
+ * addressfilter.js - address existence filter for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const fs = require("bfile");
+const bio = require("bufio");
+const murmur3 = require("bcrypto/lib/murmur3");
+const random = require("bcrypto/lib/random");
+const blake2b = require("bcrypto/lib/blake2b");
+
+/*
+ * Constants
+ */
+
+const MAGIC = 0x6e6d6166;
+const VERSION = 0;
+const HEADER_SIZE = 29;
+
+// Every key sets K bits inside a single 512 bit block,
+// so a lookup touches one cache line.
+const BLOCK_SIZE = 64;
+const BLOCK_BITS = BLOCK_SIZE * 8;
+const K = 8;
+
+/**
+ * Address Filter
+ * A blocked Bloom filter over every address hash ever indexed,
+ * so lookups for addresses which have never been seen can be
+ * answered without touching the database. It never gives false
+ * negatives once `ready`, and is keyed with a random tweak so
+ * false positives cannot be targeted.
+ * @alias module:nomenclate.AddressFilter
+ */
+
+class AddressFilter {
+  /**
+   * Create an address filter.
+   * @constructor
+   * @param {Number} size - Size in bytes.
+   */
+
+  constructor(size) {
+    assert(Number.isSafeInteger(size) && size >= BLOCK_SIZE);
+
+    this.blocks = Math.floor(size / BLOCK_SIZE);
+    this.data = Buffer.alloc(this.blocks * BLOCK_SIZE);
+    this.tweak = random.randomInt();
+    this.count = 0;
+
+    // Whether every indexed address has been added.
+    this.ready = false;
+  }
+
+  /**
+   * Add an address hash.
+   * @param {Buffer} hash
+   */
+
+  add(hash) {
+    const h1 = murmur3.sum(hash, this.tweak);
+    const h2 = murmur3.sum(hash, this.tweak ^ 0x5bd1e995);
+    const base = (h1 % this.blocks) * BLOCK_SIZE;
+
+    let added = false;
+
+    for (let i = 0; i < K; i++) {
+      const bit = ((h2 + i * ((h2 >>> 16) | 1)) >>> 0) % BLOCK_BITS;
+      const pos = base + (bit >>> 3);
+      const mask = 1 << (bit & 7);
+
+      if (!(this.data[pos] & mask)) {
+        this.data[pos] |= mask;
+        added = true;
+      }
+    }
+
+    if (added) this.count += 1;
+  }
+
+  /**
+   * Test whether an address hash may have been added.
+   * @param {Buffer} hash
+   * @returns {Boolean}
+   */
+
+  has(hash) {
+    const h1 = murmur3.sum(hash, this.tweak);
+    const h2 = murmur3.sum(hash, this.tweak ^ 0x5bd1e995);
+    const base = (h1 % this.blocks) * BLOCK_SIZE;
+
+    for (let i = 0; i < K; i++) {
+      const bit = ((h2 + i * ((h2 >>> 16) | 1)) >>> 0) % BLOCK_BITS;
+
+      if (!(this.data[base + (bit >>> 3)] & (1 << (bit & 7)))) return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Drop every address.
+   */
+
+  reset() {
+    this.data.fill(0);
+    this.count = 0;
+    this.ready = false;
+  }
+
+  /**
+   * Estimate the false positive rate.
+   * @returns {Number}
+   */
+
+  getRate() {
+    const perBlock = this.count / this.blocks;
+    return Math.pow(1 - Math.exp((-K * perBlock) / BLOCK_BITS), K);
+  }
+
+  /**
+   * Write the filter to a file.
+   * @param {String} file
+   * @param {Network} network
+   * @param {Number} height - Height the filter is complete to.
+   * @returns {Promise}
+   */
+
+  async save(file, network, height) {
+    const bw = bio.write(HEADER_SIZE);
+
+    bw.writeU32(MAGIC);
+    bw.writeU8(VERSION);
+    bw.writeU32(network.magic);
+    bw.writeU32(height);
+    bw.writeU32(this.tweak);
+    bw.writeU32(this.blocks);
+    bw.writeU64(this.count);
+
+    const header = bw.render();
+    const checksum = blake2b.digest(Buffer.concat([header, this.data]));
+
+    await fs.writeFile(
+      file + ".tmp",
+      Buffer.concat([header, this.data, checksum])
+    );
+
+    await fs.rename(file + ".tmp", file);
+  }
+
+  /**
+   * Read the filter from a file. Returns the height it is
+   * complete to, or -1 if it is missing or unusable.
+   * @param {String} file
+   * @param {Network} network
+   * @returns {Promise} - Returns Number.
+   */
+
+  async load(file, network) {
+    if (!(await fs.exists(file))) return -1;
+
+    const raw = await fs.readFile(file);
+
+    if (raw.length < HEADER_SIZE + 32) return -1;
+
+    const body = raw.slice(0, raw.length - 32);
+    const checksum = raw.slice(raw.length - 32);
+
+    if (!blake2b.digest(body).equals(checksum)) return -1;
+
+    const br = bio.read(body);
+
+    if (br.readU32() !== MAGIC) return -1;
+    if (br.readU8() !== VERSION) return -1;
+    if (br.readU32() !== network.magic) return -1;
+
+    const height = br.readU32();
+    const tweak = br.readU32();
+    const blocks = br.readU32();
+    const count = br.readU64();
+
+    // A different configured size means starting over.
+    if (blocks !== this.blocks) return -1;
+
+    br.readBytes(blocks * BLOCK_SIZE).copy(this.data, 0);
+
+    this.tweak = tweak;
+    this.count = count;
+
+    return height;
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = AddressFilter;
@@ -0,0 +1,44 @@
+/*!
+ * backend.js - storage backends for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const bdb = require("bdb");
+
+/**
+ * @exports backend
+ */
+
+const backend = exports;
+
+/**
+ * Available storage backends.
+ * @const {String[]}
+ */
+
+backend.types = ["leveldb", "lmdb"];
+
+/**
+ * Create a database handle for a backend. Every backend exposes
+ * the same batch, iterator and snapshot semantics as `bdb`. In
+ * memory databases always use `bdb`'s in memory store.
+ * @param {Object} options
+ * @returns {DB}
+ */
+
+backend.create = function create(options) {
+  const type = options.backend || "leveldb";
+
+  assert(backend.types.includes(type), `Unknown backend: ${type}.`);
+
+  if (type === "lmdb" && !options.memory) {
+    const LMDB = require("./lmdb");
+    return new LMDB(options);
+  }
+
+  return bdb.create(options);
+};
@@ -0,0 +1,153 @@
+/*!
+ * batch.js - sorted write batch for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+
+/**
+ * Sorted Batch
+ * Buffers writes for many blocks in memory, collapsing repeated
+ * writes to the same key, and hands them to the database in key
+ * order. Pending writes can be read back with {@link SortedBatch#get}.
+ * @alias module:nomenclate.SortedBatch
+ */
+
+class SortedBatch {
+  /**
+   * Create a sorted batch.
+   * @constructor
+   * @param {DB} db
+   */
+
+  constructor(db) {
+    assert(db);
+
+    this.db = db;
+    this.ops = new Map();
+
+    // Bytes handed to the database, and bytes which
+    // were overwritten before they got there.
+    this.size = 0;
+    this.saved = 0;
+  }
+
+  /**
+   * Queue a write.
+   * @param {Buffer} key
+   * @param {Buffer} value
+   * @returns {SortedBatch}
+   */
+
+  put(key, value) {
+    this.set(key, value);
+    return this;
+  }
+
+  /**
+   * Queue a delete.
+   * @param {Buffer} key
+   * @returns {SortedBatch}
+   */
+
+  del(key) {
+    this.set(key, null);
+    return this;
+  }
+
+  /**
+   * Replace any pending operation on a key.
+   * @private
+   * @param {Buffer} key
+   * @param {Buffer|null} value
+   */
+
+  set(key, value) {
+    const hex = key.toString("hex");
+    const old = this.ops.get(hex);
+
+    if (old) {
+      const size = old[0].length + (old[1] ? old[1].length : 0);
+      this.size -= size;
+      this.saved += size;
+    }
+
+    this.ops.set(hex, [key, value]);
+    this.size += key.length + (value ? value.length : 0);
+  }
+
+  /**
+   * Test whether a key has a pending operation.
+   * @param {Buffer} key
+   * @returns {Boolean}
+   */
+
+  has(key) {
+    return this.ops.has(key.toString("hex"));
+  }
+
+  /**
+   * Get a pending value. Returns undefined if the key has no
+   * pending operation, and null if it is pending deletion.
+   * @param {Buffer} key
+   * @returns {Buffer|null|undefined}
+   */
+
+  get(key) {
+    const op = this.ops.get(key.toString("hex"));
+
+    if (!op) return undefined;
+
+    return op[1];
+  }
+
+  /**
+   * Number of pending operations.
+   * @returns {Number}
+   */
+
+  get length() {
+    return this.ops.size;
+  }
+
+  /**
+   * Write all pending operations in key order.
+   * @returns {Promise}
+   */
+
+  async write() {
+    const ops = [...this.ops.values()];
+
+    ops.sort((a, b) => a[0].compare(b[0]));
+
+    const b = this.db.batch();
+
+    for (const [key, value] of ops) {
+      if (value) b.put(key, value);
+      else b.del(key);
+    }
+
+    await b.write();
+
+    this.ops.clear();
+  }
+
+  /**
+   * Drop all pending operations.
+   * @returns {SortedBatch}
+   */
+
+  clear() {
+    this.ops.clear();
+    return this;
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = SortedBatch;
@@ -0,0 +1,808 @@
+/*!
+ * binary.js - binary protocol server for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const EventEmitter = require("events");
+const crypto = require("crypto");
+const net = require("net");
+const tls = require("tls");
+const fs = require("bfile");
+const bio = require("bufio");
+const assert = require("bsert");
+const { base58 } = require("bstring");
+const random = require("bcrypto/lib/random");
+const sha256 = require("bcrypto/lib/sha256");
+const Network = require("hsd").protocol.Network;
+const { Address } = require("hsd");
+const rules = require("hsd/lib/covenants/rules");
+
+/*
+ * Constants
+ */
+
+const MAGIC = 0x6e6d6270;
+const VERSION = 0;
+
+// Frame header: length (of what follows), id and type.
+const HEADER_SIZE = 9;
+
+// Largest request frame accepted.
+const MAX_REQUEST = 1 << 16;
+
+// Rows are sent in frames of about this many bytes.
+const FRAME_SIZE = 1 << 16;
+
+// Most headers returned by one request.
+const MAX_HEADERS = 100000;
+
+// Most change log entries returned by one request.
+const MAX_CHANGES = 10000;
+
+/**
+ * Request methods.
+ * @enum {Number}
+ */
+
+const methods = {
+  AUTH: 0,
+  HISTORY: 1,
+  UNSPENT: 2,
+  BALANCE: 3,
+  HEADERS: 4,
+  NAME_HISTORY: 5,
+  CHANGES: 6
+};
+
+/**
+ * Response frame types.
+ * @enum {Number}
+ */
+
+const types = {
+  HELLO: 0,
+  ROWS: 1,
+  END: 2,
+  ERROR: 3
+};
+
+/**
+ * Binary Server
+ * A length prefixed binary protocol over TCP (or TLS) for bulk
+ * consumers of address history, unspent outputs, balances,
+ * headers and name history. Hashes are raw bytes and numbers
+ * are varints (`bufio` varint2), so rows are a fraction of
+ * their JSON size and cost nothing to encode. Results stream
+ * as they are read, in frames of rows followed by an end frame,
+ * so even the largest histories are never held in memory.
+ *
+ * Every frame is [u32 length][u32 id][u8 type or method] and a
+ * payload, little endian. The server opens with a HELLO frame
+ * (magic, version, network magic and tip height). Unless auth is
+ * off, the first request has to be AUTH with the API key, or the
+ * connection is closed. Requests on a connection are answered in
+ * order, each with ROWS frames and an END frame holding the row
+ * count, or an ERROR frame.
+ * @alias module:nomenclate.BinaryServer
+ * @extends EventEmitter
+ */
+
+class BinaryServer extends EventEmitter {
+  /**
+   * Create a binary protocol server.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    super();
+
+    this.options = new BinaryOptions(options);
+
+    this.network = this.options.network;
+    this.logger = this.options.logger.context("binary-nomenclate");
+    this.ndb = this.options.ndb;
+
+    this.server = null;
+    this.conns = new Set();
+  }
+
+  /**
+   * Start listening.
+   * @returns {Promise}
+   */
+
+  async open() {
+    assert(!this.server, "Binary server is already open.");
+
+    const handler = socket => this.accept(socket);
+
+    if (this.options.ssl) {
+      assert(this.options.keyFile, "Binary server needs an SSL key.");
+      assert(this.options.certFile, "Binary server needs an SSL certificate.");
+
+      const key = await fs.readFile(this.options.keyFile);
+      const cert = await fs.readFile(this.options.certFile);
+
+      this.server = tls.createServer({ key, cert }, handler);
+    } else {
+      this.server = net.createServer(handler);
+    }
+
+    this.server.maxConnections = this.options.maxConnections;
+
+    await new Promise((resolve, reject) => {
+      this.server.once("error", reject);
+      this.server.listen(this.options.port, this.options.host, () => {
+        this.server.removeListener("error", reject);
+        resolve();
+      });
+    });
+
+    this.server.on("error", err => this.emit("error", err));
+
+    const address = this.server.address();
+
+    this.logger.info(
+      "Nomenclate binary server listening on %s (port=%d, ssl=%s).",
+      address.address,
+      address.port,
+      this.options.ssl
+    );
+  }
+
+  /**
+   * Close every connection and stop listening.
+   * @returns {Promise}
+   */
+
+  async close() {
+    if (!this.server) return;
+
+    for (const conn of this.conns) conn.destroy();
+
+    await new Promise(resolve => this.server.close(resolve));
+
+    this.server = null;
+  }
+
+  /**
+   * Handle a new connection.
+   * @private
+   * @param {net.Socket} socket
+   */
+
+  accept(socket) {
+    const conn = new BinaryConnection(this, socket);
+
+    this.conns.add(conn);
+
+    socket.on("close", () => this.conns.delete(conn));
+
+    this.logger.debug("Binary connection from %s.", socket.remoteAddress);
+
+    const bw = bio.write(9 + bio.sizeVarint2(this.ndb.height));
+
+    bw.writeU32(MAGIC);
+    bw.writeU8(VERSION);
+    bw.writeU32(this.network.magic);
+    bw.writeVarint2(this.ndb.height);
+
+    conn.write(0, types.HELLO, bw.render());
+  }
+
+  /**
+   * Answer one request.
+   * @private
+   * @param {BinaryConnection} conn
+   * @param {Number} id
+   * @param {Number} method
+   * @param {Buffer} payload
+   * @returns {Promise}
+   */
+
+  async handle(conn, id, method, payload) {
+    const stream = new RowStream(conn, id);
+
+    try {
+      const br = bio.read(payload);
+
+      if (!conn.authed && method !== methods.AUTH)
+        throw new Error("Authenticate first.");
+
+      switch (method) {
+        case methods.AUTH:
+          this.auth(br, conn);
+          break;
+        case methods.HISTORY:
+          await this.history(br, stream);
+          break;
+        case methods.UNSPENT:
+          await this.unspent(br, stream);
+          break;
+        case methods.BALANCE:
+          await this.balance(br, stream);
+          break;
+        case methods.HEADERS:
+          await this.headers(br, stream);
+          break;
+        case methods.NAME_HISTORY:
+          await this.nameHistory(br, stream);
+          break;
+        case methods.CHANGES:
+          await this.changes(br, stream);
+          break;
+        default:
+          throw new Error("Unknown method.");
+      }
+    } catch (e) {
+      // Rows already sent stand, the error ends the stream.
+      await stream.fail(e.message);
+
+      if (!conn.authed) conn.destroy();
+
+      return;
+    }
+
+    await stream.end();
+  }
+
+  /**
+   * Check the API key, which opens the connection to requests.
+   * Request: varstring key.
+   * @private
+   * @param {BufferReader} br
+   * @param {BinaryConnection} conn
+   */
+
+  auth(br, conn) {
+    const key = br.readVarString("ascii");
+    const hash = sha256.digest(Buffer.from(key, "ascii"));
+
+    const { noAuth, apiHash } = this.options;
+
+    if (!noAuth && !crypto.timingSafeEqual(hash, apiHash))
+      throw new Error("Invalid API key.");
+
+    conn.authed = true;
+  }
+
+  /**
+   * Read an address ([u8 version][varbytes hash]).
+   * @private
+   * @param {BufferReader} br
+   * @returns {Address}
+   */
+
+  readAddress(br) {
+    const version = br.readU8();
+    const hash = br.readVarBytes();
+
+    return Address.fromHash(hash, version);
+  }
+
+  /**
+   * Address history, newest first: [txid][height].
+   * Request: address, optional varint start height.
+   * @private
+   * @param {BufferReader} br
+   * @param {RowStream} stream
+   * @returns {Promise}
+   */
+
+  async history(br, stream) {
+    const addr = this.readAddress(br);
+    const pruned = this.ndb.pruneHeight;
+    const startHeight = br.left() > 0 ? br.readVarint2() : pruned;
+
+    requireIndex(this.ndb, "address");
+
+    if (startHeight < pruned)
+      throw new Error("History below that height has been pruned.");
+
+    const hash = addr.getHash();
+
+    this.ndb.touch("address", hash);
+
+    if (this.ndb.isUnknown(addr)) return;
+
+    const merge = this.ndb.historyMerge(hash, startHeight);
+
+    try {
+      for (let row; (row = await merge.nextRow()); ) {
+        const bw = bio.write(32 + bio.sizeVarint2(row.height));
+
+        bw.writeHash(row.txid);
+        bw.writeVarint2(row.height);
+
+        await stream.push(bw.render());
+      }
+    } finally {
+      await merge.end();
+    }
+  }
+
+  /**
+   * Unspent outputs: [txid][index][height][value].
+   * Request: address.
+   * @private
+   * @param {BufferReader} br
+   * @param {RowStream} stream
+   * @returns {Promise}
+   */
+
+  async unspent(br, stream) {
+    const addr = this.readAddress(br);
+
+    const push = (txid, index, height, value) => {
+      const bw = bio.write(
+        32 +
+          bio.sizeVarint2(index) +
+          bio.sizeVarint2(height) +
+          bio.sizeVarint2(value)
+      );
+
+      bw.writeHash(txid);
+      bw.writeVarint2(index);
+      bw.writeVarint2(height);
+      bw.writeVarint2(value);
+
+      return stream.push(bw.render());
+    };
+
+    if (this.ndb.hasIndex("balance")) {
+      this.ndb.touch("address", addr.getHash());
+
+      if (this.ndb.isUnknown(addr)) return;
+
+      await this.ndb.eachCoin(addr.getHash(), (txid, index, coin) =>
+        push(txid, index, coin.height, coin.value)
+      );
+
+      return;
+    }
+
+    requireIndex(this.ndb, "address");
+
+    for (const tx of await this.ndb.addressUnspent(addr)) {
+      const txid = Buffer.from(tx.tx_hash, "hex");
+      await push(txid, tx.tx_pos, tx.height, tx.value);
+    }
+  }
+
+  /**
+   * Address balance, one row: [confirmed][received][spent].
+   * Request: address.
+   * @private
+   * @param {BufferReader} br
+   * @param {RowStream} stream
+   * @returns {Promise}
+   */
+
+  async balance(br, stream) {
+    const addr = this.readAddress(br);
+
+    if (!this.ndb.hasIndex("balance")) requireIndex(this.ndb, "address");
+
+    const { confirmed, received, spent } = await this.ndb.addressBalance(addr);
+
+    const bw = bio.write(
+      bio.sizeVarint2(confirmed) +
+        bio.sizeVarint2(received) +
+        bio.sizeVarint2(spent)
+    );
+
+    bw.writeVarint2(confirmed);
+    bw.writeVarint2(received);
+    bw.writeVarint2(spent);
+
+    await stream.push(bw.render());
+  }
+
+  /**
+   * Raw headers: [varbytes header]. Stops at the tip.
+   * Request: varint start height, varint count.
+   * @private
+   * @param {BufferReader} br
+   * @param {RowStream} stream
+   * @returns {Promise}
+   */
+
+  async headers(br, stream) {
+    const start = br.readVarint2();
+    const count = Math.min(br.readVarint2(), MAX_HEADERS);
+
+    for (let height = start; height < start + count; height++) {
+      const header = await this.ndb.getHeaders(height);
+
+      if (!header) break;
+
+      const bw = bio.write(bio.sizeVarBytes(header));
+
+      bw.writeVarBytes(header);
+
+      await stream.push(bw.render());
+    }
+  }
+
+  /**
+   * Name history, in txid order: [txid][height].
+   * Request: varbytes name.
+   * @private
+   * @param {BufferReader} br
+   * @param {RowStream} stream
+   * @returns {Promise}
+   */
+
+  async nameHistory(br, stream) {
+    const name = br.readVarString("ascii");
+
+    requireIndex(this.ndb, "name");
+
+    if (!rules.verifyName(name)) throw new Error("Invalid name.");
+
+    await this.ndb.eachNameTX(rules.hashName(name), (txid, height) => {
+      const bw = bio.write(32 + bio.sizeVarint2(height));
+
+      bw.writeHash(txid);
+      bw.writeVarint2(height);
+
+      return stream.push(bw.render());
+    });
+  }
+
+  /**
+   * Change log entries: [varint offset][varbytes entry], where
+   * the entry is a serialized {@link BlockChanges}. The offset
+   * after the last one sent is the last offset plus the entry
+   * size plus eight.
+   * Request: varint offset, varint count.
+   * @private
+   * @param {BufferReader} br
+   * @param {RowStream} stream
+   * @returns {Promise}
+   */
+
+  async changes(br, stream) {
+    const offset = br.readVarint2();
+    const count = Math.min(br.readVarint2(), MAX_CHANGES);
+    const log = this.ndb.changes;
+
+    if (!log) throw new Error("The change log is not enabled.");
+
+    if (offset < log.start) throw new Error("Offset was dropped.");
+
+    const { entries } = await log.read(offset, count);
+
+    for (const [pos, payload] of entries) {
+      const bw = bio.write(bio.sizeVarint2(pos) + bio.sizeVarBytes(payload));
+
+      bw.writeVarint2(pos);
+      bw.writeVarBytes(payload);
+
+      await stream.push(bw.render());
+    }
+  }
+}
+
+/**
+ * Binary Connection
+ * A client socket and its partial request frame. Requests are
+ * answered one at a time, in order, and reading pauses while
+ * the client is not reading its answers.
+ * @ignore
+ */
+
+class BinaryConnection {
+  constructor(server, socket) {
+    this.server = server;
+    this.socket = socket;
+    this.buffer = Buffer.alloc(0);
+    this.queue = Promise.resolve();
+    this.pending = 0;
+    this.authed = server.options.noAuth;
+    this.destroyed = false;
+
+    this.init();
+  }
+
+  init() {
+    this.socket.setNoDelay(true);
+    this.socket.setTimeout(this.server.options.timeout);
+
+    this.socket.on("data", data => this.feed(data));
+    this.socket.on("timeout", () => this.destroy());
+    this.socket.on("error", () => this.destroy());
+    this.socket.on("close", () => {
+      this.destroyed = true;
+    });
+  }
+
+  feed(data) {
+    this.buffer = Buffer.concat([this.buffer, data]);
+
+    while (this.buffer.length >= 4) {
+      const size = this.buffer.readUInt32LE(0, true);
+
+      if (size < 5 || size > MAX_REQUEST) {
+        this.destroy();
+        return;
+      }
+
+      if (this.buffer.length < 4 + size) break;
+
+      const id = this.buffer.readUInt32LE(4, true);
+      const method = this.buffer[8];
+      const payload = this.buffer.slice(HEADER_SIZE, 4 + size);
+
+      this.buffer = this.buffer.slice(4 + size);
+
+      this.enqueue(id, method, payload);
+    }
+  }
+
+  enqueue(id, method, payload) {
+    this.pending += 1;
+
+    if (this.pending >= this.server.options.maxPending) this.socket.pause();
+
+    this.queue = this.queue
+      .then(() => {
+        if (this.destroyed) return null;
+        return this.server.handle(this, id, method, payload);
+      })
+      .catch(e => this.server.emit("error", e))
+      .then(() => {
+        this.pending -= 1;
+
+        if (this.pending < this.server.options.maxPending && !this.destroyed)
+          this.socket.resume();
+      });
+  }
+
+  /**
+   * Write a frame, waiting for the socket to drain if needed.
+   * @param {Number} id
+   * @param {Number} type
+   * @param {Buffer} payload
+   * @returns {Promise}
+   */
+
+  write(id, type, payload) {
+    if (this.destroyed) return Promise.resolve();
+
+    const header = Buffer.allocUnsafe(HEADER_SIZE);
+
+    header.writeUInt32LE(5 + payload.length, 0, true);
+    header.writeUInt32LE(id, 4, true);
+    header[8] = type;
+
+    this.socket.write(header);
+
+    if (this.socket.write(payload)) return Promise.resolve();
+
+    return new Promise(resolve => {
+      const done = () => {
+        this.socket.removeListener("drain", done);
+        this.socket.removeListener("close", done);
+        resolve();
+      };
+
+      this.socket.on("drain", done);
+      this.socket.on("close", done);
+    });
+  }
+
+  destroy() {
+    if (this.destroyed) return;
+
+    this.destroyed = true;
+    this.socket.destroy();
+  }
+}
+
+/**
+ * Row Stream
+ * Packs the rows of one response into frames.
+ * @ignore
+ */
+
+class RowStream {
+  constructor(conn, id) {
+    this.conn = conn;
+    this.id = id;
+    this.rows = [];
+    this.size = 0;
+    this.count = 0;
+  }
+
+  async push(row) {
+    // Ends the read of a client which has gone.
+    if (this.conn.destroyed) throw new Error("Connection closed.");
+
+    this.rows.push(row);
+    this.size += row.length;
+    this.count += 1;
+
+    if (this.size >= FRAME_SIZE) await this.flush();
+  }
+
+  async flush() {
+    if (this.rows.length === 0) return;
+
+    const payload = Buffer.concat(this.rows, this.size);
+
+    this.rows = [];
+    this.size = 0;
+
+    await this.conn.write(this.id, types.ROWS, payload);
+  }
+
+  async end() {
+    await this.flush();
+
+    const bw = bio.write(bio.sizeVarint2(this.count));
+
+    bw.writeVarint2(this.count);
+
+    await this.conn.write(this.id, types.END, bw.render());
+  }
+
+  async fail(msg) {
+    await this.flush();
+
+    const bw = bio.write(bio.sizeVarString(msg, "utf8"));
+
+    bw.writeVarString(msg, "utf8");
+
+    await this.conn.write(this.id, types.ERROR, bw.render());
+  }
+}
+
+class BinaryOptions {
+  /**
+   * Create binary server options.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    this.network = Network.primary;
+    this.logger = null;
+    this.ndb = null;
+
+    this.host = "127.0.0.1";
+    this.port = 50003;
+    this.ssl = false;
+    this.keyFile = null;
+    this.certFile = null;
+    this.apiKey = base58.encode(random.randomBytes(20));
+    this.apiHash = sha256.digest(Buffer.from(this.apiKey, "ascii"));
+    this.noAuth = false;
+
+    this.maxConnections = 100;
+    this.maxPending = 64;
+    this.timeout = 10 * 60 * 1000;
+
+    this.fromOptions(options);
+  }
+
+  /**
+   * Inject properties from object.
+   * @private
+   * @param {Object} options
+   * @returns {BinaryOptions}
+   */
+
+  fromOptions(options) {
+    assert(options);
+    assert(
+      options.ndb && typeof options.ndb === "object",
+      "Binary Server requires a NomenclateDB."
+    );
+
+    this.ndb = options.ndb;
+
+    if (options.network != null) this.network = Network.get(options.network);
+
+    if (options.logger != null) {
+      assert(typeof options.logger === "object");
+      this.logger = options.logger;
+    }
+
+    if (options.host != null) {
+      assert(typeof options.host === "string");
+      this.host = options.host;
+    }
+
+    if (options.port != null) {
+      assert(
+        (options.port & 0xffff) === options.port,
+        "Port must be a number."
+      );
+      this.port = options.port;
+    }
+
+    if (options.ssl != null) {
+      assert(typeof options.ssl === "boolean");
+      this.ssl = options.ssl;
+    }
+
+    if (options.keyFile != null) {
+      assert(typeof options.keyFile === "string");
+      this.keyFile = options.keyFile;
+    }
+
+    if (options.certFile != null) {
+      assert(typeof options.certFile === "string");
+      this.certFile = options.certFile;
+    }
+
+    if (options.apiKey != null) {
+      assert(typeof options.apiKey === "string", "API key must be a string.");
+      assert(options.apiKey.length <= 255, "API key must be under 255 bytes.");
+      this.apiKey = options.apiKey;
+      this.apiHash = sha256.digest(Buffer.from(this.apiKey, "ascii"));
+    }
+
+    if (options.noAuth != null) {
+      assert(typeof options.noAuth === "boolean");
+      this.noAuth = options.noAuth;
+    }
+
+    if (options.maxConnections != null) {
+      assert(options.maxConnections >>> 0 === options.maxConnections);
+      this.maxConnections = options.maxConnections;
+    }
+
+    if (options.maxPending != null) {
+      assert(options.maxPending >>> 0 === options.maxPending);
+      assert(options.maxPending > 0);
+      this.maxPending = options.maxPending;
+    }
+
+    if (options.timeout != null) {
+      assert(options.timeout >>> 0 === options.timeout);
+      this.timeout = options.timeout;
+    }
+
+    // Allow no-auth implicitly
+    // if we're listening locally.
+    if (!options.apiKey) {
+      if (this.host === "127.0.0.1" || this.host === "::1") this.noAuth = true;
+    }
+
+    return this;
+  }
+
+  /**
+   * Instantiate binary server options from object.
+   * @param {Object} options
+   * @returns {BinaryOptions}
+   */
+
+  static fromOptions(options) {
+    return new BinaryOptions().fromOptions(options);
+  }
+}
+
+/*
+ * Helpers
+ */
+
+function requireIndex(ndb, ...names) {
+  if (!ndb.hasIndex(...names))
+    throw new Error("Needs the " + names.join(" and ") + " index.");
+}
+
+/*
+ * Expose
+ */
+
+BinaryServer.methods = methods;
+BinaryServer.types = types;
+
+module.exports = BinaryServer;
@@ -0,0 +1,411 @@
+/*!
+ * blockreader.js - block file reader for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const path = require("path");
+const fs = require("bfile");
+const { Lock } = require("bmutex");
+const { Network, Block, Headers } = require("hsd");
+
+/*
+ * Constants
+ */
+
+// Each record in a block file is prefixed
+// with the network magic and the block size.
+const RECORD_SIZE = 8;
+
+const FILE_PATTERN = /^blk\d{5}\.dat$/;
+
+// Records behind the last block served after which a pending
+// block is taken to be on a side chain, and dropped.
+const MAX_BEHIND = 1000;
+
+/**
+ * Block Reader
+ * Streams raw blocks out of hsd's flat block files with large
+ * sequential reads, and hands them out in main chain order.
+ * Blocks read ahead of the one requested are held until they
+ * are requested, up to `maxPending` bytes. A block which is not
+ * found within that window is read from the chain database
+ * instead, leaving the cursor and the held blocks as they are.
+ * The reader makes one pass from the first file each time it
+ * is opened.
+ * @alias module:nomenclate.BlockReader
+ */
+
+class BlockReader {
+  /**
+   * Create a block reader.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    this.options = new BlockReaderOptions(options);
+
+    this.network = this.options.network;
+    this.logger = this.options.logger.context("nomenclate-blocks");
+    this.client = this.options.client;
+    this.location = this.options.location;
+
+    this.lock = new Lock();
+    this.files = [];
+    this.file = -1;
+    this.fd = null;
+    this.position = 0;
+    this.chunk = Buffer.alloc(0);
+    this.offset = 0;
+
+    // Blocks read from disk but not yet requested,
+    // in file order. Bounded by `maxPending` bytes.
+    this.pending = new Map();
+    this.pendingSize = 0;
+
+    // Records read, and the record of the last block served.
+    this.records = 0;
+    this.served = 0;
+
+    this.hits = 0;
+    this.misses = 0;
+  }
+
+  /**
+   * Open the reader at the start of the first block file.
+   * @returns {Promise}
+   */
+
+  async open() {
+    await this.closeFile();
+
+    this.files = [];
+    this.file = -1;
+    this.position = 0;
+    this.pending.clear();
+    this.pendingSize = 0;
+    this.records = 0;
+    this.served = 0;
+    this.hits = 0;
+    this.misses = 0;
+
+    if (!(await fs.exists(this.location))) {
+      this.logger.info(
+        "No block files at %s, reading from chain database.",
+        this.location
+      );
+      return;
+    }
+
+    const names = await fs.readdir(this.location);
+
+    this.files = names
+      .filter(name => FILE_PATTERN.test(name))
+      .sort()
+      .map(name => path.join(this.location, name));
+
+    this.logger.info(
+      "Reading %d block files from %s.",
+      this.files.length,
+      this.location
+    );
+  }
+
+  /**
+   * Close the reader.
+   * @returns {Promise}
+   */
+
+  async close() {
+    await this.closeFile();
+
+    this.pending.clear();
+    this.pendingSize = 0;
+
+    this.logger.info(
+      "Block reader served %d blocks from files and %d from the chain.",
+      this.hits,
+      this.misses
+    );
+  }
+
+  /**
+   * Get a range of main chain entries and blocks.
+   * Calls are serialized since the reader is a single
+   * sequential cursor over the block files.
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise} - Returns [ChainEntry, Block][].
+   */
+
+  async getBlocks(start, end) {
+    const unlock = await this.lock.lock();
+    try {
+      return await this._getBlocks(start, end);
+    } finally {
+      unlock();
+    }
+  }
+
+  /**
+   * Get a range of main chain entries and blocks (without a lock).
+   * @private
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise}
+   */
+
+  async _getBlocks(start, end) {
+    const hashes = await this.client.getHashes(start, end);
+
+    assert(hashes.length === end - start + 1);
+
+    const blocks = [];
+
+    for (const hash of hashes) {
+      const entry = await this.client.getEntry(hash);
+      assert(entry, "BlockReader: Block is no longer in main chain.");
+
+      const raw = await this.readBlock(hash);
+      const block = Block.decode(raw);
+
+      assert(block.hash().equals(entry.hash));
+
+      blocks.push([entry, block]);
+    }
+
+    return blocks;
+  }
+
+  /**
+   * Read a raw block by hash, advancing through the block
+   * files until it is found or the pending blocks are full.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async readBlock(hash) {
+    const key = hash.toString("hex");
+
+    for (;;) {
+      const item = this.pending.get(key);
+
+      if (item) {
+        this.pending.delete(key);
+        this.pendingSize -= item.raw.length;
+        this.serve(item.record);
+        return item.raw;
+      }
+
+      if (this.pendingSize >= this.options.maxPending) break;
+
+      if (!(await this.readRecord())) break;
+    }
+
+    this.misses += 1;
+
+    const raw = await this.client.getRawBlock(hash);
+    assert(raw, "BlockReader: Block not found.");
+
+    return raw;
+  }
+
+  /**
+   * Count a block served from the files, and drop pending
+   * blocks so far behind it that they are on side chains.
+   * @private
+   * @param {Number} record
+   */
+
+  serve(record) {
+    this.hits += 1;
+
+    if (record > this.served) this.served = record;
+
+    for (const [key, item] of this.pending) {
+      if (item.record >= this.served - MAX_BEHIND) break;
+
+      this.pending.delete(key);
+      this.pendingSize -= item.raw.length;
+    }
+  }
+
+  /**
+   * Read the next record from the block files into the
+   * pending set.
+   * @private
+   * @returns {Promise} - Returns false on end of files.
+   */
+
+  async readRecord() {
+    const raw = await this.nextRecord();
+
+    if (!raw) return false;
+
+    const hash = Headers.decode(raw).hash();
+
+    this.pending.set(hash.toString("hex"), { raw, record: this.records });
+    this.pendingSize += raw.length;
+    this.records += 1;
+
+    return true;
+  }
+
+  /**
+   * Parse the next record out of the current chunk,
+   * reading more of the file (or the next file) as needed.
+   * @private
+   * @returns {Promise} - Returns Buffer or null.
+   */
+
+  async nextRecord() {
+    for (;;) {
+      if (this.chunk.length - this.offset >= RECORD_SIZE) {
+        const magic = this.chunk.readUInt32LE(this.offset, true);
+        const size = this.chunk.readUInt32LE(this.offset + 4, true);
+
+        if (magic !== this.network.magic) {
+          // Zeroed or partially written tail of a file.
+          if (!(await this.nextFile())) return null;
+          continue;
+        }
+
+        const start = this.offset + RECORD_SIZE;
+
+        if (this.chunk.length - start >= size) {
+          this.offset = start + size;
+          return this.chunk.slice(start, start + size);
+        }
+
+        // Make room for records larger than a chunk.
+        if (size + RECORD_SIZE > this.options.chunkSize)
+          this.options.chunkSize = size + RECORD_SIZE;
+      }
+
+      if (!(await this.readChunk())) {
+        if (!(await this.nextFile())) return null;
+      }
+    }
+  }
+
+  /**
+   * Read the next chunk of the current file, keeping
+   * any partial record left over from the last one.
+   * @private
+   * @returns {Promise} - Returns false on end of file.
+   */
+
+  async readChunk() {
+    if (this.fd == null) return false;
+
+    const left = this.chunk.slice(this.offset);
+    const chunk = Buffer.allocUnsafe(left.length + this.options.chunkSize);
+
+    left.copy(chunk, 0);
+
+    const bytes = await fs.read(
+      this.fd,
+      chunk,
+      left.length,
+      this.options.chunkSize,
+      this.position
+    );
+
+    if (bytes === 0) return false;
+
+    this.position += bytes;
+    this.chunk = chunk.slice(0, left.length + bytes);
+    this.offset = 0;
+
+    return true;
+  }
+
+  /**
+   * Move the cursor to the next block file.
+   * @private
+   * @returns {Promise} - Returns false if there are no more files.
+   */
+
+  async nextFile() {
+    await this.closeFile();
+
+    this.file += 1;
+
+    if (this.file >= this.files.length) return false;
+
+    this.fd = await fs.open(this.files[this.file], "r");
+    this.position = 0;
+
+    return true;
+  }
+
+  /**
+   * Close the current block file.
+   * @private
+   * @returns {Promise}
+   */
+
+  async closeFile() {
+    if (this.fd != null) {
+      await fs.close(this.fd);
+      this.fd = null;
+    }
+
+    this.chunk = Buffer.alloc(0);
+    this.offset = 0;
+  }
+}
+
+class BlockReaderOptions {
+  /**
+   * Create block reader options.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    this.network = Network.primary;
+    this.logger = null;
+    this.client = null;
+    this.location = null;
+    this.chunkSize = 16 << 20;
+    this.maxPending = 256 << 20;
+
+    if (options) this._fromOptions(options);
+  }
+
+  _fromOptions(options) {
+    if (options.network != null) this.network = Network.get(options.network);
+
+    assert(options.logger && typeof options.logger === "object");
+    this.logger = options.logger;
+
+    assert(options.client && typeof options.client === "object");
+    this.client = options.client;
+
+    assert(typeof options.location === "string");
+    this.location = options.location;
+
+    if (options.chunkSize != null) {
+      assert(options.chunkSize >>> 0 === options.chunkSize);
+      this.chunkSize = options.chunkSize;
+    }
+
+    if (options.maxPending != null) {
+      assert(Number.isSafeInteger(options.maxPending));
+      this.maxPending = options.maxPending;
+    }
+
+    return this;
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = BlockReader;
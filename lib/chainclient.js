@@ -21,13 +21,15 @@ class ChainClient extends AsyncEmitter {
   /**
    * Create a chain client.
    * @constructor
+   * @param {FullNode} node
    */
 
-  constructor(chain) {
+  constructor(node) {
     super();
 
-    this.chain = chain;
-    this.network = chain.network;
+    this.node = node;
+    this.chain = node.chain;
+    this.network = node.network;
     this.opened = false;
 
     this.init();
@@ -163,6 +165,39 @@ class ChainClient extends AsyncEmitter {
     return block;
   }
 
+  /**
+   * Get a serialized block without decoding it.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async getRawBlock(hash) {
+    return this.chain.db.getRawBlock(hash);
+  }
+
+  /**
+   * Get a range of main chain entries and blocks.
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise} - Returns [ChainEntry, Block][].
+   */
+
+  async getBlocks(start, end) {
+    const blocks = [];
+
+    for (let i = start; i <= end; i++) {
+      const entry = await this.getEntry(i);
+      assert(entry);
+
+      const block = await this.getBlock(entry.hash);
+      assert(block);
+
+      blocks.push([entry, block]);
+    }
+
+    return blocks;
+  }
+
   /**
    * Get tx
    * @param {Hash} hash
@@ -177,6 +212,74 @@ class ChainClient extends AsyncEmitter {
     return tx;
   }
 
+  /**
+   * Get transaction with metadata.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns {@link TXMeta}.
+   */
+
+  async getMeta(hash) {
+    return this.node.getMeta(hash);
+  }
+
+  /**
+   * Broadcast a transaction.
+   * @param {TX} tx
+   * @returns {Promise}
+   */
+
+  async sendTX(tx) {
+    return this.node.sendTX(tx);
+  }
+
+  /**
+   * Estimate a fee rate.
+   * @param {Number} blocks
+   * @returns {Promise}
+   */
+
+  async estimateFee(blocks) {
+    return this.node.fees.estimateFee(blocks);
+  }
+
+  /**
+   * Get mempool transactions for an address.
+   * @param {Address} addr
+   * @returns {Promise}
+   */
+
+  async getMempoolTXs(addr) {
+    if (!this.node.mempool) return [];
+
+    return this.node.mempool.getTXByAddress(addr);
+  }
+
+  /**
+   * Test whether a transaction is in the mempool.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async hasMempoolTX(hash) {
+    if (!this.node.mempool) return false;
+
+    return this.node.mempool.hasEntry(hash);
+  }
+
+  /**
+   * Get the fee a mempool transaction pays.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Number, or null if not found.
+   */
+
+  async getMempoolFee(hash) {
+    if (!this.node.mempool) return null;
+
+    const entry = this.node.mempool.getEntry(hash);
+
+    return entry ? entry.fee : null;
+  }
+
   /**
    * Get previous entry.
    * @param {ChainEntry} entry
@@ -0,0 +1,622 @@
+/*!
+ * changelog.js - change feed for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const path = require("path");
+const fs = require("bfile");
+const bio = require("bufio");
+const blake2b = require("bcrypto/lib/blake2b");
+
+/*
+ * Constants
+ */
+
+// Entry header: payload size and checksum.
+const ENTRY_HEADER = 8;
+
+const SEGMENT_NAME = /^(\d{20})\.log$/;
+
+const ZERO_HASH = Buffer.alloc(32, 0x00);
+
+/**
+ * Change types.
+ * @enum {Number}
+ */
+
+const types = {
+  // A block was indexed.
+  CONNECT: 1,
+  // Entries above a height no longer hold.
+  REWIND: 2
+};
+
+/**
+ * Change Log
+ * An append-only log of what each indexed block changed:
+ * address deltas, spent outpoints and name events, with rewind
+ * markers when blocks are disconnected. Entries are written to
+ * numbered segment files before the block is committed, and
+ * are addressed by their byte offset in the log, so consumers can
+ * resume from the last offset they read. Old segments are
+ * dropped once the log is over its retention size.
+ *
+ * Each entry is [u32 size][u32 checksum][payload], where the
+ * checksum is the start of the payload's BLAKE2b digest, and
+ * a segment is named after the offset of its first entry.
+ * @alias module:nomenclate.ChangeLog
+ */
+
+class ChangeLog {
+  /**
+   * Create a change log.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    assert(options && typeof options.location === "string");
+
+    this.location = options.location;
+    this.segmentSize = options.segmentSize || 64 << 20;
+    this.retention = options.retention || 1024 << 20;
+
+    assert(Number.isSafeInteger(this.segmentSize) && this.segmentSize > 0);
+    assert(Number.isSafeInteger(this.retention) && this.retention > 0);
+
+    // {start, size} of every segment, oldest first.
+    this.segments = [];
+    this.fd = null;
+
+    // Offset the next entry is written at.
+    this.offset = 0;
+
+    // Last block logged, or -1.
+    this.height = -1;
+    this.hash = ZERO_HASH;
+  }
+
+  /**
+   * Open the log, dropping a partly written last entry.
+   * @returns {Promise}
+   */
+
+  async open() {
+    await fs.mkdirp(this.location);
+
+    for (const name of await fs.readdir(this.location)) {
+      const match = SEGMENT_NAME.exec(name);
+
+      if (!match) continue;
+
+      const stat = await fs.stat(this.file(Number(match[1])));
+
+      this.segments.push({ start: Number(match[1]), size: stat.size });
+    }
+
+    this.segments.sort((a, b) => a.start - b.start);
+
+    if (this.segments.length === 0) this.segments.push({ start: 0, size: 0 });
+
+    await this.recover();
+
+    const last = this.tail();
+
+    this.fd = await fs.open(this.file(last.start), "a");
+    this.offset = last.start + last.size;
+  }
+
+  /**
+   * Close the log.
+   * @returns {Promise}
+   */
+
+  async close() {
+    if (this.fd == null) return;
+
+    await fs.close(this.fd);
+
+    this.fd = null;
+  }
+
+  /**
+   * Get the file of a segment.
+   * @private
+   * @param {Number} start
+   * @returns {String}
+   */
+
+  file(start) {
+    const name = start.toString(10).padStart(20, "0") + ".log";
+    return path.join(this.location, name);
+  }
+
+  /**
+   * Get the segment being written.
+   * @private
+   * @returns {Object}
+   */
+
+  tail() {
+    return this.segments[this.segments.length - 1];
+  }
+
+  /**
+   * Check the entries of the last segment, truncating it at the
+   * first one which is incomplete or corrupt, and find the last
+   * block logged.
+   * @private
+   * @returns {Promise}
+   */
+
+  async recover() {
+    const last = this.tail();
+    const file = this.file(last.start);
+
+    if (!(await fs.exists(file))) {
+      await fs.writeFile(file, Buffer.alloc(0));
+      return;
+    }
+
+    const data = await fs.readFile(file);
+
+    let pos = 0;
+
+    for (;;) {
+      const payload = readEntry(data, pos);
+
+      if (!payload) break;
+
+      this.setTip(BlockChanges.decode(payload));
+
+      pos += ENTRY_HEADER + payload.length;
+    }
+
+    if (pos < data.length) await fs.truncate(file, pos);
+
+    last.size = pos;
+
+    // A segment which was just started holds no entries,
+    // so the last block is found in the one before it.
+    if (pos === 0 && this.segments.length > 1) {
+      const prev = this.segments[this.segments.length - 2];
+      const raw = await fs.readFile(this.file(prev.start));
+
+      for (let off = 0; ; ) {
+        const payload = readEntry(raw, off);
+
+        if (!payload) break;
+
+        this.setTip(BlockChanges.decode(payload));
+
+        off += ENTRY_HEADER + payload.length;
+      }
+    }
+  }
+
+  /**
+   * Track the last block logged.
+   * @private
+   * @param {BlockChanges} changes
+   */
+
+  setTip(changes) {
+    this.height = changes.height;
+    this.hash = changes.type === types.CONNECT ? changes.hash : ZERO_HASH;
+  }
+
+  /**
+   * Log a connected block. A block which is already the last
+   * one logged (replayed after a crash) is skipped, and one at
+   * or below the last height logged first rewinds the log.
+   * @param {BlockChanges} changes
+   * @returns {Promise}
+   */
+
+  async connect(changes) {
+    assert(changes.type === types.CONNECT);
+
+    if (changes.height === this.height && changes.hash.equals(this.hash))
+      return;
+
+    if (changes.height <= this.height) await this.rewind(changes.height - 1);
+
+    await this.append(changes.encode());
+
+    this.setTip(changes);
+  }
+
+  /**
+   * Mark every block above a height as disconnected.
+   * @param {Number} height
+   * @param {Buffer?} hash - Hash of the block disconnected.
+   * @returns {Promise}
+   */
+
+  async rewind(height, hash) {
+    if (height >= this.height) return;
+
+    const changes = new BlockChanges();
+
+    changes.type = types.REWIND;
+    changes.height = height;
+    changes.hash = hash || ZERO_HASH;
+
+    await this.append(changes.encode());
+
+    this.setTip(changes);
+  }
+
+  /**
+   * Append an entry, starting a new segment if the current one
+   * is full and dropping the oldest ones over the retention.
+   * @private
+   * @param {Buffer} payload
+   * @returns {Promise}
+   */
+
+  async append(payload) {
+    assert(this.fd != null, "Change log is not open.");
+
+    if (this.tail().size >= this.segmentSize) await this.roll();
+
+    const entry = Buffer.allocUnsafe(ENTRY_HEADER + payload.length);
+
+    entry.writeUInt32LE(payload.length, 0, true);
+    checksum(payload).copy(entry, 4);
+    payload.copy(entry, ENTRY_HEADER);
+
+    await fs.write(this.fd, entry, 0, entry.length);
+
+    this.tail().size += entry.length;
+    this.offset += entry.length;
+
+    await this.prune();
+  }
+
+  /**
+   * Start a new segment.
+   * @private
+   * @returns {Promise}
+   */
+
+  async roll() {
+    await fs.close(this.fd);
+
+    this.segments.push({ start: this.offset, size: 0 });
+    this.fd = await fs.open(this.file(this.offset), "a");
+  }
+
+  /**
+   * Drop the oldest segments while over the retention.
+   * @private
+   * @returns {Promise}
+   */
+
+  async prune() {
+    let total = 0;
+
+    for (const segment of this.segments) total += segment.size;
+
+    while (this.segments.length > 1 && total > this.retention) {
+      const segment = this.segments.shift();
+
+      total -= segment.size;
+
+      await fs.unlink(this.file(segment.start));
+    }
+  }
+
+  /**
+   * Get the first offset still in the log.
+   * @returns {Number}
+   */
+
+  get start() {
+    return this.segments.length > 0 ? this.segments[0].start : 0;
+  }
+
+  /**
+   * Read entries from an offset.
+   * @param {Number} offset
+   * @param {Number} limit - Most entries to return.
+   * @returns {Promise} - Returns {entries: [offset, payload][], next}.
+   */
+
+  async read(offset, limit) {
+    assert(offset >= this.start, "Change log offset was dropped.");
+
+    const entries = [];
+
+    let next = offset;
+
+    for (const segment of this.segments) {
+      const end = segment.start + segment.size;
+
+      if (entries.length >= limit) break;
+
+      if (next >= end) continue;
+
+      if (next < segment.start) throw new Error("Not an entry offset.");
+
+      // Read up to the size known now, so an entry
+      // being appended is never read half written.
+      const fd = await fs.open(this.file(segment.start), "r");
+
+      try {
+        while (next < end && entries.length < limit) {
+          const header = await readAt(fd, next - segment.start, ENTRY_HEADER);
+          const size = header.readUInt32LE(0, true);
+          const pos = next - segment.start + ENTRY_HEADER;
+          const payload = await readAt(fd, pos, size);
+
+          if (!checksum(payload).equals(header.slice(4)))
+            throw new Error("Not an entry offset.");
+
+          entries.push([next, payload]);
+
+          next += ENTRY_HEADER + size;
+        }
+      } finally {
+        await fs.close(fd);
+      }
+    }
+
+    return { entries, next };
+  }
+}
+
+/**
+ * Block Changes
+ * One change log entry: what a connected block changed, or a
+ * rewind to a height.
+ * @alias module:nomenclate.BlockChanges
+ */
+
+class BlockChanges extends bio.Struct {
+  constructor() {
+    super();
+
+    this.type = types.CONNECT;
+    this.height = 0;
+    this.hash = ZERO_HASH;
+
+    // Address hash hex -> [hash, received, spent].
+    this.addresses = new Map();
+
+    // [txid, index, spending txid]
+    this.spends = [];
+
+    // [name hash, txid, index, covenant type]
+    this.names = [];
+  }
+
+  /**
+   * Start the changes of a block.
+   * @param {ChainEntry} entry
+   * @returns {BlockChanges}
+   */
+
+  static fromEntry(entry) {
+    const changes = new this();
+    changes.height = entry.height;
+    changes.hash = entry.hash;
+    return changes;
+  }
+
+  /**
+   * Record value paid to an address.
+   * @param {Buffer} hash
+   * @param {Number} value
+   */
+
+  receive(hash, value) {
+    this.getAddress(hash)[1] += value;
+  }
+
+  /**
+   * Record an outpoint spent, and the address it paid
+   * (when known).
+   * @param {Buffer} txid
+   * @param {Number} index
+   * @param {Buffer} spender
+   * @param {CoinRecord?} coin
+   */
+
+  spend(txid, index, spender, coin) {
+    this.spends.push([txid, index, spender]);
+
+    if (coin) this.getAddress(coin.hash)[2] += coin.value;
+  }
+
+  /**
+   * Record a name covenant.
+   * @param {Buffer} nameHash
+   * @param {Buffer} txid
+   * @param {Number} index
+   * @param {Number} type - Covenant type.
+   */
+
+  name(nameHash, txid, index, type) {
+    this.names.push([nameHash, txid, index, type]);
+  }
+
+  /**
+   * @private
+   * @param {Buffer} hash
+   * @returns {Array}
+   */
+
+  getAddress(hash) {
+    const hex = hash.toString("hex");
+
+    let delta = this.addresses.get(hex);
+
+    if (!delta) {
+      delta = [hash, 0, 0];
+      this.addresses.set(hex, delta);
+    }
+
+    return delta;
+  }
+
+  getSize() {
+    let size = 37;
+
+    size += bio.sizeVarint(this.addresses.size);
+
+    for (const [hash, received, spent] of this.addresses.values()) {
+      size += bio.sizeVarBytes(hash);
+      size += bio.sizeVarint2(received);
+      size += bio.sizeVarint2(spent);
+    }
+
+    size += bio.sizeVarint(this.spends.length);
+
+    for (const [, index] of this.spends) size += 64 + bio.sizeVarint2(index);
+
+    size += bio.sizeVarint(this.names.length);
+
+    for (const [, , index] of this.names) size += 65 + bio.sizeVarint2(index);
+
+    return size;
+  }
+
+  write(bw) {
+    bw.writeU8(this.type);
+    bw.writeU32(this.height);
+    bw.writeHash(this.hash);
+
+    bw.writeVarint(this.addresses.size);
+
+    for (const [hash, received, spent] of this.addresses.values()) {
+      bw.writeVarBytes(hash);
+      bw.writeVarint2(received);
+      bw.writeVarint2(spent);
+    }
+
+    bw.writeVarint(this.spends.length);
+
+    for (const [txid, index, spender] of this.spends) {
+      bw.writeHash(txid);
+      bw.writeVarint2(index);
+      bw.writeHash(spender);
+    }
+
+    bw.writeVarint(this.names.length);
+
+    for (const [nameHash, txid, index, type] of this.names) {
+      bw.writeHash(nameHash);
+      bw.writeHash(txid);
+      bw.writeVarint2(index);
+      bw.writeU8(type);
+    }
+
+    return bw;
+  }
+
+  read(br) {
+    this.type = br.readU8();
+    this.height = br.readU32();
+    this.hash = br.readHash();
+
+    let count = br.readVarint();
+
+    for (let i = 0; i < count; i++) {
+      const hash = br.readVarBytes();
+      this.addresses.set(hash.toString("hex"), [
+        hash,
+        br.readVarint2(),
+        br.readVarint2()
+      ]);
+    }
+
+    count = br.readVarint();
+
+    for (let i = 0; i < count; i++)
+      this.spends.push([br.readHash(), br.readVarint2(), br.readHash()]);
+
+    count = br.readVarint();
+
+    for (let i = 0; i < count; i++) {
+      this.names.push([
+        br.readHash(),
+        br.readHash(),
+        br.readVarint2(),
+        br.readU8()
+      ]);
+    }
+
+    return this;
+  }
+
+  getJSON() {
+    return {
+      type: this.type === types.CONNECT ? "connect" : "rewind",
+      height: this.height,
+      hash: this.hash.toString("hex"),
+      addresses: [...this.addresses.values()].map(
+        ([hash, received, spent]) => ({
+          hash: hash.toString("hex"),
+          received,
+          spent
+        })
+      ),
+      spends: this.spends.map(([txid, index, spender]) => ({
+        prevout: [txid.toString("hex"), index],
+        tx_hash: spender.toString("hex")
+      })),
+      names: this.names.map(([nameHash, txid, index, type]) => ({
+        name_hash: nameHash.toString("hex"),
+        tx_hash: txid.toString("hex"),
+        output_index: index,
+        covenant: type
+      }))
+    };
+  }
+}
+
+/*
+ * Helpers
+ */
+
+function checksum(payload) {
+  return blake2b.digest(payload).slice(0, 4);
+}
+
+function readEntry(data, pos) {
+  if (data.length - pos < ENTRY_HEADER) return null;
+
+  const size = data.readUInt32LE(pos, true);
+  const start = pos + ENTRY_HEADER;
+
+  if (data.length - start < size) return null;
+
+  const payload = data.slice(start, start + size);
+
+  if (!checksum(payload).equals(data.slice(pos + 4, start))) return null;
+
+  return payload;
+}
+
+async function readAt(fd, pos, size) {
+  const data = Buffer.allocUnsafe(size);
+  const read = await fs.read(fd, data, 0, size, pos);
+
+  if (read !== size) throw new Error("Not an entry offset.");
+
+  return data;
+}
+
+/*
+ * Expose
+ */
+
+ChangeLog.types = types;
+ChangeLog.BlockChanges = BlockChanges;
+
+module.exports = ChangeLog;
@@ -0,0 +1,238 @@
+/*!
+ * config.js - shared configuration for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const path = require("path");
+const RemoteClient = require("./remoteclient");
+const flags = require("./flags");
+
+/**
+ * Reads the options of each Nomenclate service from a config,
+ * for both the hsd plugin and the standalone daemon. Each
+ * function returns the options found in the config, which the
+ * caller extends with the objects it shares between services.
+ * @exports config
+ */
+
+const config = exports;
+
+/**
+ * Get the indexes to build.
+ * @param {Config} cfg
+ * @returns {Number}
+ */
+
+config.getFeatures = function getFeatures(cfg) {
+  let bits = 0;
+
+  for (const name of Object.keys(flags.names)) {
+    const bit = flags.names[name];
+
+    if (cfg.bool(`index-${name}`, (flags.DEFAULT & bit) !== 0)) bits |= bit;
+  }
+
+  // Pruned history is backed by the balance index.
+  if (cfg.uint("prune-depth", 0) > 0) bits |= flags.BALANCE;
+
+  return bits;
+};
+
+/**
+ * Create a remote client for each daemon in `node-hosts`,
+ * given as `host` or `host:port`.
+ * @param {Config} cfg
+ * @param {Network} network
+ * @returns {RemoteClient[]}
+ */
+
+config.createRemotes = function createRemotes(cfg, network) {
+  return cfg.array("node-hosts", []).map(addr => {
+    const [host, port] = addr.split(":");
+    const num = port ? parseInt(port, 10) : null;
+    return config.createRemote(cfg, network, host, num);
+  });
+};
+
+/**
+ * Create a remote client for a daemon.
+ * @param {Config} cfg
+ * @param {Network} network
+ * @param {String} host
+ * @param {Number|null} port
+ * @returns {RemoteClient}
+ */
+
+config.createRemote = function createRemote(cfg, network, host, port) {
+  return new RemoteClient({
+    network: network,
+    host: host,
+    port: port,
+    ssl: cfg.bool("node-ssl"),
+    apiKey: cfg.str("node-api-key"),
+    timeout: cfg.uint("node-timeout")
+  });
+};
+
+/**
+ * Get {@link MultiClient} options.
+ * @param {Config} cfg
+ * @returns {Object}
+ */
+
+config.multiOptions = function multiOptions(cfg) {
+  return {
+    timeout: cfg.uint("node-timeout"),
+    slowFactor: cfg.float("node-slow-factor"),
+    probeInterval: cfg.uint("node-probe-interval")
+  };
+};
+
+/**
+ * Get {@link NomenclateDB} options.
+ * @param {Config} cfg
+ * @param {String} prefix
+ * @param {Boolean} memory - Default for `memory`.
+ * @returns {Object}
+ */
+
+config.dbOptions = function dbOptions(cfg, prefix, memory) {
+  return {
+    memory: cfg.bool("memory", memory),
+    prefix: prefix,
+    maxFiles: cfg.uint("max-files"),
+    cacheSize: cfg.mb("cache-size"),
+    bulkWriteBuffer: cfg.mb("bulk-write-buffer"),
+    bulkFileSize: cfg.mb("bulk-file-size"),
+    shards: cfg.uint("shards"),
+    backend: cfg.str("backend"),
+    mapSize: cfg.mb("map-size"),
+    indexCacheSize: cfg.mb("index-cache-size"),
+    indexWriteBuffer: cfg.mb("index-write-buffer"),
+    indexFileSize: cfg.mb("index-file-size"),
+    metaCacheSize: cfg.mb("meta-cache-size"),
+    metaWriteBuffer: cfg.mb("meta-write-buffer"),
+    metaFileSize: cfg.mb("meta-file-size"),
+    metaCompression: cfg.bool("meta-compression"),
+    features: config.getFeatures(cfg),
+    addressFilter: cfg.bool("address-filter"),
+    addressFilterSize: cfg.mb("address-filter-size"),
+    hotCacheSize: cfg.mb("hot-cache-size"),
+    warmStart: cfg.bool("warm-start"),
+    changeLog: cfg.bool("change-log"),
+    changeLogSegmentSize: cfg.mb("change-log-segment-size"),
+    changeLogRetention: cfg.mb("change-log-retention"),
+    proofCacheBlocks: cfg.uint("proof-cache-blocks")
+  };
+};
+
+/**
+ * Get {@link BlockReader} options, or null if
+ * blocks are not read from block files.
+ * @param {Config} cfg
+ * @param {String} prefix
+ * @returns {Object|null}
+ */
+
+config.readerOptions = function readerOptions(cfg, prefix) {
+  if (!cfg.bool("bulk-reindex", false)) return null;
+
+  return {
+    location: cfg.path("block-files", path.join(prefix, "blocks")),
+    chunkSize: cfg.mb("block-chunk-size"),
+    maxPending: cfg.mb("block-max-pending")
+  };
+};
+
+/**
+ * Get {@link Indexer} options.
+ * @param {Config} cfg
+ * @param {Object} [defaults] - Defaults for `syncBatch`
+ * and `syncDepth`.
+ * @returns {Object}
+ */
+
+config.indexerOptions = function indexerOptions(cfg, defaults = {}) {
+  return {
+    syncBatch: cfg.uint("sync-batch", defaults.syncBatch),
+    syncDepth: cfg.uint("sync-depth", defaults.syncDepth),
+    snapshot: cfg.path("snapshot"),
+    bulkLoad: cfg.bool("bulk-load"),
+    bulkThreshold: cfg.uint("bulk-load-threshold"),
+    bulkBlocks: cfg.uint("bulk-load-blocks"),
+    reindex: cfg.bool("reindex"),
+    pruneDepth: cfg.uint("prune-depth"),
+    pruneBatch: cfg.uint("prune-batch")
+  };
+};
+
+/**
+ * Get HTTP server options, or null if disabled.
+ * @param {Config} cfg
+ * @param {String} [apiKey] - Default for `api-key`.
+ * @returns {Object|null}
+ */
+
+config.httpOptions = function httpOptions(cfg, apiKey) {
+  if (!cfg.bool("http-enabled", true)) return null;
+
+  return {
+    ssl: cfg.bool("ssl"),
+    keyFile: cfg.path("ssl-key"),
+    certFile: cfg.path("ssl-cert"),
+    host: cfg.str("http-host"),
+    port: cfg.uint("http-port"),
+    apiKey: cfg.str("api-key", apiKey),
+    noAuth: cfg.bool("no-auth"),
+    cors: cfg.bool("cors"),
+    txCacheSize: cfg.mb("tx-cache-size"),
+    txBatchSize: cfg.uint("tx-batch-size")
+  };
+};
+
+/**
+ * Get Electrum RPC server options, or null if disabled.
+ * @param {Config} cfg
+ * @returns {Object|null}
+ */
+
+config.rpcOptions = function rpcOptions(cfg) {
+  if (!cfg.bool("rpc-enabled", true)) return null;
+
+  return {
+    ssl: cfg.bool("rpc-ssl"),
+    keyFile: cfg.path("ssl-key"),
+    certFile: cfg.path("ssl-cert"),
+    host: cfg.str("rpc-host"),
+    port: cfg.uint("rpc-port"),
+    maxConnections: cfg.uint("rpc-max-connections"),
+    maxBatch: cfg.uint("rpc-max-batch")
+  };
+};
+
+/**
+ * Get binary server options, or null if disabled.
+ * @param {Config} cfg
+ * @param {String} [apiKey] - Default for `api-key`.
+ * @returns {Object|null}
+ */
+
+config.binaryOptions = function binaryOptions(cfg, apiKey) {
+  const grpc = cfg.bool("grpc-enabled", false);
+
+  if (!cfg.bool("binary-enabled", grpc)) return null;
+
+  return {
+    ssl: cfg.bool("binary-ssl"),
+    keyFile: cfg.path("ssl-key"),
+    certFile: cfg.path("ssl-cert"),
+    host: cfg.str("binary-host"),
+    port: cfg.uint("binary-port"),
+    apiKey: cfg.str("api-key", apiKey),
+    noAuth: cfg.bool("no-auth"),
+    maxConnections: cfg.uint("binary-max-connections")
+  };
+};
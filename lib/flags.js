@@ -0,0 +1,84 @@
+/*!
+ * flags.js - index flags for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+/**
+ * @exports flags
+ */
+
+const flags = exports;
+
+/**
+ * Address funding rows (`o`).
+ * @const {Number}
+ */
+
+flags.ADDRESS = 1 << 0;
+
+/**
+ * Spend rows (`i`, `t`).
+ * @const {Number}
+ */
+
+flags.SPEND = 1 << 1;
+
+/**
+ * Name history rows (`n`).
+ * @const {Number}
+ */
+
+flags.NAME = 1 << 2;
+
+/**
+ * Coin, address UTXO and balance aggregate rows (`c`, `u`, `a`).
+ * @const {Number}
+ */
+
+flags.BALANCE = 1 << 3;
+
+/**
+ * Every index.
+ * @const {Number}
+ */
+
+flags.ALL = flags.ADDRESS | flags.SPEND | flags.NAME | flags.BALANCE;
+
+/**
+ * Indexes built unless configured otherwise, and by
+ * databases from before the flags were recorded.
+ * @const {Number}
+ */
+
+flags.DEFAULT = flags.ADDRESS | flags.SPEND | flags.NAME;
+
+/**
+ * Index names, as used in the config and the HTTP API.
+ * @const {Object}
+ */
+
+flags.names = {
+  address: flags.ADDRESS,
+  spend: flags.SPEND,
+  name: flags.NAME,
+  balance: flags.BALANCE
+};
+
+/**
+ * Get the names of the indexes in a set of flags.
+ * @param {Number} bits
+ * @returns {String[]}
+ */
+
+flags.toNames = function toNames(bits) {
+  const names = [];
+
+  for (const name of Object.keys(flags.names)) {
+    if (bits & flags.names[name]) names.push(name);
+  }
+
+  return names;
+};
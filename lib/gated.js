@@ -0,0 +1,447 @@
+/*!
+ * gated.js - reopenable database handles for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+
+/**
+ * Gated DB
+ * Wraps a database handle, exposing the same subset of the
+ * `bdb` interface as {@link RoutedDB}, so that the handle can
+ * be closed and replaced while it is being served. Reads,
+ * writes and iterator reads are counted. A replacement stops
+ * new ones from starting, waits for those in flight, and
+ * then closes the old handle and opens the new one.
+ *
+ * Iterators only hold the handle while they read, since a
+ * reader may start other operations while it holds one open.
+ * Between reads they are ended by a replacement, and reopened
+ * on the new handle past the last key read. Iterators opened
+ * with `snapshot` hold the handle until they are done, so
+ * they keep reading from one snapshot.
+ * @alias module:nomenclate.GatedDB
+ */
+
+class GatedDB {
+  /**
+   * Create a gated database.
+   * @constructor
+   * @param {DB} db
+   */
+
+  constructor(db) {
+    assert(db && typeof db === "object");
+
+    this.db = db;
+
+    // Operations and iterators in flight.
+    this.active = 0;
+    this.waiting = [];
+
+    // Open iterators which can be reopened.
+    this.iters = new Set();
+
+    // Set while handles are closed and opened.
+    this.blocked = null;
+  }
+
+  /**
+   * Get the height committed on every store,
+   * for handles which are routed.
+   * @returns {Number}
+   */
+
+  get height() {
+    return this.db.height;
+  }
+
+  /**
+   * Wait for a replacement to finish, and count an operation.
+   * @private
+   * @returns {Promise}
+   */
+
+  async enter() {
+    while (this.blocked) await this.blocked;
+
+    this.active += 1;
+  }
+
+  /**
+   * Finish an operation.
+   * @private
+   */
+
+  leave() {
+    assert(this.active > 0);
+
+    this.active -= 1;
+
+    if (this.active > 0) return;
+
+    const waiting = this.waiting;
+
+    this.waiting = [];
+
+    for (const resolve of waiting) resolve();
+  }
+
+  /**
+   * Wait until nothing is in flight.
+   * @private
+   * @returns {Promise}
+   */
+
+  async drain() {
+    while (this.active > 0) {
+      await new Promise(resolve => this.waiting.push(resolve));
+    }
+  }
+
+  /**
+   * Run an operation on the current handle.
+   * @private
+   * @param {Function} fn
+   * @returns {Promise}
+   */
+
+  async run(fn) {
+    await this.enter();
+    try {
+      return await fn(this.db);
+    } finally {
+      this.leave();
+    }
+  }
+
+  /**
+   * Replace the handle once nothing is using it. The old
+   * handle is closed before the new one is opened, as both
+   * may use the same directory.
+   * @param {Function} open - Returns a Promise of an open DB.
+   * @returns {Promise}
+   */
+
+  async replace(open) {
+    assert(!this.blocked, "Database is already being replaced.");
+
+    let unblock;
+
+    // Blocked before draining, so nothing new
+    // starts on the handle about to be closed.
+    this.blocked = new Promise(resolve => {
+      unblock = resolve;
+    });
+
+    try {
+      await this.drain();
+
+      for (const iter of this.iters) await iter.detach();
+
+      await this.db.close();
+      this.db = await open();
+    } finally {
+      this.blocked = null;
+      unblock();
+    }
+  }
+
+  /**
+   * Open the handle.
+   * @returns {Promise}
+   */
+
+  async open() {
+    await this.db.open();
+  }
+
+  /**
+   * Close the handle once nothing is using it.
+   * @returns {Promise}
+   */
+
+  async close() {
+    await this.drain();
+
+    for (const iter of this.iters) await iter.detach();
+
+    await this.db.close();
+  }
+
+  /**
+   * Get a value.
+   * @param {Buffer} key
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async get(key) {
+    return this.run(db => db.get(key));
+  }
+
+  /**
+   * Test whether a key exists.
+   * @param {Buffer} key
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async has(key) {
+    return this.run(db => db.has(key));
+  }
+
+  /**
+   * Write a single value.
+   * @param {Buffer} key
+   * @param {Buffer} value
+   * @returns {Promise}
+   */
+
+  async put(key, value) {
+    return this.run(db => db.put(key, value));
+  }
+
+  /**
+   * Delete a single value.
+   * @param {Buffer} key
+   * @returns {Promise}
+   */
+
+  async del(key) {
+    return this.run(db => db.del(key));
+  }
+
+  /**
+   * Create a batch. Writes are applied to
+   * whichever handle is current when it is written.
+   * @returns {GatedBatch}
+   */
+
+  batch() {
+    return new GatedBatch(this);
+  }
+
+  /**
+   * Create an iterator. The handle is taken
+   * when it is first read from.
+   * @param {Object} options
+   * @returns {GatedIterator}
+   */
+
+  iterator(options) {
+    return new GatedIterator(this, options);
+  }
+
+  /**
+   * Compact a key range.
+   * @param {Buffer} start
+   * @param {Buffer} end
+   * @returns {Promise}
+   */
+
+  async compactRange(start, end) {
+    return this.run(db => db.compactRange(start, end));
+  }
+}
+
+/**
+ * Gated Batch
+ * @ignore
+ */
+
+class GatedBatch {
+  constructor(gate) {
+    this.gate = gate;
+    this.ops = [];
+  }
+
+  put(key, value) {
+    this.ops.push([key, value]);
+    return this;
+  }
+
+  del(key) {
+    this.ops.push([key, null]);
+    return this;
+  }
+
+  async write() {
+    const { ops } = this;
+
+    this.ops = [];
+
+    await this.gate.run(db => {
+      const b = db.batch();
+
+      for (const [key, value] of ops) {
+        if (value) b.put(key, value);
+        else b.del(key);
+      }
+
+      return b.write();
+    });
+  }
+
+  clear() {
+    this.ops = [];
+    return this;
+  }
+}
+
+/**
+ * Gated Iterator
+ * Enters the gate for each read, or from its first read
+ * until it is ended or runs out with `snapshot`.
+ * @ignore
+ */
+
+class GatedIterator {
+  constructor(gate, options) {
+    this.gate = gate;
+    this.options = options;
+    this.keys = options.keys !== false;
+    this.values = Boolean(options.values);
+    this.reverse = Boolean(options.reverse);
+    this.limit = options.limit != null ? options.limit : -1;
+    this.hold = Boolean(options.snapshot);
+    this.iter = null;
+    this.last = null;
+    this.done = false;
+    this.key = null;
+    this.value = null;
+  }
+
+  open() {
+    // Keys are needed to resume, and the limit is ours.
+    const options = Object.assign({}, this.options, { keys: true });
+
+    delete options.limit;
+
+    if (this.last) {
+      if (this.reverse) options.lte = this.last;
+      else options.gte = this.last;
+    }
+
+    this.iter = this.gate.db.iterator(options);
+
+    if (!this.hold) this.gate.iters.add(this);
+  }
+
+  async next() {
+    if (this.done) return false;
+
+    if (this.limit === 0) {
+      await this.end();
+      return false;
+    }
+
+    if (!this.hold || !this.iter) await this.gate.enter();
+
+    let more = false;
+
+    try {
+      if (!this.iter) this.open();
+
+      more = await this.iter.next();
+
+      // Reopened at the last key read.
+      if (more && this.last && this.iter.key.equals(this.last))
+        more = await this.iter.next();
+    } finally {
+      if (!more) this.release();
+      else if (!this.hold) this.gate.leave();
+    }
+
+    if (!more) return false;
+
+    this.key = this.iter.key;
+    this.value = this.iter.value;
+    this.last = this.key;
+
+    if (this.limit > 0) this.limit -= 1;
+
+    return true;
+  }
+
+  async each(cb) {
+    assert(typeof cb === "function");
+
+    try {
+      while (await this.next()) {
+        let result;
+
+        if (this.keys && this.values) result = await cb(this.key, this.value);
+        else if (this.keys) result = await cb(this.key);
+        else result = await cb(this.value);
+
+        // Stop early, as `bdb` does.
+        if (result === false) break;
+      }
+    } finally {
+      await this.end();
+    }
+  }
+
+  async end() {
+    if (this.done) return;
+
+    this.done = true;
+
+    if (!this.iter) {
+      this.gate.iters.delete(this);
+      return;
+    }
+
+    if (this.hold) {
+      const { iter } = this;
+
+      this.iter = null;
+
+      try {
+        await iter.end();
+      } finally {
+        this.gate.leave();
+      }
+
+      return;
+    }
+
+    // A replacement may detach it first.
+    await this.gate.run(() => this.detach());
+
+    this.gate.iters.delete(this);
+  }
+
+  /**
+   * End the underlying iterator between reads,
+   * to be reopened on the next one.
+   * @returns {Promise}
+   */
+
+  async detach() {
+    const { iter } = this;
+
+    this.iter = null;
+
+    if (iter) await iter.end();
+  }
+
+  /**
+   * Finish after running out, or failing, inside a read.
+   */
+
+  release() {
+    this.done = true;
+    this.iter = null;
+    this.gate.iters.delete(this);
+    this.gate.leave();
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = GatedDB;
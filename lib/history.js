@@ -0,0 +1,219 @@
+/*!
+ * history.js - address history streams for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+
+/**
+ * History Stream
+ * Reads the funding (`o`) or spend (`s`) rows of an address
+ * newest first (or oldest first), one transaction at a time,
+ * without values.
+ * @alias module:nomenclate.HistoryStream
+ */
+
+class HistoryStream {
+  /**
+   * Create a history stream.
+   * @constructor
+   * @param {DB} db
+   * @param {Object} key - `layout.o` or `layout.s`.
+   * @param {Buffer} hash - Address hash.
+   * @param {Number} startHeight - Oldest height to read.
+   * @param {Number} endHeight - Newest height to read.
+   * @param {Boolean} [reverse=true] - Newest first.
+   */
+
+  constructor(db, key, hash, startHeight, endHeight, reverse = true) {
+    assert(Buffer.isBuffer(hash));
+
+    this.key = key;
+    this.done = false;
+    this.iter = db.iterator({
+      gte: key.min(hash, startHeight),
+      lte: key.max(hash, endHeight),
+      reverse,
+      keys: true,
+      values: false
+    });
+  }
+
+  /**
+   * Read the next row.
+   * @returns {Promise} - Returns Object, or null at the end.
+   */
+
+  async next() {
+    if (this.done) return null;
+
+    if (!(await this.iter.next())) {
+      this.done = true;
+      return null;
+    }
+
+    const [, height, pos, txid] = this.key.decode(this.iter.key);
+
+    return { height, pos, txid };
+  }
+
+  /**
+   * Close the stream early.
+   * @returns {Promise}
+   */
+
+  async end() {
+    if (this.done) return;
+
+    this.done = true;
+
+    await this.iter.end();
+  }
+}
+
+/**
+ * History Merge
+ * Merges height ordered streams into one, newest first (or
+ * oldest first, if the streams are), by height and then
+ * position in the block, so the order is the
+ * same on every call. A transaction found in several streams
+ * (one which both pays to and spends from an address) is
+ * returned once. Only the head of each stream is held, so
+ * memory stays the same however long the history is.
+ * @alias module:nomenclate.HistoryMerge
+ */
+
+class HistoryMerge {
+  /**
+   * Create a merge.
+   * @constructor
+   * @param {HistoryStream[]} streams
+   * @param {Boolean} [reverse=true] - Newest first.
+   */
+
+  constructor(streams, reverse = true) {
+    assert(Array.isArray(streams));
+
+    this.streams = streams;
+    this.order = reverse ? 1 : -1;
+    this.heads = null;
+    this.last = null;
+  }
+
+  /**
+   * Read the next transaction.
+   * @returns {Promise} - Returns Object, or null at the end.
+   */
+
+  async next() {
+    const row = await this.nextRow();
+
+    if (!row) return null;
+
+    return {
+      tx_hash: row.txid.toString("hex"),
+      height: row.height
+    };
+  }
+
+  /**
+   * Read the next transaction as it is keyed, with the
+   * txid as a buffer and its position in the block.
+   * @returns {Promise} - Returns Object, or null at the end.
+   */
+
+  async nextRow() {
+    if (!this.heads)
+      this.heads = await Promise.all(this.streams.map(s => s.next()));
+
+    for (;;) {
+      let best = -1;
+
+      for (let i = 0; i < this.heads.length; i++) {
+        const head = this.heads[i];
+
+        if (!head) continue;
+
+        if (best === -1 || compare(head, this.heads[best]) * this.order > 0)
+          best = i;
+      }
+
+      if (best === -1) return null;
+
+      const head = this.heads[best];
+
+      this.heads[best] = await this.streams[best].next();
+
+      if (this.last && compare(head, this.last) === 0) continue;
+
+      this.last = head;
+
+      return head;
+    }
+  }
+
+  /**
+   * Skip transactions.
+   * @param {Number} count
+   * @returns {Promise} - Returns Number skipped.
+   */
+
+  async skip(count) {
+    let skipped = 0;
+
+    while (skipped < count && (await this.next())) skipped += 1;
+
+    return skipped;
+  }
+
+  /**
+   * Read up to `limit` transactions.
+   * @param {Number} limit
+   * @returns {Promise} - Returns Object[].
+   */
+
+  async take(limit) {
+    const items = [];
+
+    while (items.length < limit) {
+      const item = await this.next();
+
+      if (!item) break;
+
+      items.push(item);
+    }
+
+    return items;
+  }
+
+  /**
+   * Close every stream.
+   * @returns {Promise}
+   */
+
+  async end() {
+    await Promise.all(this.streams.map(s => s.end()));
+  }
+}
+
+/*
+ * Helpers
+ */
+
+function compare(a, b) {
+  if (a.height !== b.height) return a.height - b.height;
+
+  if (a.pos !== b.pos) return a.pos - b.pos;
+
+  return a.txid.compare(b.txid);
+}
+
+/*
+ * Expose
+ */
+
+exports.HistoryStream = HistoryStream;
+exports.HistoryMerge = HistoryMerge;
@@ -0,0 +1,433 @@
+/*!
+ * hotcache.js - hot address cache for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+
+/*
+ * Constants
+ */
+
+// Rough in-memory sizes of the cached objects, in bytes.
+const ENTRY_SIZE = 160;
+const FUNDING_SIZE = 200;
+const SPENT_SIZE = 280;
+const AGGREGATE_SIZE = 64;
+const OUTPOINT_SIZE = 120;
+
+// Largest share of the cache a single result may take, so
+// that one large address does not evict every other one.
+const MAX_SHARE = 1 / 8;
+
+/**
+ * Hot Cache
+ * A memory bounded LRU of decoded address lookups (funding
+ * outputs, spends and balance totals), keyed by address hash.
+ * A few addresses take most of the reads, so they are served
+ * from memory. Connected blocks update cached addresses in
+ * place rather than evicting them (unless a result outgrows
+ * its share), and anything else which rewrites the index
+ * resets the cache.
+ * @alias module:nomenclate.HotCache
+ */
+
+class HotCache {
+  /**
+   * Create a hot cache.
+   * @constructor
+   * @param {Number} capacity - Size in bytes.
+   */
+
+  constructor(capacity) {
+    assert(Number.isSafeInteger(capacity) && capacity > 0);
+
+    this.capacity = capacity;
+    this.size = 0;
+
+    // In access order, least recently used first.
+    this.entries = new Map();
+
+    // Unspent funding outputs of cached addresses,
+    // with the address they pay, by outpoint.
+    this.outpoints = new Map();
+
+    // Bumped on every update, so that lookups which
+    // raced with a block are not cached.
+    this.generation = 0;
+
+    // Height of the index the cached rows were read
+    // from, and of the last block applied to them.
+    this.height = -1;
+
+    this.hits = 0;
+    this.misses = 0;
+    this.updates = 0;
+    this.evictions = 0;
+    this.skipped = 0;
+  }
+
+  /**
+   * Get a cached result, marking the address as used.
+   * @param {Buffer} hash - Address hash.
+   * @param {String} field - `funding`, `spent` or `aggregate`.
+   * @returns {Array|Object|null}
+   */
+
+  get(hash, field) {
+    const key = hash.toString("hex");
+    const entry = this.entries.get(key);
+
+    if (!entry || entry[field] == null) {
+      this.misses += 1;
+      return null;
+    }
+
+    this.entries.delete(key);
+    this.entries.set(key, entry);
+
+    this.hits += 1;
+
+    return entry[field];
+  }
+
+  /**
+   * Cache a result read at `generation`. Spends are only
+   * cached alongside the funding outputs they were read for.
+   * @param {Buffer} hash - Address hash.
+   * @param {String} field - `funding`, `spent` or `aggregate`.
+   * @param {Array|Object} value
+   * @param {Number} generation
+   */
+
+  set(hash, field, value, generation) {
+    if (generation !== this.generation) return;
+
+    const key = hash.toString("hex");
+
+    let entry = this.entries.get(key);
+
+    if (field === "spent" && (!entry || !entry.funding)) return;
+
+    if (sizeOf(field, value) > this.capacity * MAX_SHARE) {
+      // Not cached, and nothing older is kept in its place.
+      if (entry) this.evict(key, entry);
+      this.skipped += 1;
+      return;
+    }
+
+    if (!entry) {
+      entry = new CacheEntry();
+      this.size += ENTRY_SIZE;
+    } else {
+      this.entries.delete(key);
+    }
+
+    this.entries.set(key, entry);
+
+    if (entry[field] != null) this.unset(key, entry, field);
+
+    entry[field] = value;
+
+    switch (field) {
+      case "funding":
+        for (const output of value) this.addOutpoint(key, output);
+        this.size += value.length * FUNDING_SIZE;
+        break;
+      case "spent":
+        for (const spent of value) this.removeOutpoint(key, spent);
+        this.size += value.length * SPENT_SIZE;
+        break;
+      case "aggregate":
+        this.size += AGGREGATE_SIZE;
+        break;
+    }
+
+    this.compact();
+  }
+
+  /**
+   * Drop a cached result.
+   * @private
+   * @param {String} key
+   * @param {CacheEntry} entry
+   * @param {String} field
+   */
+
+  unset(key, entry, field) {
+    const value = entry[field];
+
+    if (value == null) return;
+
+    switch (field) {
+      case "funding":
+        for (const output of value) this.removeOutpoint(key, output);
+        this.size -= value.length * FUNDING_SIZE;
+        break;
+      case "spent":
+        this.size -= value.length * SPENT_SIZE;
+        break;
+      case "aggregate":
+        this.size -= AGGREGATE_SIZE;
+        break;
+    }
+
+    entry[field] = null;
+  }
+
+  /**
+   * Track a funding output so its spend can be cached.
+   * @private
+   * @param {String} key
+   * @param {Object} output
+   */
+
+  addOutpoint(key, output) {
+    this.outpoints.set(toOutpoint(output), { key, output });
+    this.size += OUTPOINT_SIZE;
+  }
+
+  /**
+   * @private
+   * @param {String} key
+   * @param {Object} output
+   */
+
+  removeOutpoint(key, output) {
+    const outpoint = toOutpoint(output);
+    const item = this.outpoints.get(outpoint);
+
+    if (!item || item.key !== key) return;
+
+    this.outpoints.delete(outpoint);
+    this.size -= OUTPOINT_SIZE;
+  }
+
+  /**
+   * Evict the least recently used addresses until
+   * the cache is within its capacity.
+   * @private
+   */
+
+  compact() {
+    for (const [key, entry] of this.entries) {
+      if (this.size <= this.capacity) break;
+
+      this.evict(key, entry);
+    }
+  }
+
+  /**
+   * Evict an address whose cached result has grown
+   * past the share a single result may take.
+   * @private
+   * @param {String} key
+   * @param {CacheEntry} entry
+   * @param {String} field
+   */
+
+  limit(key, entry, field) {
+    if (sizeOf(field, entry[field]) <= this.capacity * MAX_SHARE) return;
+
+    this.evict(key, entry);
+    this.skipped += 1;
+  }
+
+  /**
+   * Evict an address.
+   * @private
+   * @param {String} key
+   * @param {CacheEntry} entry
+   */
+
+  evict(key, entry) {
+    this.unset(key, entry, "funding");
+    this.unset(key, entry, "spent");
+    this.unset(key, entry, "aggregate");
+
+    this.entries.delete(key);
+    this.size -= ENTRY_SIZE;
+    this.evictions += 1;
+  }
+
+  /**
+   * Update the cached addresses touched by a connected block,
+   * from the same rows which were just written for it. Blocks
+   * at or below the last one applied (replayed on restart)
+   * are already in the cached rows and are ignored.
+   * @param {Block} block
+   * @param {Number} height
+   * @param {Map?} totals - Balance totals written for the block.
+   */
+
+  connect(block, height, totals) {
+    if (height <= this.height) return;
+
+    this.height = height;
+    this.generation += 1;
+
+    for (const tx of block.txs) {
+      const txid = tx.txid();
+
+      for (const input of tx.inputs) {
+        if (input.isCoinbase()) continue;
+
+        const { prevout } = input;
+        const outpoint = toOutpoint({
+          tx_hash: prevout.txid(),
+          output_index: prevout.index
+        });
+
+        const item = this.outpoints.get(outpoint);
+
+        if (!item) continue;
+
+        this.outpoints.delete(outpoint);
+        this.size -= OUTPOINT_SIZE;
+
+        const { key, output } = item;
+        const entry = this.entries.get(key);
+
+        if (!entry || !entry.spent) continue;
+
+        entry.spent.push({
+          tx_hash: txid,
+          height,
+          funding_output: [output.tx_hash, output.output_index],
+          value: output.value
+        });
+
+        this.size += SPENT_SIZE;
+        this.updates += 1;
+
+        this.limit(key, entry, "spent");
+      }
+
+      for (let i = 0; i < tx.outputs.length; i++) {
+        const output = tx.outputs[i];
+        const key = output.address.getHash("hex");
+        const entry = this.entries.get(key);
+
+        if (!entry || !entry.funding) continue;
+
+        const funding = {
+          tx_hash: txid,
+          height,
+          output_index: i,
+          value: output.value
+        };
+
+        if (this.outpoints.has(toOutpoint(funding))) continue;
+
+        entry.funding.push(funding);
+
+        this.addOutpoint(key, funding);
+        this.size += FUNDING_SIZE;
+        this.updates += 1;
+
+        this.limit(key, entry, "funding");
+      }
+    }
+
+    if (totals) {
+      for (const [key, agg] of totals) {
+        // Totals which were already applied were not written.
+        if (agg.skip) continue;
+
+        const entry = this.entries.get(key);
+
+        if (!entry || !entry.aggregate) continue;
+
+        const { received, spent, count } = agg;
+
+        entry.aggregate = { received, spent, count };
+
+        this.updates += 1;
+      }
+    }
+
+    this.compact();
+  }
+
+  /**
+   * Drop every cached address.
+   * @param {Number} height - Height of the index.
+   */
+
+  reset(height) {
+    assert(Number.isSafeInteger(height));
+
+    this.entries.clear();
+    this.outpoints.clear();
+    this.size = 0;
+    this.height = height;
+    this.generation += 1;
+  }
+
+  /**
+   * Get cache statistics.
+   * @returns {Object}
+   */
+
+  getStats() {
+    const lookups = this.hits + this.misses;
+
+    return {
+      addresses: this.entries.size,
+      size: this.size,
+      capacity: this.capacity,
+      hits: this.hits,
+      misses: this.misses,
+      hitRate: lookups > 0 ? this.hits / lookups : 0,
+      updates: this.updates,
+      evictions: this.evictions,
+      skipped: this.skipped
+    };
+  }
+}
+
+/**
+ * Cache Entry
+ * @ignore
+ */
+
+class CacheEntry {
+  constructor() {
+    this.funding = null;
+    this.spent = null;
+    this.aggregate = null;
+  }
+}
+
+/*
+ * Helpers
+ */
+
+function toOutpoint(output) {
+  const [hash, index] = output.funding_output || [
+    output.tx_hash,
+    output.output_index
+  ];
+
+  return hash + ":" + index.toString(10);
+}
+
+function sizeOf(field, value) {
+  switch (field) {
+    case "funding":
+      return value.length * (FUNDING_SIZE + OUTPOINT_SIZE);
+    case "spent":
+      return value.length * SPENT_SIZE;
+    default:
+      return AGGREGATE_SIZE;
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = HotCache;
@@ -0,0 +1,232 @@
+/*!
+ * hotkeys.js - access frequency summary for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const fs = require("bfile");
+const bio = require("bufio");
+const blake2b = require("bcrypto/lib/blake2b");
+
+/*
+ * Constants
+ */
+
+const MAGIC = 0x6e6d686b;
+const VERSION = 0;
+
+/**
+ * Kinds of keys tracked, and how many of each are kept.
+ * @enum {Number}
+ */
+
+const limits = {
+  address: 10000,
+  name: 2000,
+  // Header ranges of `HEADER_RANGE` blocks.
+  header: 1024
+};
+
+const KINDS = Object.keys(limits);
+
+const HEADER_RANGE = 1024;
+
+/**
+ * Hot Keys
+ * Counts lookups of addresses, names and header ranges, keeping
+ * only the most used of each. Counts are halved whenever a kind
+ * is trimmed, so old favourites fade out. The summary is saved
+ * on shutdown and used to warm the caches on the next start.
+ * @alias module:nomenclate.HotKeys
+ */
+
+class HotKeys {
+  /**
+   * Create a hot key summary.
+   * @constructor
+   */
+
+  constructor() {
+    this.counts = {};
+
+    for (const kind of KINDS) this.counts[kind] = new Map();
+  }
+
+  /**
+   * Count a lookup.
+   * @param {String} kind - `address`, `name` or `header`.
+   * @param {Buffer|Number} key - Hash, or header height.
+   */
+
+  record(kind, key) {
+    const counts = this.counts[kind];
+
+    assert(counts, "Unknown key kind.");
+
+    if (kind === "header") key = Math.floor(key / HEADER_RANGE);
+    else key = key.toString("hex");
+
+    counts.set(key, (counts.get(key) || 0) + 1);
+
+    if (counts.size > limits[kind] * 2) this.trim(kind);
+  }
+
+  /**
+   * Keep the most used keys of a kind and halve their counts.
+   * @private
+   * @param {String} kind
+   */
+
+  trim(kind) {
+    const top = this.top(kind);
+    const counts = new Map();
+
+    for (const [key, count] of top) {
+      if (count > 1) counts.set(key, count >>> 1);
+    }
+
+    this.counts[kind] = counts;
+  }
+
+  /**
+   * Get the most used keys of a kind, most used first.
+   * @param {String} kind
+   * @returns {Array[]} - [key, count] pairs.
+   */
+
+  top(kind) {
+    const entries = [...this.counts[kind]];
+
+    entries.sort((a, b) => b[1] - a[1]);
+
+    return entries.slice(0, limits[kind]);
+  }
+
+  /**
+   * Get the most used header ranges.
+   * @returns {Array[]} - [start, end] heights.
+   */
+
+  headerRanges() {
+    return this.top("header").map(([range]) => [
+      range * HEADER_RANGE,
+      (range + 1) * HEADER_RANGE - 1
+    ]);
+  }
+
+  /**
+   * Write the summary to a file.
+   * @param {String} file
+   * @param {Network} network
+   * @returns {Promise}
+   */
+
+  async save(file, network) {
+    const bw = bio.write(this.getSize());
+
+    bw.writeU32(MAGIC);
+    bw.writeU8(VERSION);
+    bw.writeU32(network.magic);
+
+    for (const kind of KINDS) {
+      const top = this.top(kind);
+
+      bw.writeU32(top.length);
+
+      for (const [key, count] of top) {
+        if (kind === "header") bw.writeU32(key);
+        else bw.writeVarBytes(Buffer.from(key, "hex"));
+
+        bw.writeU32(count);
+      }
+    }
+
+    const body = bw.render();
+
+    await fs.writeFile(
+      file + ".tmp",
+      Buffer.concat([body, blake2b.digest(body)])
+    );
+
+    await fs.rename(file + ".tmp", file);
+  }
+
+  /**
+   * Get the serialized size of the summary.
+   * @private
+   * @returns {Number}
+   */
+
+  getSize() {
+    let size = 9;
+
+    for (const kind of KINDS) {
+      size += 4;
+
+      for (const [key] of this.top(kind)) {
+        if (kind === "header") size += 4;
+        else size += bio.sizeVarBytes(Buffer.from(key, "hex"));
+
+        size += 4;
+      }
+    }
+
+    return size;
+  }
+
+  /**
+   * Read a summary saved by {@link HotKeys#save}. Missing
+   * or unusable files leave the summary empty.
+   * @param {String} file
+   * @param {Network} network
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async load(file, network) {
+    if (!(await fs.exists(file))) return false;
+
+    const raw = await fs.readFile(file);
+
+    if (raw.length < 9 + 32) return false;
+
+    const body = raw.slice(0, raw.length - 32);
+
+    if (!blake2b.digest(body).equals(raw.slice(raw.length - 32))) return false;
+
+    const br = bio.read(body);
+
+    if (br.readU32() !== MAGIC) return false;
+    if (br.readU8() !== VERSION) return false;
+    if (br.readU32() !== network.magic) return false;
+
+    for (const kind of KINDS) {
+      const counts = new Map();
+      const total = br.readU32();
+
+      for (let i = 0; i < total; i++) {
+        let key;
+
+        if (kind === "header") key = br.readU32();
+        else key = br.readVarBytes().toString("hex");
+
+        counts.set(key, br.readU32());
+      }
+
+      this.counts[kind] = counts;
+    }
+
+    return true;
+  }
+}
+
+/*
+ * Expose
+ */
+
+HotKeys.limits = limits;
+HotKeys.HEADER_RANGE = HEADER_RANGE;
+
+module.exports = HotKeys;
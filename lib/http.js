@@ -7,6 +7,8 @@
 
 "use strict";
 
+const path = require("path");
+const fs = require("bfile");
 const { Server } = require("bweb");
 const Network = require("hsd").protocol.Network;
 const Validator = require("bval");
@@ -18,11 +20,147 @@ const version = require("../package.json").version;
 const protocol = require("../package.json").protocol;
 const bio = require("bufio");
 const util = require("./util.js");
+const flags = require("./flags");
+const { BlockChanges } = require("./changelog");
+const TXCache = require("./txcache");
+const TXGraph = require("./txgraph");
+const { JSONWriter, schema, compile } = require("./serializer");
 const rules = require("hsd/lib/covenants/rules");
 const Amount = require("hsd/lib/ui/amount");
 
 const { Address, TX } = require("hsd");
 
+const { TXEntry } = TXCache;
+
+// Transactions looked up at once for a batch.
+const TX_FETCH_CONCURRENCY = 8;
+
+// Largest transaction graph walk.
+const MAX_GRAPH_DEPTH = 10;
+const MAX_GRAPH_FANOUT = 1000;
+const MAX_GRAPH_LIMIT = 10000;
+
+/*
+ * Serializers
+ * Compiled for the responses which are asked for most, and
+ * which are the same as `res.json` would send, less the
+ * whitespace.
+ */
+
+const ADDRESS_JSON = schema.object({
+  version: schema.number,
+  hash: schema.hex
+});
+
+// Called with {entry, height, time, coinbase, hex}, see `sendTX`.
+const TX_JSON = schema.object({
+  txid: schema.get(tx => tx.hash(), schema.hex),
+  hash: schema.get(tx => tx.witnessHash(), schema.hex),
+  size: schema.get(tx => tx.getSize(), schema.number),
+  vsize: schema.get(tx => tx.getVirtualSize(), schema.number),
+  version: schema.number,
+  locktime: schema.number,
+  vin: schema.get(
+    tx => tx.inputs,
+    schema.array(
+      schema.object({
+        coinbase: schema.get((input, ctx) => ctx.coinbase, schema.bool),
+        txid: schema.get(input => input.prevout.hash, schema.hex),
+        vout: schema.get(input => input.prevout.index, schema.number),
+        txinwitness: schema.get(
+          input => input.witness.items,
+          schema.array(schema.hex)
+        ),
+        sequence: schema.number,
+        link: schema.optional(schema.json)
+      })
+    )
+  ),
+  vout: schema.get(
+    tx => tx.outputs,
+    schema.array(
+      schema.object({
+        value: schema.get(
+          output => Amount.coin(output.value, true),
+          schema.number
+        ),
+        n: schema.get((output, ctx, i) => i, schema.number),
+        address: ADDRESS_JSON,
+        covenant: schema.object({
+          type: schema.number,
+          action: schema.get(
+            covenant => rules.typesByVal[covenant.type],
+            schema.string
+          ),
+          items: schema.array(schema.hex)
+        })
+      })
+    )
+  ),
+  blockhash: schema.get(
+    (tx, { entry }) => (entry ? entry.hash : null),
+    schema.hex
+  ),
+  confirmations: schema.get(
+    (tx, { entry, height }) => (entry ? height - entry.height + 1 : 0),
+    schema.number
+  ),
+  time: schema.get((tx, { time }) => time, schema.number),
+  blocktime: schema.get(
+    (tx, { entry }) => (entry ? entry.time : 0),
+    schema.number
+  ),
+  hex: schema.optional(
+    schema.get((tx, ctx) => (ctx.hex ? tx.encode() : undefined), schema.hex)
+  )
+});
+
+const HISTORY_JSON = schema.object({
+  total: schema.number,
+  offset: schema.number,
+  limit: schema.number,
+  pruned_height: schema.number,
+  result: schema.array(
+    schema.object({
+      tx_hash: schema.hex,
+      height: schema.number
+    })
+  )
+});
+
+const UNSPENT_JSON = schema.object({
+  total: schema.number,
+  offset: schema.number,
+  limit: schema.number,
+  result: schema.array(
+    schema.object({
+      tx_hash: schema.hex,
+      height: schema.number,
+      tx_pos: schema.number,
+      value: schema.number
+    })
+  )
+});
+
+// Transactions of a batch, by `getTXJSON`.
+const TX_HEXES_JSON = schema.object({
+  result: schema.array(schema.object({ hex: schema.hex }))
+});
+
+// Verbose transactions of a batch, as rendered by `txToJSON`
+// (and kept in the transaction cache).
+const TXS_JSON = schema.object({
+  result: schema.array(schema.json)
+});
+
+const serializers = {
+  tx: compile(TX_JSON),
+  history: compile(HISTORY_JSON),
+  unspent: compile(UNSPENT_JSON),
+  txHexes: compile(TX_HEXES_JSON),
+  txs: compile(TXS_JSON)
+};
+
 /**
  * HTTP
  * @alias module:nomenclate.HTTP
@@ -42,14 +180,20 @@ class HTTP extends Server {
     this.logger = this.options.logger.context("http-nomenclate");
     this.ndb = this.options.ndb;
     this.client = this.options.client;
+    this.indexer = this.options.indexer;
     this.host = this.options.host;
     this.port = this.options.port;
     this.ssl = this.options.ssl;
-    this.node = this.options.node;
-    // this.chain = this.node.chain;
-    //
-    this.fees = this.node.fees;
-    this.mempool = this.node.mempool;
+
+    // Output buffer for the compiled serializers.
+    this.writer = new JSONWriter();
+
+    this.graph = new TXGraph(this.ndb, this.client);
+
+    this.txCache = null;
+
+    if (this.options.txCacheSize > 0)
+      this.txCache = new TXCache(this.options.txCacheSize);
 
     this.init();
   }
@@ -71,6 +215,9 @@ class HTTP extends Server {
       );
     });
 
+    if (this.txCache && this.indexer)
+      this.indexer.on("tip", height => this.txCache.tip(height));
+
     this.on("listening", address => {
       this.logger.info(
         "Nomenclate HTTP server listening on %s (port=%d).",
@@ -139,6 +286,7 @@ class HTTP extends Server {
 
       if (cp_height == 0) {
         res.json(200, { header: header.toString("hex") });
+        return;
       }
 
       enforce(
@@ -153,19 +301,15 @@ class HTTP extends Server {
         "Checkpoint can't be greater than current chain height"
       );
 
-      let hashes = [];
-
-      for (let i = 0; i <= cp_height; i++) {
-        let hash = await this.ndb.getHashByHeight(i);
-        hashes.push(hash);
-      }
-
-      let [branches, root] = util.branchesAndRoot(hashes, height);
+      const { branch, root } = await this.ndb.proofs.headerProof(
+        height,
+        cp_height
+      );
 
       res.json(200, {
-        branch: branches,
+        branch,
         header: header.toString("hex"),
-        root: root.toString("hex")
+        root
       });
     });
 
@@ -218,23 +362,16 @@ class HTTP extends Server {
         "Checkpoint can't be greater than current chain height"
       );
 
-      let hashes = [];
-
-      for (let i = 0; i <= cp_height; i++) {
-        let hash = await this.ndb.getHashByHeight(i);
-        hashes.push(hash);
-      }
-
-      let [branches, root] = util.branchesAndRoot(
-        hashes,
-        startHeight + (count - 1)
+      const { branch, root } = await this.ndb.proofs.headerProof(
+        startHeight + (count - 1),
+        cp_height
       );
 
       res.json(200, {
         count: headers.length,
         hex: headers.join(""),
-        branch: branches,
-        root: root.toString("hex"),
+        branch,
+        root,
         max: MAX
       });
     });
@@ -247,7 +384,7 @@ class HTTP extends Server {
       //Number of blocks TODO have a default.
       const blocksCount = valid.u32("blocks_count", 0);
 
-      const fee = this.fees.estimateFee(blocksCount);
+      const fee = await this.client.estimateFee(blocksCount);
       res.json(200, { fee: fee });
     });
 
@@ -270,15 +407,22 @@ class HTTP extends Server {
       //Check if is valid, if not return error - enforce
       let addr = Address.fromString(hash, this.network);
 
-      let txs = this.mempool.getTXByAddress(addr);
+      let txs = await this.client.getMempoolTXs(addr);
+
+      res.json(200, { result: txs.map(tx => tx.txid()) });
+    });
 
-      let history = this.mempool.getHistory();
+    this.get("/nomenclate/address/:hash/status", async (req, res) => {
+      const valid = Validator.fromRequest(req);
 
-      console.log(history);
+      let hash = valid.str("hash");
 
-      console.log(txs);
+      requireStatus(this.ndb);
 
-      res.json(200, {});
+      //Check if is valid, if not return error - enforce
+      let addr = Address.fromString(hash, this.network);
+
+      res.json(200, { status: await this.ndb.addressStatus(addr) });
     });
 
     this.get("/nomenclate/address/:hash/unspent", async (req, res) => {
@@ -288,6 +432,9 @@ class HTTP extends Server {
       let limit = valid.u32("limit", 25);
       let offset = valid.u32("offset", 0);
 
+      // Read from the balance index when there is one.
+      if (!this.ndb.hasIndex("balance")) requireIndex(this.ndb, "address");
+
       let end = offset + limit;
 
       //Check if is valid, if not return error - enforce
@@ -301,7 +448,12 @@ class HTTP extends Server {
 
       let result = txs.slice(offset, end);
 
-      res.json(200, { total, offset, limit, result });
+      this.sendJSON(res, serializers.unspent, {
+        total,
+        offset,
+        limit,
+        result
+      });
     });
 
     /*
@@ -318,11 +470,138 @@ class HTTP extends Server {
       const tx = TX.decode(raw);
 
       //TODO see if there is a way to determine if it already exists. and then return an enforce
-      await this.node.sendTX(tx);
+      await this.client.sendTX(tx);
 
       res.json(200, { hash: tx.txid() });
     });
 
+    //Transactions -> Batch
+    //Looks up to `tx-batch-size` transactions at once, in the order
+    //given, with null for those which are not found.
+    this.post("/nomenclate/transactions", async (req, res) => {
+      const valid = Validator.fromRequest(req);
+      const txids = valid.array("txids");
+      const verbose = valid.bool("verbose", false);
+
+      enforce(txids, "txids is required.");
+      enforce(txids.length <= this.options.txBatchSize, "Too many txids.");
+
+      for (const txid of txids)
+        enforce(isHash(txid), "txids must be transaction hashes.");
+
+      const result = await this.getTXJSONs(
+        txids.map(txid => txid.toLowerCase()),
+        verbose
+      );
+
+      const serialize = verbose ? serializers.txs : serializers.txHexes;
+
+      this.sendJSON(res, serialize, { result });
+    });
+
+    //Transactions -> Proof
+    //Everything a light client needs to verify a transaction: the
+    //transaction, its merkle branch, its block's header and, with
+    //`cp_height`, the header's branch to the checkpoint.
+    this.get("/nomenclate/transaction/:hash/proof", async (req, res) => {
+      const valid = Validator.fromRequest(req);
+      const hash = valid.str("hash");
+      const cp_height = valid.u32("cp_height", 0);
+
+      enforce(isHash(hash), "Invalid transaction hash.");
+
+      await checkCheckpoint(this.ndb, cp_height);
+
+      const txid = Buffer.from(hash, "hex");
+      const proof = await this.ndb.proofs.txProof(txid, cp_height);
+
+      enforce(proof, "Transaction not found or unconfirmed.");
+
+      enforce(
+        cp_height === 0 || proof.block_height <= cp_height,
+        "Checkpoint can't be before the transaction's block"
+      );
+
+      res.json(200, proof);
+    });
+
+    //Transactions -> Batch Proof
+    //Proofs for many transactions, in the order given, with null for
+    //those which are not found or unconfirmed. Blocks above
+    //`cp_height` have no header branch.
+    this.post("/nomenclate/transactions/proof", async (req, res) => {
+      const valid = Validator.fromRequest(req);
+      const txids = valid.array("txids");
+      const cp_height = valid.u32("cp_height", 0);
+
+      enforce(txids, "txids is required.");
+      enforce(txids.length <= this.options.txBatchSize, "Too many txids.");
+
+      for (const txid of txids)
+        enforce(isHash(txid), "txids must be transaction hashes.");
+
+      await checkCheckpoint(this.ndb, cp_height);
+
+      const result = await util.mapLimit(txids, TX_FETCH_CONCURRENCY, txid =>
+        this.ndb.proofs.txProof(Buffer.from(txid, "hex"), cp_height)
+      );
+
+      res.json(200, { result });
+    });
+
+    //Transactions -> Graph
+    //Follows funds from a transaction, back through the outputs it
+    //spends and forward through the transactions which spent its
+    //outputs, as edges of [funding txid, output index, spending txid].
+    this.get("/nomenclate/transaction/:hash/graph", async (req, res) => {
+      const valid = Validator.fromRequest(req);
+      const hash = valid.str("hash");
+      const direction = valid.str("direction", "both");
+      const depth = valid.u32("depth", 3);
+      const fanout = valid.u32("fanout", 50);
+      const limit = valid.u32("limit", 1000);
+
+      enforce(isHash(hash), "Invalid transaction hash.");
+      enforce(
+        ["ancestors", "descendants", "both"].includes(direction),
+        "Direction must be ancestors, descendants or both."
+      );
+      enforce(depth > 0 && depth <= MAX_GRAPH_DEPTH, "Invalid depth.");
+      enforce(fanout > 0 && fanout <= MAX_GRAPH_FANOUT, "Invalid fanout.");
+      enforce(limit > 0 && limit <= MAX_GRAPH_LIMIT, "Invalid limit.");
+
+      if (direction !== "ancestors") requireIndex(this.ndb, "spend");
+
+      const txid = Buffer.from(hash, "hex");
+      const result = { txid: hash, ancestors: null, descendants: null };
+
+      let truncated = false;
+
+      for (const name of ["ancestors", "descendants"]) {
+        if (direction !== "both" && direction !== name) continue;
+
+        const walk = await this.graph.walk(txid, {
+          descendants: name === "descendants",
+          depth,
+          fanout,
+          limit
+        });
+
+        result[name] = walk.edges.map(([from, index, to]) => [
+          from.toString("hex"),
+          index,
+          to.toString("hex")
+        ]);
+
+        truncated = truncated || walk.truncated;
+      }
+
+      result.pruned_height = this.ndb.pruneHeight;
+      result.truncated = truncated;
+
+      res.json(200, result);
+    });
+
     //TODO revamp this entirely.
     this.get("/nomenclate/transaction/:hash", async (req, res) => {
       const valid = Validator.fromRequest(req);
@@ -330,7 +609,7 @@ class HTTP extends Server {
       const verbose = valid.bool("verbose", false);
       const merkle = valid.bool("merkle", false);
 
-      const meta = await this.node.getMeta(Buffer.from(hash, "hex"));
+      const meta = await this.client.getMeta(Buffer.from(hash, "hex"));
 
       enforce(meta, "Transaction not found");
 
@@ -371,10 +650,13 @@ class HTTP extends Server {
         }
       } else {
         if (!merkle) {
-          const json = this.txToJSON(tx, entry);
-          json.time = meta.mtime;
-          json.hex = tx.toHex();
-          res.json(200, json);
+          this.sendJSON(res, serializers.tx, tx, {
+            entry,
+            height: this.client.getTip().height,
+            time: meta.mtime,
+            coinbase: tx.isCoinbase(),
+            hex: true
+          });
           return;
         } else {
           let entry = await this.client.getEntry(meta.height);
@@ -502,12 +784,112 @@ class HTTP extends Server {
       features.protocol_min = protocol[0];
       features.server_version = "Nomenclate " + version;
 
-      //XXX Need to implement pruning.
-      // features.pruning =
+      features.indexes = {};
+
+      for (const name of Object.keys(flags.names))
+        features.indexes[name] = this.ndb.hasIndex(name);
+
+      if (this.indexer) {
+        features.skipped = {
+          rows: this.indexer.skipped.rows,
+          bytes: this.indexer.skipped.bytes
+        };
+      }
+
+      // Height below which address history has been pruned.
+      features.pruning = this.ndb.pruned ? this.ndb.pruneHeight : null;
 
       res.json(200, features);
     });
 
+    //Server -> Stats
+    //Hot address cache and address filter statistics.
+    this.get("/nomenclate/stats", async (req, res) => {
+      const stats = {
+        height: this.ndb.height,
+        cache: this.ndb.cache ? this.ndb.cache.getStats() : null,
+        txCache: this.txCache ? this.txCache.getStats() : null,
+        filter: null
+      };
+
+      if (this.ndb.filter) {
+        stats.filter = {
+          ready: this.ndb.filter.ready,
+          addresses: this.ndb.filter.count,
+          rate: this.ndb.filter.getRate()
+        };
+      }
+
+      res.json(200, stats);
+    });
+
+    //Server -> Changes
+    //Reads the change log from an offset. Consumers keep the `next`
+    //offset returned and read from it again.
+    this.get("/nomenclate/changes", async (req, res) => {
+      const valid = Validator.fromRequest(req);
+      const offset = valid.u64("offset", 0);
+      const limit = valid.u32("limit", 100);
+
+      enforce(limit <= 1000, "Limit too large.");
+
+      requireChanges(this.ndb, offset);
+
+      const { changes } = this.ndb;
+
+      let result;
+
+      try {
+        result = await changes.read(offset, limit);
+      } catch (e) {
+        enforce(false, e.message);
+      }
+
+      const { entries, next } = result;
+
+      res.json(200, {
+        offset,
+        next,
+        end: changes.offset,
+        entries: entries.map(([offset, payload]) =>
+          Object.assign({ offset }, BlockChanges.decode(payload).getJSON())
+        )
+      });
+    });
+
+    //Server -> Snapshot
+    //Writes a snapshot of the index to <prefix>/snapshots, which can be
+    //used to bootstrap another instance with the `snapshot` option.
+    this.post("/nomenclate/snapshot", async (req, res) => {
+      const { prefix, memory } = this.ndb.options;
+
+      enforce(prefix && !memory, "Snapshots require a persistent database.");
+      enforce(this.indexer, "Snapshots are not available.");
+      enforce(!this.indexer.exporting, "Already exporting a snapshot.");
+
+      const dir = path.join(prefix, "snapshots");
+
+      await fs.mkdirp(dir);
+
+      const file = path.join(dir, "nomenclate-" + util.now() + ".snap");
+
+      this.indexer.startExport(file);
+
+      res.json(200, { file, exporting: true });
+    });
+
+    //Server -> Reindex
+    //Rebuilds the index alongside the current one, which keeps serving
+    //until the new one has caught up and is swapped in.
+    this.post("/nomenclate/reindex", async (req, res) => {
+      enforce(this.indexer, "Reindexing is not available.");
+      enforce(!this.indexer.rebuilding, "Already reindexing.");
+
+      this.indexer.startRebuild();
+
+      res.json(200, { rebuilding: true });
+    });
+
     //Server -> Ping
     this.get("/nomenclate/ping", async (req, res) => {
       res.json(200, {});
@@ -525,33 +907,61 @@ class HTTP extends Server {
       let hash = valid.str("hash");
       let limit = valid.u32("limit", 10);
       let offset = valid.u32("offset", 0);
+      let verbose = valid.bool("verbose", false);
 
-      let end = offset + limit;
+      if (verbose) {
+        requireIndex(this.ndb, "address");
+        enforce(limit <= this.options.txBatchSize, "Limit too large.");
+      }
 
-      let txs;
+      if (!this.ndb.hasSegments()) requireIndex(this.ndb, "address");
+
+      const pruned = this.ndb.pruneHeight;
+      const startHeight = valid.u32("start_height", pruned);
+
+      requireUnpruned(startHeight, pruned);
 
       let addr = Address.fromString(hash, this.network);
 
-      try {
-        txs = await this.ndb.addressHistory(addr);
-      } catch (e) {
-        res.json(400);
-        return;
-      }
+      // Newest first, one row per transaction.
+      const page = await this.ndb.addressHistoryPage(
+        addr,
+        offset,
+        limit,
+        startHeight
+      );
 
-      //Return out of range if start is beyond array length.
-      if (offset > txs.length) {
+      //Return out of range if start is beyond the history.
+      if (page.total != null && offset > page.total) {
         res.json(416);
         return;
       }
 
-      txs = util.sortTXs(txs);
+      let result = page.result;
 
-      let total = txs.length;
+      // The rows already say what each transaction did for the
+      // address, so only the transactions themselves are fetched.
+      if (verbose) {
+        await this.ndb.addHistoryDetails(addr, result);
 
-      let result = txs.slice(offset, end);
+        const txs = await this.getTXJSONs(
+          result.map(row => row.tx_hash),
+          true
+        );
 
-      res.json(200, { total, offset, limit, result });
+        result = result.map((row, i) => this.historyToJSON(row, txs[i]));
+      }
+
+      const json = {
+        total: page.total,
+        offset,
+        limit,
+        pruned_height: pruned,
+        result
+      };
+
+      if (verbose) res.json(200, json);
+      else this.sendJSON(res, serializers.history, json);
 
       return;
     });
@@ -565,6 +975,8 @@ class HTTP extends Server {
       let offset = valid.u32("offset", 0);
       let full = valid.bool("full", false);
 
+      requireIndex(this.ndb, "name");
+
       let end = offset + limit;
 
       let txs;
@@ -602,9 +1014,19 @@ class HTTP extends Server {
       const valid = Validator.fromRequest(req);
 
       let hash = valid.str("hash");
+      let height = valid.u32("height");
 
       let addr = Address.fromString(hash, this.network);
 
+      // Balance as of a past block.
+      if (height != null) {
+        requireSegments(this.ndb);
+        res.json(200, await this.ndb.addressBalanceAt(addr, height));
+        return;
+      }
+
+      if (!this.ndb.hasIndex("balance")) requireIndex(this.ndb, "address");
+
       let balance;
 
       try {
@@ -620,6 +1042,162 @@ class HTTP extends Server {
     });
   }
 
+  /**
+   * Send a response with a compiled serializer.
+   * @private
+   * @param {Response} res
+   * @param {Function} serialize
+   * @param {Object} value
+   * @param {Object?} ctx
+   */
+
+  sendJSON(res, serialize, value, ctx) {
+    const writer = this.writer.reset();
+
+    serialize(writer, value, ctx);
+
+    writer.raw("\n");
+
+    res.send(200, writer.render(), "json");
+  }
+
+  /**
+   * Look up transactions, a few at a time, in the order given.
+   * @private
+   * @param {String[]} txids
+   * @param {Boolean} verbose
+   * @returns {Promise} - Returns Object[], with null if not found.
+   */
+
+  async getTXJSONs(txids, verbose) {
+    return util.mapLimit(txids, TX_FETCH_CONCURRENCY, txid =>
+      this.getTXJSON(txid, verbose)
+    );
+  }
+
+  /**
+   * Render an address history row with its transaction: every
+   * output with its covenant, every input, and marked those which
+   * paid to or spent from the address, with its net change.
+   * @private
+   * @param {Object} row - Row with its funding and spend details.
+   * @param {Object?} json - Verbose transaction.
+   * @returns {Object}
+   */
+
+  historyToJSON(row, json) {
+    const spent = new Map();
+    const paid = new Set();
+
+    let received = 0;
+    let sent = 0;
+
+    for (const [index, value] of row.outputs) {
+      paid.add(index);
+      received += value;
+    }
+
+    for (const [prev, index, value] of row.inputs) {
+      spent.set(prev.toString("hex") + ":" + index, value);
+      sent += value;
+    }
+
+    const result = {
+      tx_hash: row.tx_hash,
+      height: row.height,
+      received,
+      spent: sent,
+      net: received - sent,
+      confirmations: 0,
+      time: 0,
+      inputs: null,
+      outputs: null
+    };
+
+    if (!json) return result;
+
+    result.confirmations = json.confirmations;
+    result.time = json.time;
+
+    result.inputs = json.vin.map(input => {
+      const value = spent.get(input.txid + ":" + input.vout);
+
+      return {
+        prevout: input.coinbase ? null : [input.txid, input.vout],
+        mine: value != null,
+        value: value != null ? value : null
+      };
+    });
+
+    result.outputs = json.vout.map(output => {
+      const { covenant } = output;
+
+      return {
+        n: output.n,
+        value: Amount.value(output.value),
+        address: output.address,
+        mine: paid.has(output.n),
+        covenant:
+          covenant.action === "NONE"
+            ? null
+            : { action: covenant.action, name_hash: covenant.items[0] }
+      };
+    });
+
+    return result;
+  }
+
+  /**
+   * Look up a transaction for a batch. Confirmed transactions
+   * are kept in the transaction cache, serialized and rendered.
+   * Others are only rendered when asked for verbose.
+   * @private
+   * @param {String} txid
+   * @param {Boolean} verbose
+   * @returns {Promise} - Returns Object or null, with
+   * `hex` a Buffer unless verbose.
+   */
+
+  async getTXJSON(txid, verbose) {
+    let cached = this.txCache ? this.txCache.get(txid) : null;
+
+    if (!cached) {
+      const generation = this.txCache ? this.txCache.generation : 0;
+      const meta = await this.client.getMeta(Buffer.from(txid, "hex"));
+
+      if (!meta) return null;
+
+      const { tx } = meta;
+      const raw = tx.encode();
+      const cache = this.txCache != null && meta.height >= 0;
+
+      if (!verbose && !cache) return { hex: raw };
+
+      let entry = null;
+
+      if (meta.height >= 0) entry = await this.client.getEntry(meta.height);
+
+      const json = this.txToJSON(tx, entry);
+
+      json.time = meta.mtime;
+
+      cached = new TXEntry(raw, meta.height, json);
+
+      if (cache && entry) this.txCache.set(txid, cached, generation);
+    }
+
+    if (!verbose) return { hex: cached.raw };
+
+    const json = Object.assign({}, cached.json);
+
+    if (cached.height >= 0)
+      json.confirmations = this.client.getTip().height - cached.height + 1;
+
+    json.hex = cached.raw.toString("hex");
+
+    return json;
+  }
+
   //TODO move these to util or somewhere else.
   txToJSON(tx, entry) {
     let height = -1;
@@ -703,7 +1281,9 @@ class HTTPOptions {
   constructor(options) {
     this.network = Network.primary;
     this.logger = null;
-    this.node = null;
+    this.ndb = null;
+    this.client = null;
+    this.indexer = null;
     this.apiKey = base58.encode(random.randomBytes(20));
     this.apiHash = sha256.digest(Buffer.from(this.apiKey, "ascii"));
     this.adminToken = random.randomBytes(32);
@@ -718,6 +1298,8 @@ class HTTPOptions {
     this.ssl = false;
     this.keyFile = null;
     this.certFile = null;
+    this.txCacheSize = 16 << 20;
+    this.txBatchSize = 100;
 
     this.fromOptions(options);
   }
@@ -732,11 +1314,13 @@ class HTTPOptions {
   fromOptions(options) {
     assert(options);
     assert(
-      options.node && typeof options.node === "object",
+      options.ndb && typeof options.ndb === "object",
       "HTTP Server requires a NomenclateDB."
     );
-
-    this.node = options.node;
+    assert(
+      options.client && typeof options.client === "object",
+      "HTTP Server requires a chain client."
+    );
 
     if (options.network != null) this.network = Network.get(options.network);
 
@@ -755,6 +1339,11 @@ class HTTPOptions {
       this.client = options.client;
     }
 
+    if (options.indexer != null) {
+      assert(typeof options.indexer === "object");
+      this.indexer = options.indexer;
+    }
+
     if (options.logger != null) {
       assert(typeof options.logger === "object");
       this.logger = options.logger;
@@ -812,6 +1401,18 @@ class HTTPOptions {
       this.certFile = options.certFile;
     }
 
+    if (options.txCacheSize != null) {
+      assert(Number.isSafeInteger(options.txCacheSize));
+      assert(options.txCacheSize >= 0);
+      this.txCacheSize = options.txCacheSize;
+    }
+
+    if (options.txBatchSize != null) {
+      assert(options.txBatchSize >>> 0 === options.txBatchSize);
+      assert(options.txBatchSize > 0);
+      this.txBatchSize = options.txBatchSize;
+    }
+
     // Allow no-auth implicitly
     // if we're listening locally.
     if (!options.apiKey) {
@@ -844,8 +1445,75 @@ function enforce(value, msg) {
   }
 }
 
+function isHash(str) {
+  return typeof str === "string" && /^[0-9a-f]{64}$/i.test(str);
+}
+
+async function checkCheckpoint(ndb, height) {
+  if (height === 0) return;
+
+  enforce(
+    height <= (await ndb.getHeight()),
+    "Checkpoint can't be greater than current chain height"
+  );
+}
+
+function requireUnpruned(height, pruned) {
+  if (height < pruned) {
+    const err = new Error(
+      "History below height " + pruned + " has been pruned."
+    );
+    err.statusCode = 410;
+    throw err;
+  }
+}
+
+function requireIndex(ndb, ...names) {
+  if (!ndb.hasIndex(...names)) {
+    const err = new Error(
+      "This route needs the " + names.join(" and ") + " index."
+    );
+    err.statusCode = 404;
+    throw err;
+  }
+}
+
+function requireSegments(ndb) {
+  if (!ndb.hasSegments()) {
+    const err = new Error("This route needs the balance index.");
+    err.statusCode = 404;
+    throw err;
+  }
+}
+
+function requireChanges(ndb, offset) {
+  if (!ndb.changes) {
+    const err = new Error("The change log is not enabled.");
+    err.statusCode = 404;
+    throw err;
+  }
+
+  if (offset < ndb.changes.start) {
+    const err = new Error(
+      "Changes below offset " + ndb.changes.start + " have been dropped."
+    );
+    err.statusCode = 410;
+    throw err;
+  }
+}
+
+function requireStatus(ndb) {
+  if (!ndb.hasStatus()) {
+    const err = new Error("This route needs the address index.");
+    err.statusCode = 404;
+    throw err;
+  }
+}
+
 /*
  * Expose
  */
 
+HTTP.serializers = serializers;
+
 module.exports = HTTP;
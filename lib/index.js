@@ -16,5 +16,9 @@ const plugin = require("./plugin");
 exports = plugin;
 
 exports.plugin = plugin;
+exports.Nomenclate = require("./nomenclate");
+exports.ChainClient = require("./chainclient");
+exports.RemoteClient = require("./remoteclient");
+exports.MultiClient = require("./multiclient");
 
 module.exports = exports;
@@ -7,12 +7,39 @@
 "use strict";
 
 const EventEmitter = require("events");
+const path = require("path");
 const { Network } = require("hsd");
 const Logger = require("blgr");
 const assert = require("bsert");
 const { Lock } = require("bmutex");
 const layout = require("./layout.js");
 const util = require("./util.js");
+const flags = require("./flags");
+const SortedBatch = require("./batch");
+const ChainClient = require("./chainclient");
+const { BlockChanges } = require("./changelog");
+const {
+  CoinRecord,
+  FundingRecord,
+  SpendRecord,
+  HistoryRecord,
+  SegmentRecord,
+  StatusRecord,
+  SEGMENT_ROWS,
+  UnspentRecord,
+  AggregateRecord
+} = require("./records");
+
+/*
+ * Constants
+ */
+
+// Times to start a rebuild again after the chain reorganized.
+const REBUILD_ATTEMPTS = 3;
+
+// Fewest blocks a block by block sync must index
+// for its speed to be compared with bulk loads.
+const RATE_BLOCKS = 100;
 
 /**
  * Indexer
@@ -38,9 +65,25 @@ class Indexer extends EventEmitter {
     //TODO see if necessary
     // this.client = this.options.client || new NullClient(this);
     this.ndb = this.options.ndb;
+    this.reader = this.options.reader;
     this.height = 0;
+    this.pending = null;
+    this.pendingBlocks = 0;
+    this.pendingChanges = [];
+    this.rebuilding = false;
     this.lock = new Lock();
 
+    // Rows (and their bytes) not written
+    // because their index is disabled.
+    this.skipped = { rows: 0, bytes: 0 };
+
+    // Blocks per second of the last block by block sync.
+    this.blockRate = 0;
+
+    this.pruning = null;
+    this.exporting = false;
+    this.closing = false;
+
     this.init();
   }
 
@@ -89,7 +132,7 @@ class Indexer extends EventEmitter {
 
     this.client.bind("chain reset", async tip => {
       try {
-        await this.rollback(tip.height);
+        await this.resetChain(tip);
       } catch (e) {
         this.emit("error", e);
       }
@@ -103,308 +146,1602 @@ class Indexer extends EventEmitter {
   async open() {
     await this.ndb.verifyNetwork();
 
-    //Get tip of chain when starting
-    let tip = await this.client.getTip();
-
     //Height of internal database.
     this.height = await this.ndb.getHeight();
 
+    if (this.options.snapshot && this.height === 0)
+      await this.importSnapshot(this.options.snapshot);
+
+    //Connect to the daemon.
+    await this.connect();
+
+    const recovered = await this.recoverStores();
+
+    //Get tip of chain when starting. Remote
+    //clients only know it once connected.
+    const tip = this.client.getTip();
+
     this.logger.info(
       "Nomenclate initialized at height: %d, and chain tip: %d",
       this.height,
       tip.height
     );
 
-    //Connect to the daemon.
-    await this.connect();
+    // Balance and status rows are cumulative, so they can
+    // only be built from scratch rather than backfilled.
+    if (
+      !recovered ||
+      this.ndb.outdated ||
+      this.options.reindex ||
+      this.ndb.missing & (flags.ADDRESS | flags.BALANCE)
+    )
+      this.startRebuild();
+    else if (this.ndb.missing) this.startBackfill();
   }
 
   /**
-   * Placeholder
-   * @returns {Promise}
+   * Undo the blocks which a crash left on only some stores of
+   * a split or sharded index, before indexing resumes. Their
+   * rows would otherwise be served, and built on if the blocks
+   * have since been orphaned.
+   * @private
+   * @returns {Promise} - Returns false if a block could
+   * not be undone and the index has to be rebuilt.
    */
-  async close() {
-    await this.disconnect();
-    return;
+
+  async recoverStores() {
+    const top = this.ndb.getTopHeight();
+
+    if (top <= this.height) return true;
+
+    this.logger.warning(
+      "Undoing %d blocks written to some stores only before a crash.",
+      top - this.height
+    );
+
+    for (let height = top; height > this.height; height--) {
+      const hash = await this.ndb.getHashAhead(height);
+      const block = hash ? await this.client.getBlock(hash) : null;
+
+      if (!block) {
+        this.logger.warning("Block %d is no longer available to undo.", height);
+
+        await this.setHeight(this.height);
+
+        return false;
+      }
+
+      const b = this.ndb.rollbackBatch(height);
+
+      await this.removeBlock(this.ndb, b, { height, hash }, block);
+
+      this.ndb.putHeight(b, height - 1);
+
+      await b.write();
+    }
+
+    if (this.ndb.changes) await this.ndb.changes.rewind(this.height);
+
+    this.ndb.resetCache();
+
+    return true;
   }
 
   /**
-   * Connect to the node server (client required).
-   * @returns {Promise}
+   * Backfill newly enabled indexes in the background, reporting errors.
    */
-
-  async connect() {
-    return this.client.open();
+  startBackfill() {
+    this.backfill().catch(e => this.emit("error", e));
   }
 
   /**
-   * Disconnect from chain server (client required).
+   * Write the rows of newly enabled indexes for blocks which were
+   * indexed without them. New blocks already include them, so this
+   * only has to reach the height we were at when it started. The
+   * indexes are flagged as complete (and served) once it finishes.
    * @returns {Promise}
    */
+  async backfill() {
+    if (this.rebuilding) throw new Error("Nomenclate: Already rebuilding.");
 
-  async disconnect() {
-    return this.client.close();
+    const features = this.ndb.missing;
+    const end = this.height;
+
+    this.rebuilding = true;
+
+    const start = process.hrtime();
+    const b = this.ndb.sortedBatch();
+
+    let blocks = 0;
+    let reader = null;
+
+    try {
+      // Pruning stops once it sees we are rebuilding.
+      if (this.pruning) await this.pruning;
+
+      this.logger.info(
+        "Backfilling %s index to height %d.",
+        flags.toNames(features).join(", "),
+        end
+      );
+
+      reader = await this.takeReader();
+
+      const iter = async (entry, block) => {
+        await this.indexTX(this.ndb, b, entry, block, features);
+
+        if (++blocks >= this.options.bulkBlocks) {
+          await b.write();
+          blocks = 0;
+        }
+      };
+
+      await this.fetchBlocks(0, end, iter, reader);
+
+      await b.write();
+
+      await this.ndb.addFlags(features);
+    } finally {
+      await this.releaseReader(reader);
+      this.rebuilding = false;
+    }
+
+    const elapsed = process.hrtime(start);
+
+    this.logger.info("Backfill finished in %d seconds.", elapsed[0]);
   }
 
   /**
-   * Sync state with server on every connect.
+   * Rebuild the index in the background, reporting errors.
+   */
+  startRebuild() {
+    this.rebuild().catch(e => this.emit("error", e));
+  }
+
+  /**
+   * Build a fresh index in a shadow database while the current
+   * one keeps serving and indexing new blocks. Once the shadow is
+   * close to the tip, the last few blocks are indexed under the
+   * lock and the shadow is swapped in. Every block written to
+   * the shadow must link to the one before it, so a reorg while
+   * catching up (which would leave rows of orphaned blocks in
+   * the shadow) starts the rebuild again.
    * @returns {Promise}
    */
+  async rebuild() {
+    if (this.rebuilding) throw new Error("Nomenclate: Already rebuilding.");
+
+    this.rebuilding = true;
+
+    const start = process.hrtime();
 
-  async syncNode() {
-    const unlock = await this.lock.lock();
-    let start = process.hrtime();
     try {
-      this.logger.info("Resyncing from server...");
-      await this.syncChain();
+      // Pruning stops once it sees we are rebuilding, and must
+      // not write rows computed against the old index after
+      // the shadow is swapped in.
+      if (this.pruning) await this.pruning;
+
+      for (let attempt = 1; ; attempt++) {
+        if (await this.rebuildShadow()) break;
+
+        if (attempt >= REBUILD_ATTEMPTS)
+          throw new Error("Nomenclate: Chain kept reorganizing on rebuild.");
+
+        this.logger.warning("Chain reorganized during rebuild, restarting.");
+      }
     } finally {
-      // Add time here
-      let end = process.hrtime(start);
-      this.logger.info("Nomenclate fully synced in %d seconds", end[0]);
-      unlock();
+      this.rebuilding = false;
     }
+
+    const end = process.hrtime(start);
+
+    this.logger.info(
+      "NomenclateDB rebuilt to height %d in %d seconds.",
+      this.height,
+      end[0]
+    );
   }
 
   /**
-   * Connect and sync with the chain server.
+   * Build a shadow database and swap it in.
    * @private
-   * @returns {Promise}
+   * @returns {Promise} - Returns false if the chain reorganized.
    */
+  async rebuildShadow() {
+    const shadow = await this.ndb.openShadow();
 
-  async syncChain() {
-    return this.scan();
+    // The last block written to the shadow.
+    const chain = { height: -1, hash: null };
+
+    let reader = null;
+
+    try {
+      this.logger.info("Rebuilding NomenclateDB in the background.");
+
+      reader = await this.takeReader();
+
+      // Catch up without the lock.
+      for (;;) {
+        const tip = this.client.getTip();
+
+        if (tip.height - shadow.height <= this.options.syncBatch) break;
+
+        if (!(await this.scanShadow(shadow, tip.height, chain, reader))) {
+          await this.ndb.dropShadow(shadow);
+          return false;
+        }
+      }
+
+      // The last few blocks are fetched under the lock.
+      await this.releaseReader(reader);
+      reader = null;
+
+      const unlock = await this.lock.lock();
+      try {
+        if (!(await this.scanShadow(shadow, this.height, chain))) {
+          await this.ndb.dropShadow(shadow);
+          return false;
+        }
+
+        const ours = await this.ndb.getHeaders(this.height);
+        const theirs = await shadow.getHeaders(this.height);
+
+        if (!theirs || !ours.equals(theirs))
+          throw new Error("Nomenclate: Rebuilt index is on another chain.");
+
+        await this.ndb.swap(shadow);
+      } finally {
+        unlock();
+      }
+    } catch (e) {
+      await this.ndb.dropShadow(shadow);
+      throw e;
+    } finally {
+      await this.releaseReader(reader);
+    }
+
+    return true;
   }
 
   /**
-   * Rescan blockchain from a given height.
+   * Index blocks into a shadow database, up to a height.
    * @private
-   * @param {Number?} height
-   * @returns {Promise}
+   * @param {NomenclateDB} shadow
+   * @param {Number} height
+   * @param {Object} chain - Height and hash of the last block
+   * written, updated as blocks are written.
+   * @param {BlockReader?} reader - Read blocks from the block files.
+   * @returns {Promise} - Returns false if a block did not link
+   * to the last one written.
    */
+  async scanShadow(shadow, height, chain, reader) {
+    if (height < shadow.height) return true;
 
-  async scan(height) {
-    if (height == null) height = this.height;
+    const b = shadow.sortedBatch();
 
-    assert(height >>> 0 === height, "Nomenclate: Must pass in a height.");
+    let blocks = 0;
+    let linked = true;
 
-    const tip = await this.client.getTip();
+    const iter = async (entry, block) => {
+      // The first block fetched is the last one written again.
+      if (chain.hash) {
+        linked =
+          entry.height === chain.height
+            ? entry.hash.equals(chain.hash)
+            : block.prevBlock.equals(chain.hash);
+      }
 
-    if (tip.height < height) {
-      height = tip.height;
-    }
+      if (!linked) throw new Error("Nomenclate: Chain reorganized.");
 
-    await this.rollback(height);
+      chain.height = entry.height;
+      chain.hash = entry.hash;
 
-    this.logger.info(
-      "Nomenclate is scanning %d blocks.",
-      tip.height - height + 1
-    );
+      await this.writeBlock(shadow, b, entry, block);
 
-    for (let i = height; i <= tip.height; i++) {
-      const entry = await this.client.getEntry(i);
-      assert(entry);
+      if (++blocks >= this.options.bulkBlocks) {
+        await b.write();
+        blocks = 0;
+      }
+    };
 
-      const block = await this.client.getBlock(entry.hash);
-      assert(block);
+    try {
+      await this.fetchBlocks(shadow.height, height, iter, reader);
+    } catch (e) {
+      if (!linked) return false;
+      throw e;
+    }
 
-      const view = await this.client.getBlockView(block);
-      assert(view);
+    await b.write();
 
-      await this._indexBlock(entry, block, view);
-    }
+    return true;
   }
 
   /**
-   * Sync with chain height.
-   * @param {Number} height
+   * Bootstrap an empty index from a snapshot file, after
+   * checking the snapshot's tip against our own chain.
+   * @param {String} file
    * @returns {Promise}
    */
-  //TODO Untested.
-  async rollback(height) {
-    const tip = this.client.getTip();
+  async importSnapshot(file) {
+    const info = await this.ndb.readSnapshot(file);
 
-    if (height > tip.height)
-      throw new Error("Nomenclate: Cannot rollback to the future.");
+    const entry = await this.client.getEntry(info.height);
 
-    if (height === tip.height) {
-      this.logger.info("Rolled back to same height (%d).", height);
-      return;
+    if (!entry || !entry.hash.equals(info.hash)) {
+      throw new Error(
+        "Nomenclate: Snapshot tip is not in the main chain (" +
+          info.height +
+          ")."
+      );
     }
 
     this.logger.info(
-      "Rolling back %d NomenclateDB blocks to height %d.",
-      this.height - height,
-      height
+      "Importing %d rows from snapshot at height %d.",
+      info.rows,
+      info.height
     );
 
-    const entry = await this.client.getEntry(height);
+    const start = process.hrtime();
+
+    await this.ndb.importSnapshot(file, info);
+
+    const end = process.hrtime(start);
 
-    assert(entry);
+    this.height = info.height;
 
-    //TODO
-    // await this.revert(entry.height);
-    await this.setHeight(entry.height);
+    this.logger.info("Snapshot imported in %d seconds.", end[0]);
   }
 
-  // /**
-  // * Revert a block.
-  // * @param {Number} height
-  // * @returns {Promise}
-  // */
+  /**
+   * Export a snapshot in the background, reporting errors.
+   * @param {String} file
+   */
+  startExport(file) {
+    this.exportSnapshot(file).catch(e => this.emit("error", e));
+  }
+
+  /**
+   * Write a snapshot of the index. The lock is only held
+   * until every store's iterator has taken its snapshot, and
+   * pruning (which runs without the lock) is paused until
+   * the file is written.
+   * @param {String} file
+   * @returns {Promise} - Returns {height, rows}.
+   */
+  async exportSnapshot(file) {
+    if (this.exporting) throw new Error("Nomenclate: Already exporting.");
+
+    this.exporting = true;
+
+    let unlock = null;
 
-  //TODO implement this function
-  // async revert(height) {
-  // const block = await this.getBlock(height);
+    const release = () => {
+      if (unlock) unlock();
+      unlock = null;
+    };
 
-  // if (!block)
-  //   return 0;
+    try {
+      if (this.pruning) await this.pruning;
+
+      unlock = await this.lock.lock();
 
-  // const hashes = block.toArray();
+      const start = process.hrtime();
+      const result = await this.ndb.exportSnapshot(file, release);
+      const end = process.hrtime(start);
 
-  // for (let i = hashes.length - 1; i >= 0; i--) {
-  //   const hash = hashes[i];
-  //   await this.unconfirm(hash);
-  // }
+      this.logger.info(
+        "Snapshot of %d rows at height %d written to %s in %d seconds.",
+        result.rows,
+        result.height,
+        file,
+        end[0]
+      );
 
-  // return hashes.length;
-  // }
+      return result;
+    } finally {
+      release();
+      this.exporting = false;
+    }
+  }
 
   /**
-   * Set internal indexer height.
-   * @param {Number} height
+   * Placeholder
    * @returns {Promise}
    */
-  async setHeight(height) {
-    this.height = height;
+  async close() {
+    this.closing = true;
 
-    //Insert into DB.
-    await this.ndb.setHeight(height);
+    if (this.pruning) await this.pruning;
+
+    await this.disconnect();
 
     return;
   }
 
   /**
-   * Index a block with a lock
-   * @param (ChainEntry) entry
-   * @param (Block) block
-   * @param (CoinView) view
+   * Connect to the node server (client required).
    * @returns {Promise}
    */
 
-  async indexBlock(entry, block, view) {
+  async connect() {
+    return this.client.open();
+  }
+
+  /**
+   * Disconnect from chain server (client required).
+   * @returns {Promise}
+   */
+
+  async disconnect() {
+    return this.client.close();
+  }
+
+  /**
+   * Sync state with server on every connect.
+   * @returns {Promise}
+   */
+
+  async syncNode() {
     const unlock = await this.lock.lock();
+    let start = process.hrtime();
     try {
-      this.logger.info("Adding block: %d.", entry.height);
-      return await this._indexBlock(entry, block, view);
+      this.logger.info("Resyncing from server...");
+      await this.syncChain();
     } finally {
+      // Add time here
+      let end = process.hrtime(start);
+      this.logger.info("Nomenclate fully synced in %d seconds", end[0]);
+
+      if (this.skipped.rows > 0) {
+        this.logger.info(
+          "Skipped %d rows (%d MB) for disabled indexes.",
+          this.skipped.rows,
+          toMB(this.skipped.bytes)
+        );
+      }
+
       unlock();
     }
   }
 
   /**
-   * Index a block
-   * @param (ChainEntry) entry
-   * @param (Block) block
-   * @param (CoinView) view
+   * Connect and sync with the chain server.
+   * @private
    * @returns {Promise}
    */
 
-  async _indexBlock(entry, block, view) {
-    if (entry.height < this.height) {
-      this.logger.warning(
-        "Nomenclate is connecting low blocks (%d).",
-        entry.height
-      );
-      return;
-    }
+  async syncChain() {
+    const tip = this.client.getTip();
 
-    if (entry.height >= this.network.block.slowHeight)
-      // this.logger.debug("Adding block: %d.", entry.height);
-
-      //TODO review this code from wallet.
-      ////We may want to adjust this.
-      ////Right now it's running on every height, but I'm wondering if we want height to be +1
-      //if (block.height === this.height) {
-      //  // We let blocks of the same height
-      //  // through specifically for rescans:
-      //  // we always want to rescan the last
-      //  // block since the state may have
-      //  // updated before the block was fully
-      //  // processed (in the case of a crash).
-      //  this.logger.warning("Already saw Nomenclate block (%d).", block.height);
-      //} else if (block.height !== this.height + 1) {
-      //  await this.scan(this.height);
-      //  return 0;
-      //}
-
-      //TODO implement, and check if necessary
-      // if (this.options.checkpoints && !this.state.marked) {
-      //   if (block.height <= this.network.lastCheckpoint) return 0;
-      // }
-      //
-      await this.ndb.addHeaders(entry.toHeaders(), entry.height);
-
-    //if (this.standalone) {
-    //  //if we are standalone we want to save the block headers
-    //}
+    // Block files are read from the start, so they
+    // only help when indexing from scratch.
+    const reader = this.height === 0 ? await this.takeReader() : null;
+
+    try {
+      if (
+        this.options.bulkLoad &&
+        tip.height - this.height >= this.options.bulkThreshold
+      )
+        return await this.bulkScan(reader);
 
-    await this.indexTX(entry, block, view);
+      const start = process.hrtime();
+      const blocks = await this.scan(null, reader);
+      const elapsed = toSeconds(process.hrtime(start));
 
-    // Sync the new tip.
-    await this.setHeight(entry.height);
+      if (blocks >= RATE_BLOCKS && elapsed > 0)
+        this.blockRate = blocks / elapsed;
+
+      return undefined;
+    } finally {
+      await this.releaseReader(reader);
+    }
   }
 
   /**
-   * Index a transaction by txid.
+   * Open the block file reader for a pass over the chain from
+   * its start, if there is one and it is not already in use.
    * @private
-   * @param (ChainEntry) entry
-   * @param (Block) block
-   * @param (CoinView) view
+   * @returns {Promise} - Returns BlockReader or null.
    */
-  async indexTX(entry, block, view) {
-    const b = this.ndb.batch();
 
-    for (let tx of block.txs) {
-      let txid = Buffer.from(tx.txid(), "hex");
+  async takeReader() {
+    const reader = this.reader;
 
-      for (let input of tx.inputs) {
-        if (input.isCoinbase()) {
-          continue;
-        }
+    if (!reader) return null;
 
-        let previousHashPrefix = Buffer.from(input.prevout.txid(), "hex").slice(
-          0,
-          8
-        );
-        let previousIndex = input.prevout.index;
+    this.reader = null;
 
-        b.put(layout.i.encode(previousHashPrefix, previousIndex), txid);
-      }
+    try {
+      await reader.open();
+    } catch (e) {
+      this.reader = reader;
+      throw e;
+    }
 
-      //TODO see if parallizing the address indexing, and the name indexing will speed things up.
-      for (let output of tx.outputs) {
-        let address = Buffer.from(output.address.getHash(), "hex");
+    return reader;
+  }
 
-        if (output.covenant.isName()) {
-          b.put(
-            layout.n.encode(output.covenant.getHash(0), txid),
-            util.fromU32(entry.height)
-          );
-        }
+  /**
+   * Close the block file reader after a pass.
+   * @private
+   * @param {BlockReader?} reader
+   * @returns {Promise}
+   */
 
-        b.put(layout.o.encode(address, txid), util.fromU32(entry.height));
-      }
+  async releaseReader(reader) {
+    if (!reader) return;
 
-      b.put(layout.t.encode(txid), util.fromU32(entry.height));
+    try {
+      await reader.close();
+    } finally {
+      this.reader = reader;
     }
-
-    await b.write();
-
-    return;
   }
-}
 
-class IndexerOptions {
+  /**
+   * Catch up with the bulk load profile: blocks are buffered
+   * into large sorted batches and the database runs with big
+   * write buffers, then it is switched back to the serving
+   * profile and fully compacted.
+   * @private
+   * @param {BlockReader?} reader
+   * @returns {Promise}
+   */
+
+  async bulkScan(reader) {
+    const before = await this.ndb.getDiskSize();
+    const start = process.hrtime();
+    const from = this.height;
+
+    await this.ndb.setProfile("bulk");
+
+    this.pending = this.ndb.sortedBatch();
+    this.pendingBlocks = 0;
+
+    const stats = this.pending;
+
+    try {
+      await this.scan(null, reader);
+      await this.flush();
+    } finally {
+      this.pending = null;
+      this.pendingBlocks = 0;
+      this.pendingChanges = [];
+      await this.ndb.setProfile("serving");
+    }
+
+    const synced = process.hrtime(start);
+    const written = await this.ndb.getDiskSize();
+
+    await this.ndb.compact();
+
+    const compacted = process.hrtime(start);
+    const after = await this.ndb.getDiskSize();
+
+    const blocks = this.height - from;
+    const elapsed = toSeconds(synced);
+
+    // Block by block, every write collapsed here is made.
+    this.logger.info(
+      "Bulk load wrote %d MB for %d blocks in %d seconds " +
+        "(%d MB block by block).",
+      toMB(stats.size),
+      blocks,
+      synced[0],
+      toMB(stats.size + stats.saved)
+    );
+
+    if (this.blockRate > 0 && elapsed > 0) {
+      this.logger.info(
+        "Bulk load ran at %d blocks/s, against %d blocks/s for the last " +
+          "block by block sync (about %d seconds for these blocks).",
+        Math.round(blocks / elapsed),
+        Math.round(this.blockRate),
+        Math.round(blocks / this.blockRate)
+      );
+    }
+
+    this.logger.info(
+      "Database grew from %d MB to %d MB, %d MB after compaction (%d seconds).",
+      toMB(before),
+      toMB(written),
+      toMB(after),
+      compacted[0] - synced[0]
+    );
+  }
+
+  /**
+   * Log the changes of any blocks buffered by the bulk loader,
+   * then write them. As with single blocks, a batch lost after
+   * being logged is replayed on restart, which the log either
+   * recognises or rewinds over, and never leaves a gap.
+   * @private
+   * @returns {Promise}
+   */
+
+  async flush() {
+    if (!this.pending || this.pending.length === 0) return;
+
+    const changes = this.pendingChanges;
+
+    this.pendingChanges = [];
+
+    for (const entry of changes) await this.ndb.changes.connect(entry);
+
+    await this.pending.write();
+
+    this.pendingBlocks = 0;
+
+    // Too many blocks to update cached addresses from.
+    this.ndb.resetCache();
+  }
+
+  /**
+   * Rescan blockchain from a given height.
+   * @private
+   * @param {Number?} height
+   * @param {BlockReader?} reader - Read blocks from the block files.
+   * @returns {Promise} - Returns the number of blocks scanned.
+   */
+
+  async scan(height, reader) {
+    if (height == null) height = this.height;
+
+    assert(height >>> 0 === height, "Nomenclate: Must pass in a height.");
+
+    const tip = await this.client.getTip();
+
+    if (tip.height < height) {
+      height = tip.height;
+    }
+
+    await this.rollback(height);
+
+    // Rolling back may have gone below the fork.
+    height = Math.min(height, this.height);
+
+    const blocks = tip.height - height + 1;
+
+    this.logger.info("Nomenclate is scanning %d blocks.", blocks);
+
+    await this.fetchBlocks(
+      height,
+      tip.height,
+      (entry, block) => {
+        return this._indexBlock(entry, block, null);
+      },
+      reader
+    );
+
+    return blocks;
+  }
+
+  /**
+   * Fetch a range of blocks and pass them to `iter` in height
+   * order. Up to `sync-depth` batches of blocks are kept in
+   * flight while the oldest one is handled, so that fetching
+   * from the client overlaps with our own writes.
+   * @private
+   * @param {Number} start
+   * @param {Number} end
+   * @param {Function} iter - Called with (entry, block).
+   * @param {BlockReader?} reader - Read blocks from the block files.
+   * @returns {Promise}
+   */
+
+  async fetchBlocks(start, end, iter, reader) {
+    const source = reader || this.client;
+    const size = this.options.syncBatch;
+    const depth = this.options.syncDepth;
+    const queue = [];
+
+    let next = start;
+
+    const fill = () => {
+      while (queue.length < depth && next <= end) {
+        const last = Math.min(next + size - 1, end);
+        const blocks = source.getBlocks(next, last);
+
+        // Errors are surfaced when the batch is awaited.
+        blocks.catch(() => {});
+
+        queue.push(blocks);
+        next = last + 1;
+      }
+    };
+
+    fill();
+
+    while (queue.length > 0) {
+      const blocks = await queue.shift();
+
+      fill();
+
+      for (const [entry, block] of blocks) await iter(entry, block);
+    }
+  }
+
+  /**
+   * Roll back to a reset chain tip with a lock.
+   * @param {ChainEntry} tip
+   * @returns {Promise}
+   */
+
+  async resetChain(tip) {
+    const unlock = await this.lock.lock();
+    try {
+      return await this.rollback(tip.height);
+    } finally {
+      unlock();
+    }
+  }
+
+  /**
+   * Roll back to a height, or further down to where our blocks
+   * join the main chain. Blocks are unindexed one at a time,
+   * from the tip down, as balance and status rows are running
+   * totals which must be reverted rather than left behind. If
+   * a block can no longer be fetched, its totals cannot be
+   * reverted and the index is rebuilt.
+   * @param {Number} height
+   * @returns {Promise}
+   */
+
+  async rollback(height) {
+    const tip = this.client.getTip();
+
+    if (height > tip.height)
+      throw new Error("Nomenclate: Cannot rollback to the future.");
+
+    let fork = Math.min(height, this.height);
+
+    while (fork > 0 && !(await this.isMainChain(fork))) fork -= 1;
+
+    if (fork === this.height) {
+      this.logger.info("Rolled back to same height (%d).", height);
+      return;
+    }
+
+    this.logger.info(
+      "Rolling back %d NomenclateDB blocks to height %d.",
+      this.height - fork,
+      fork
+    );
+
+    while (this.height > fork) {
+      const hash = await this.ndb.getBlockHash(this.height);
+      const block = hash ? await this.client.getBlock(hash) : null;
+
+      if (!block) {
+        this.logger.warning(
+          "Block %d is no longer available to unindex.",
+          this.height
+        );
+
+        await this.setHeight(fork);
+
+        const totals = this.ndb.features & (flags.ADDRESS | flags.BALANCE);
+
+        if (totals && !this.rebuilding) this.startRebuild();
+
+        return;
+      }
+
+      await this._unindexBlock({ height: this.height, hash }, block, null);
+    }
+  }
+
+  /**
+   * Test whether the block we indexed at a height
+   * is still the main chain's block there.
+   * @private
+   * @param {Number} height
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async isMainChain(height) {
+    const hash = await this.ndb.getBlockHash(height);
+
+    if (!hash) return false;
+
+    const entry = await this.client.getEntry(height);
+
+    return entry != null && entry.hash.equals(hash);
+  }
+
+  /**
+   * Set internal indexer height.
+   * @param {Number} height
+   * @returns {Promise}
+   */
+  async setHeight(height) {
+    this.height = height;
+
+    if (this.ndb.changes) await this.ndb.changes.rewind(height);
+
+    //Insert into DB.
+    await this.ndb.setHeight(height);
+
+    return;
+  }
+
+  /**
+   * Index a block with a lock
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @param (CoinView) view
+   * @returns {Promise}
+   */
+
+  async indexBlock(entry, block, view) {
+    const unlock = await this.lock.lock();
+    try {
+      this.logger.info("Adding block: %d.", entry.height);
+      return await this._indexBlock(entry, block, view);
+    } finally {
+      unlock();
+    }
+  }
+
+  /**
+   * Index a block
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @param (CoinView) view
+   * @returns {Promise}
+   */
+
+  async _indexBlock(entry, block, view) {
+    if (entry.height < this.height) {
+      this.logger.warning(
+        "Nomenclate is connecting low blocks (%d).",
+        entry.height
+      );
+      return;
+    }
+
+    //TODO review this code from wallet.
+    ////We may want to adjust this.
+    ////Right now it's running on every height, but I'm wondering if we want height to be +1
+    //if (block.height === this.height) {
+    //  // We let blocks of the same height
+    //  // through specifically for rescans:
+    //  // we always want to rescan the last
+    //  // block since the state may have
+    //  // updated before the block was fully
+    //  // processed (in the case of a crash).
+    //  this.logger.warning("Already saw Nomenclate block (%d).", block.height);
+    //} else if (block.height !== this.height + 1) {
+    //  await this.scan(this.height);
+    //  return 0;
+    //}
+
+    //TODO implement, and check if necessary
+    // if (this.options.checkpoints && !this.state.marked) {
+    //   if (block.height <= this.network.lastCheckpoint) return 0;
+    // }
+
+    const b = this.pending || this.ndb.batch();
+    const changes = this.ndb.changes ? BlockChanges.fromEntry(entry) : null;
+
+    const { totals, touched } = await this.writeBlock(
+      this.ndb,
+      b,
+      entry,
+      block,
+      changes
+    );
+
+    this.height = entry.height;
+
+    if (this.pending) {
+      if (changes) this.pendingChanges.push(changes);
+      if (++this.pendingBlocks >= this.options.bulkBlocks) await this.flush();
+      return;
+    }
+
+    // Logged before the batch is written, so a block replayed
+    // after a crash is recognised rather than logged twice.
+    if (changes) await this.ndb.changes.connect(changes);
+
+    await b.write();
+
+    this.ndb.cacheBlock(block, entry.height, totals);
+
+    this.emit("tip", entry.height, touched);
+
+    this.maybePrune();
+  }
+
+  /**
+   * Unindex a block with a lock.
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @param (CoinView) view
+   * @returns {Promise}
+   */
+
+  async unindexBlock(entry, block, view) {
+    const unlock = await this.lock.lock();
+    try {
+      this.logger.info("Removing block: %d.", entry.height);
+      return await this._unindexBlock(entry, block, view);
+    } finally {
+      unlock();
+    }
+  }
+
+  /**
+   * Remove a disconnected block's rows and move the
+   * sync height back to its parent, in one batch.
+   * @private
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @param (CoinView) view
+   * @returns {Promise}
+   */
+
+  async _unindexBlock(entry, block, view) {
+    if (entry.height !== this.height) {
+      this.logger.warning(
+        "Nomenclate is disconnecting a block which is not its tip (%d).",
+        entry.height
+      );
+      return;
+    }
+
+    const b = this.ndb.batch();
+
+    await this.removeBlock(this.ndb, b, entry, block);
+
+    this.ndb.putHeight(b, entry.height - 1);
+
+    if (this.ndb.changes)
+      await this.ndb.changes.rewind(entry.height - 1, entry.hash);
+
+    await b.write();
+
+    this.ndb.resetCache();
+
+    this.height = entry.height - 1;
+
+    this.emit("tip", this.height);
+  }
+
+  /**
+   * Undo every row written by a block, except the sync height.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @returns {Promise}
+   */
+
+  async removeBlock(ndb, b, entry, block) {
+    const { features } = ndb;
+
+    if (features & flags.BALANCE)
+      await this.unindexBalance(ndb, b, entry, block);
+
+    if (features & flags.ADDRESS)
+      await this.unindexStatus(ndb, b, entry.height, block);
+
+    await this.removeHistory(ndb, b, entry.height, block, features, true);
+
+    for (const tx of block.txs) {
+      if (!(features & flags.NAME)) break;
+
+      const txid = Buffer.from(tx.txid(), "hex");
+
+      for (const output of tx.outputs) {
+        if (output.covenant.isName())
+          b.del(layout.n.encode(output.covenant.getHash(0), txid));
+      }
+    }
+
+    b.del(layout.h.encode(entry.height));
+  }
+
+  /**
+   * Delete the address and spend history rows written by a block.
+   * Coin rows are kept, unless the block itself is being undone.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (Number) height
+   * @param (Block) block
+   * @param (Number) features
+   * @param (Boolean) undo
+   * @returns {Promise}
+   */
+
+  async removeHistory(ndb, b, height, block, features, undo) {
+    const coins = getBlockCoins(block, height);
+
+    for (let pos = 0; pos < block.txs.length; pos++) {
+      const tx = block.txs[pos];
+      const txid = Buffer.from(tx.txid(), "hex");
+
+      if (features & flags.SPEND) {
+        for (const input of tx.inputs) {
+          if (input.isCoinbase()) continue;
+
+          const prefix = Buffer.from(input.prevout.txid(), "hex").slice(0, 8);
+
+          b.del(layout.i.encode(prefix, input.prevout.index));
+        }
+
+        b.del(layout.t.encode(txid));
+      }
+
+      if (features & flags.ADDRESS) {
+        for (const input of tx.inputs) {
+          if (input.isCoinbase()) continue;
+
+          const hash = Buffer.from(input.prevout.txid(), "hex");
+          const { index } = input.prevout;
+          const coin = await getCoin(ndb, b, coins, hash, index);
+
+          if (!coin) continue;
+
+          b.del(layout.s.encode(coin.hash, height, pos, txid));
+        }
+
+        for (let i = 0; i < tx.outputs.length; i++) {
+          const output = tx.outputs[i];
+          const address = Buffer.from(output.address.getHash(), "hex");
+
+          b.del(layout.o.encode(address, height, pos, txid));
+
+          if (undo) b.del(layout.c.encode(txid, i));
+        }
+      }
+    }
+  }
+
+  /**
+   * Start pruning in the background once enough blocks
+   * have fallen out of the pruning window.
+   * @private
+   */
+
+  maybePrune() {
+    const { pruneDepth, pruneBatch } = this.options;
+
+    if (!pruneDepth || this.pruning || this.rebuilding || this.closing) return;
+
+    if (this.exporting) return;
+
+    const target = this.height - pruneDepth;
+
+    if (target - this.ndb.pruneHeight < pruneBatch) return;
+
+    this.pruning = this.prune(target)
+      .catch(e => this.emit("error", e))
+      .then(() => {
+        this.pruning = null;
+      });
+  }
+
+  /**
+   * Delete address and spend history below a height, a few
+   * blocks per batch. Runs without the lock, since it only
+   * touches rows of blocks well below the tip, and yields
+   * between batches so indexing carries on. Stops between
+   * batches on shutdown, and when a rebuild or a snapshot
+   * export starts.
+   * @param {Number} target
+   * @returns {Promise}
+   */
+
+  async prune(target) {
+    const { pruneBatch } = this.options;
+    const features = this.ndb.features & (flags.ADDRESS | flags.SPEND);
+
+    while (
+      this.ndb.pruneHeight < target &&
+      !this.closing &&
+      !this.rebuilding &&
+      !this.exporting
+    ) {
+      const start = this.ndb.pruneHeight;
+      const end = Math.min(start + pruneBatch, target) - 1;
+      const blocks = await this.client.getBlocks(start, end);
+      const b = this.ndb.batch();
+
+      for (const [entry, block] of blocks) {
+        await this.removeHistory(
+          this.ndb,
+          b,
+          entry.height,
+          block,
+          features,
+          false
+        );
+      }
+
+      this.ndb.putPruneHeight(b, end + 1);
+
+      await b.write();
+
+      await new Promise(resolve => setImmediate(resolve));
+    }
+
+    this.logger.debug("Pruned history below height %d.", this.ndb.pruneHeight);
+  }
+
+  /**
+   * Add a block's header, index rows and height to a batch.
+   * The height is written in the same batch, so a block is
+   * always committed as a whole.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @param (BlockChanges?) changes - Filled in for the change log.
+   * @returns {Promise} - Returns {totals, touched}: the balance
+   * totals written and the addresses whose status changed, if
+   * those are indexed.
+   */
+
+  async writeBlock(ndb, b, entry, block, changes = null) {
+    let totals = null;
+
+    ndb.addHeaders(b, entry.toHeaders(), entry.height);
+
+    const touched = await this.indexTX(
+      ndb,
+      b,
+      entry,
+      block,
+      ndb.features,
+      changes
+    );
+
+    if (ndb.features & flags.BALANCE)
+      totals = await this.indexBalance(ndb, b, entry, block);
+
+    ndb.putHeight(b, entry.height);
+
+    return { totals, touched };
+  }
+
+  /**
+   * Index a block's transactions.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @param (Number) features - Indexes to write (see {@link flags}).
+   * @param (BlockChanges?) changes - Filled in for the change log.
+   * @returns {Promise} - Returns Set of the hex hashes of addresses
+   * whose status changed, or null without the address index.
+   */
+  async indexTX(ndb, b, entry, block, features = flags.ALL, changes = null) {
+    const { height } = entry;
+    const addresses = (features & flags.ADDRESS) !== 0;
+    const spends = (features & flags.SPEND) !== 0;
+    const names = (features & flags.NAME) !== 0;
+
+    // Only disabled indexes count as savings, not the
+    // indexes a backfill is leaving out.
+    const disabled = flags.ALL & ~this.ndb.features;
+
+    // Outputs created earlier in the block.
+    const coins = new Map();
+    const statuses = new Map();
+
+    for (let pos = 0; pos < block.txs.length; pos++) {
+      const tx = block.txs[pos];
+      const txid = Buffer.from(tx.txid(), "hex");
+      const funded = new Map();
+      const spent = new Map();
+
+      for (let input of tx.inputs) {
+        if (input.isCoinbase()) {
+          continue;
+        }
+
+        const hash = Buffer.from(input.prevout.txid(), "hex");
+        const { index } = input.prevout;
+
+        let coin = null;
+
+        if (addresses) {
+          coin = await getCoin(ndb, b, coins, hash, index);
+
+          // Outputs from before the address index are not known.
+          if (coin) {
+            const record = getRecord(spent, coin.hash, SpendRecord);
+            record.inputs.push([hash, index, coin.value]);
+          }
+        }
+
+        if (changes) changes.spend(hash, index, txid, coin);
+
+        if (!spends) {
+          if (disabled & flags.SPEND) this.skip(1, 1 + 9 + 4 + txid.length);
+          continue;
+        }
+
+        b.put(layout.i.encode(hash.slice(0, 8), index), txid);
+      }
+
+      //TODO see if parallizing the address indexing, and the name indexing will speed things up.
+      for (let i = 0; i < tx.outputs.length; i++) {
+        const output = tx.outputs[i];
+
+        const address = Buffer.from(output.address.getHash(), "hex");
+
+        ndb.addAddress(output.address.getHash());
+
+        if (changes) changes.receive(address, output.value);
+
+        if (output.covenant.isName()) {
+          if (changes) {
+            const nameHash = output.covenant.getHash(0);
+            changes.name(nameHash, txid, i, output.covenant.type);
+          }
+
+          if (names) {
+            b.put(
+              layout.n.encode(output.covenant.getHash(0), txid),
+              util.fromU32(height)
+            );
+          } else if (disabled & flags.NAME) {
+            this.skip(1, 1 + 33 + 33 + 4);
+          }
+        }
+
+        if (!addresses) {
+          if (disabled & flags.ADDRESS)
+            this.skip(2, 2 * (1 + output.address.hash.length + 45 + 12));
+          continue;
+        }
+
+        const coin = new CoinRecord(output.value, height, address);
+        const key = layout.c.encode(txid, i);
+
+        b.put(key, coin.encode());
+        coins.set(key.toString("hex"), coin);
+
+        getRecord(funded, address, FundingRecord).outputs.push([
+          i,
+          output.value
+        ]);
+      }
+
+      for (const record of funded.values())
+        b.put(layout.o.encode(record.hash, height, pos, txid), record.encode());
+
+      for (const record of spent.values())
+        b.put(layout.s.encode(record.hash, height, pos, txid), record.encode());
+
+      // Each address once per transaction, in block order.
+      for (const record of new Map([...funded, ...spent]).values()) {
+        const status = await getStatus(ndb, b, statuses, record.hash, height);
+
+        if (!status.skip) status.add(txid, height);
+      }
+
+      if (spends) b.put(layout.t.encode(txid), util.fromU32(height));
+      else if (disabled & flags.SPEND) this.skip(1, 1 + 33 + 4);
+    }
+
+    if (!addresses) return null;
+
+    await this.putStatuses(ndb, b, statuses, height);
+
+    return new Set(statuses.keys());
+  }
+
+  /**
+   * Write the status rows updated by a block. Blocks which can
+   * still be disconnected keep the previous rows as undo rows,
+   * and undo rows which have fallen out of that window go.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (Map) statuses
+   * @param (Number) height
+   * @returns {Promise}
+   */
+  async putStatuses(ndb, b, statuses, height) {
+    const { keepBlocks } = this.network.block;
+    const tip = this.client.getTip();
+    const undo = height + keepBlocks > tip.height;
+
+    for (const status of statuses.values()) {
+      if (status.skip) continue;
+
+      if (undo) {
+        b.put(
+          layout.E.encode(height, status.hash),
+          status.prev || Buffer.alloc(0)
+        );
+      }
+
+      status.height = height;
+
+      b.put(layout.e.encode(status.hash), status.encode());
+    }
+
+    if (height < keepBlocks) return;
+
+    const iter = ndb.db.iterator({
+      gte: layout.E.min(),
+      lte: layout.E.max(height - keepBlocks),
+      keys: true,
+      values: false
+    });
+
+    await iter.each(key => b.del(key));
+  }
+
+  /**
+   * Restore the status rows of addresses touched by a
+   * disconnected block from its undo rows. A block without
+   * undo rows (one indexed from far behind the tip) has its
+   * statuses hashed again from the history below it.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (Number) height
+   * @param (Block) block
+   * @returns {Promise}
+   */
+  async unindexStatus(ndb, b, height, block) {
+    let restored = 0;
+
+    const iter = ndb.db.iterator({
+      gte: layout.E.min(height),
+      lte: layout.E.max(height),
+      values: true
+    });
+
+    await iter.each((key, raw) => {
+      const [, hash] = layout.E.decode(key);
+
+      if (raw.length === 0) b.del(layout.e.encode(hash));
+      else b.put(layout.e.encode(hash), raw);
+
+      b.del(key);
+
+      restored += 1;
+    });
+
+    // Undo rows are written for every address of a
+    // block at once, so they are all there or none are.
+    if (restored > 0) return;
+
+    const hashes = new Map();
+
+    for (const tx of block.txs) {
+      for (const input of tx.inputs) {
+        if (input.isCoinbase()) continue;
+
+        const hash = Buffer.from(input.prevout.txid(), "hex");
+        const raw = await ndb.db.get(
+          layout.c.encode(hash, input.prevout.index)
+        );
+
+        if (raw) {
+          const coin = CoinRecord.decode(raw);
+          hashes.set(coin.hash.toString("hex"), coin.hash);
+        }
+      }
+
+      for (const output of tx.outputs) {
+        const hash = Buffer.from(output.address.getHash(), "hex");
+        hashes.set(hash.toString("hex"), hash);
+      }
+    }
+
+    for (const hash of hashes.values()) {
+      const key = layout.e.encode(hash);
+      const raw = await ndb.db.get(key);
+
+      if (!raw || StatusRecord.decode(raw).height < height) continue;
+
+      const status = await ndb.computeStatus(hash, height - 1);
+
+      if (status) b.put(key, status.encode());
+      else b.del(key);
+    }
+  }
+
+  /**
+   * Update the balance index for a block: every output gets a
+   * coin row and an address UTXO row, spent outputs lose their
+   * UTXO row, every address touched by a transaction gets a
+   * history row, and the totals and last history segment of
+   * every address touched are updated once. Totals already at
+   * this height were written before a crash and are left alone.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @returns {Promise} - Returns Map of totals by address.
+   */
+  async indexBalance(ndb, b, entry, block) {
+    const { height } = entry;
+    const coins = new Map();
+    const totals = new Map();
+    const segments = new Map();
+
+    for (let pos = 0; pos < block.txs.length; pos++) {
+      const tx = block.txs[pos];
+      const txid = Buffer.from(tx.txid(), "hex");
+      const rows = new Map();
+
+      for (const input of tx.inputs) {
+        if (input.isCoinbase()) continue;
+
+        const hash = Buffer.from(input.prevout.txid(), "hex");
+        const { index } = input.prevout;
+        const key = layout.c.encode(hash, index);
+
+        let coin = coins.get(key.toString("hex"));
+
+        if (!coin) {
+          const raw = await getRow(ndb, b, key);
+
+          if (!raw) continue;
+
+          coin = CoinRecord.decode(raw);
+        }
+
+        b.del(layout.u.encode(coin.hash, hash, index));
+
+        const agg = await getAggregate(ndb, b, totals, coin.hash, height);
+        agg.spent += coin.value;
+
+        addRow(rows, agg).spent += coin.value;
+      }
+
+      for (let i = 0; i < tx.outputs.length; i++) {
+        const output = tx.outputs[i];
+        const addr = Buffer.from(output.address.getHash(), "hex");
+        const key = layout.c.encode(txid, i);
+        const coin = new CoinRecord(output.value, height, addr);
+
+        b.put(key, coin.encode());
+        coins.set(key.toString("hex"), coin);
+
+        b.put(
+          layout.u.encode(addr, txid, i),
+          new UnspentRecord(output.value, height).encode()
+        );
+
+        const agg = await getAggregate(ndb, b, totals, addr, height);
+        agg.received += output.value;
+
+        addRow(rows, agg).received += output.value;
+      }
+
+      for (const [agg, row] of rows) {
+        if (agg.skip) continue;
+
+        b.put(layout.r.encode(agg.hash, height, pos, txid), row.encode());
+
+        const index = Math.floor(agg.count / SEGMENT_ROWS);
+        const seg = await getSegment(ndb, b, segments, agg.hash, index);
+
+        if (seg.count === 0) {
+          seg.start = height;
+          seg.pos = pos;
+        }
+
+        seg.count += 1;
+        seg.received += row.received;
+        seg.spent += row.spent;
+        seg.end = height;
+
+        agg.count += 1;
+      }
+    }
+
+    putSegments(b, segments);
+    putAggregates(b, totals, height);
+
+    return totals;
+  }
+
+  /**
+   * Undo {@link Indexer#indexBalance} for a disconnected block.
+   * @private
+   * @param (NomenclateDB) ndb
+   * @param (Batch) b
+   * @param (ChainEntry) entry
+   * @param (Block) block
+   * @returns {Promise}
+   */
+  async unindexBalance(ndb, b, entry, block) {
+    const { height } = entry;
+    const coins = getBlockCoins(block, height);
+    const totals = new Map();
+    const segments = new Map();
+
+    // In reverse, so outputs spent within the
+    // block are restored before being removed.
+    for (let j = block.txs.length - 1; j >= 0; j--) {
+      const tx = block.txs[j];
+      const txid = Buffer.from(tx.txid(), "hex");
+      const rows = new Map();
+
+      for (const input of tx.inputs) {
+        if (input.isCoinbase()) continue;
+
+        const hash = Buffer.from(input.prevout.txid(), "hex");
+        const { index } = input.prevout;
+        const coin = await getCoin(ndb, b, coins, hash, index);
+
+        if (!coin) continue;
+
+        b.put(
+          layout.u.encode(coin.hash, hash, index),
+          new UnspentRecord(coin.value, coin.height).encode()
+        );
+
+        const agg = await getAggregate(ndb, b, totals, coin.hash, height, true);
+        agg.spent -= coin.value;
+
+        addRow(rows, agg).spent += coin.value;
+      }
+
+      for (let i = 0; i < tx.outputs.length; i++) {
+        const output = tx.outputs[i];
+        const addr = Buffer.from(output.address.getHash(), "hex");
+
+        b.del(layout.c.encode(txid, i));
+        b.del(layout.u.encode(addr, txid, i));
+
+        const agg = await getAggregate(ndb, b, totals, addr, height, true);
+        agg.received -= output.value;
+
+        addRow(rows, agg).received += output.value;
+      }
+
+      // History rows are the last rows of their addresses,
+      // so they come off the end of the last segment.
+      for (const [agg, row] of rows) {
+        if (agg.skip) continue;
+
+        b.del(layout.r.encode(agg.hash, height, j, txid));
+
+        agg.count -= 1;
+
+        const index = Math.floor(agg.count / SEGMENT_ROWS);
+        const seg = await getSegment(ndb, b, segments, agg.hash, index);
+
+        seg.count -= 1;
+        seg.received -= row.received;
+        seg.spent -= row.spent;
+        seg.end = height - 1;
+      }
+    }
+
+    putSegments(b, segments);
+    putAggregates(b, totals, height - 1);
+  }
+
+  /**
+   * Count rows left out because their index is disabled.
+   * @private
+   * @param {Number} rows
+   * @param {Number} bytes - Approximate key and value size.
+   */
+  skip(rows, bytes) {
+    this.skipped.rows += rows;
+    this.skipped.bytes += bytes;
+  }
+}
+
+class IndexerOptions {
   /**
    * Create indexer options.
    * @constructor
@@ -423,6 +1760,16 @@ class IndexerOptions {
     this.maxFiles = 64;
     this.cacheSize = 16 << 20;
     this.compression = true;
+    this.syncBatch = 1;
+    this.syncDepth = 1;
+    this.reader = null;
+    this.snapshot = null;
+    this.bulkLoad = false;
+    this.bulkThreshold = 10000;
+    this.bulkBlocks = 500;
+    this.reindex = false;
+    this.pruneDepth = 0;
+    this.pruneBatch = 100;
 
     if (options) this._fromOptions(options);
   }
@@ -485,6 +1832,65 @@ class IndexerOptions {
       this.compression = options.compression;
     }
 
+    if (options.syncBatch != null) {
+      assert(options.syncBatch >>> 0 === options.syncBatch);
+      assert(options.syncBatch > 0);
+      this.syncBatch = options.syncBatch;
+    }
+
+    if (options.syncDepth != null) {
+      assert(options.syncDepth >>> 0 === options.syncDepth);
+      assert(options.syncDepth > 0);
+      this.syncDepth = options.syncDepth;
+    }
+
+    if (options.reader != null) {
+      assert(typeof options.reader === "object");
+      this.reader = options.reader;
+    }
+
+    if (options.snapshot != null) {
+      assert(typeof options.snapshot === "string");
+      this.snapshot = options.snapshot;
+    }
+
+    if (options.bulkLoad != null) {
+      assert(typeof options.bulkLoad === "boolean");
+      this.bulkLoad = options.bulkLoad;
+    }
+
+    if (options.bulkThreshold != null) {
+      assert(options.bulkThreshold >>> 0 === options.bulkThreshold);
+      this.bulkThreshold = options.bulkThreshold;
+    }
+
+    if (options.bulkBlocks != null) {
+      assert(options.bulkBlocks >>> 0 === options.bulkBlocks);
+      assert(options.bulkBlocks > 0);
+      this.bulkBlocks = options.bulkBlocks;
+    }
+
+    if (options.reindex != null) {
+      assert(typeof options.reindex === "boolean");
+      this.reindex = options.reindex;
+    }
+
+    if (options.pruneDepth != null) {
+      assert(options.pruneDepth >>> 0 === options.pruneDepth);
+      const { keepBlocks } = this.network.block;
+      assert(
+        options.pruneDepth === 0 || options.pruneDepth >= keepBlocks,
+        "Pruning must keep at least " + keepBlocks + " blocks."
+      );
+      this.pruneDepth = options.pruneDepth;
+    }
+
+    if (options.pruneBatch != null) {
+      assert(options.pruneBatch >>> 0 === options.pruneBatch);
+      assert(options.pruneBatch > 0);
+      this.pruneBatch = options.pruneBatch;
+    }
+
     return this;
   }
 
@@ -499,4 +1905,163 @@ class IndexerOptions {
   }
 }
 
+/*
+ * Helpers
+ */
+
+function toMB(bytes) {
+  return Math.round(bytes / (1 << 20));
+}
+
+function toSeconds(time) {
+  return time[0] + time[1] / 1e9;
+}
+
+async function getRow(ndb, b, key) {
+  // Rows written earlier in a bulk batch are not on disk yet.
+  if (b instanceof SortedBatch) {
+    const value = b.get(key);
+    if (value !== undefined) return value;
+  }
+
+  return ndb.db.get(key);
+}
+
+async function getAggregate(ndb, b, totals, hash, height, undo = false) {
+  const hex = hash.toString("hex");
+
+  let agg = totals.get(hex);
+
+  if (agg) return agg;
+
+  const raw = await getRow(ndb, b, layout.a.encode(hash));
+
+  agg = raw ? AggregateRecord.decode(raw) : new AggregateRecord();
+  agg.hash = hash;
+
+  // Skip totals which already include the block (replayed after
+  // a crash), or, when undoing, which never included it.
+  if (undo) agg.skip = raw == null || agg.height < height;
+  else agg.skip = raw != null && agg.height >= height;
+
+  totals.set(hex, agg);
+
+  return agg;
+}
+
+async function getCoin(ndb, b, coins, hash, index) {
+  const key = layout.c.encode(hash, index);
+  const coin = coins.get(key.toString("hex"));
+
+  if (coin) return coin;
+
+  const raw = await getRow(ndb, b, key);
+
+  return raw ? CoinRecord.decode(raw) : null;
+}
+
+function getBlockCoins(block, height) {
+  // Undoing a block reads the outputs it spent itself from
+  // here, as their rows may be on a store a crash left behind.
+  const coins = new Map();
+
+  for (const tx of block.txs) {
+    const txid = Buffer.from(tx.txid(), "hex");
+
+    for (let i = 0; i < tx.outputs.length; i++) {
+      const output = tx.outputs[i];
+      const addr = Buffer.from(output.address.getHash(), "hex");
+      const key = layout.c.encode(txid, i);
+
+      const coin = new CoinRecord(output.value, height, addr);
+
+      coins.set(key.toString("hex"), coin);
+    }
+  }
+
+  return coins;
+}
+
+async function getStatus(ndb, b, statuses, hash, height) {
+  const hex = hash.toString("hex");
+
+  let status = statuses.get(hex);
+
+  if (status) return status;
+
+  const raw = await getRow(ndb, b, layout.e.encode(hash));
+
+  status = raw ? StatusRecord.decode(raw) : new StatusRecord();
+  status.hash = hash;
+  status.prev = raw;
+
+  // Statuses which already include the block
+  // (replayed after a crash) are left alone.
+  status.skip = raw != null && status.height >= height;
+
+  statuses.set(hex, status);
+
+  return status;
+}
+
+function getRecord(records, hash, Record) {
+  const hex = hash.toString("hex");
+
+  let record = records.get(hex);
+
+  if (!record) {
+    record = new Record();
+    record.hash = hash;
+    records.set(hex, record);
+  }
+
+  return record;
+}
+
+function addRow(rows, agg) {
+  let row = rows.get(agg);
+
+  if (!row) {
+    row = new HistoryRecord();
+    rows.set(agg, row);
+  }
+
+  return row;
+}
+
+async function getSegment(ndb, b, segments, hash, index) {
+  const key = layout.g.encode(hash, index);
+  const hex = key.toString("hex");
+
+  let seg = segments.get(hex);
+
+  if (seg) return seg;
+
+  const raw = await getRow(ndb, b, key);
+
+  seg = raw ? SegmentRecord.decode(raw) : new SegmentRecord();
+  seg.key = key;
+
+  segments.set(hex, seg);
+
+  return seg;
+}
+
+function putSegments(b, segments) {
+  for (const seg of segments.values()) {
+    if (seg.count === 0) b.del(seg.key);
+    else b.put(seg.key, seg.encode());
+  }
+}
+
+function putAggregates(b, totals, height) {
+  for (const agg of totals.values()) {
+    if (agg.skip) continue;
+
+    agg.height = height;
+
+    b.put(layout.a.encode(agg.hash), agg.encode());
+  }
+}
+
 module.exports = Indexer;
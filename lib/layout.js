@@ -16,9 +16,24 @@ const bdb = require("bdb");
  *  O -> flags
  *  H -> Last Sync Height
  *
- *  Transactions Output's Index
- *  o[SHA256(hash)(:8)] -> [txid(:8)]
- *  Code: o, Address Hash Prefix: hash(:8) -> Funding TxID Prefix: txid[:8]
+ *  Address Funding Index
+ *  o[hash][height][uint32][txid] -> [count][index:u32][value:u64]...
+ *  Code: o, Address Hash, Block Height, Position in Block, TxID ->
+ *  the outputs paid to the address, in height and block order.
+ *
+ *  Address Spend Index
+ *  s[hash][height][uint32][txid] -> [count][txid][index:u32][value:u64]...
+ *  The outputs of an address spent by a transaction, in the same order.
+ *
+ *  Address Status
+ *  e[hash] -> [height:u32][sha256 midstate]
+ *  Electrum status of an address, and the last height hashed into it.
+ *  E[height][hash] -> status record before the block (empty if none)
+ *  Undo rows, kept for the blocks which can still be disconnected.
+ *
+ *  Coins (address and balance indexes)
+ *  c[txid][uint32] -> [value:u64][height:u32][address hash]
+ *  Every output, kept after it is spent so blocks can be replayed and undone.
  *
  *  Transactions Input Index
  *  i[txid(:8)][uint16][txid(:8)] -> Transaction inputs row.
@@ -31,6 +46,21 @@ const bdb = require("bdb");
  *
  *  XXX todo
  *
+ *  Balance Index (optional)
+ *  u[hash][txid][uint32] -> [value:u64][height:u32]
+ *  Unspent outputs of an address.
+ *  a[hash] -> [received:u64][spent:u64][height:u32][rows:u32]
+ *  Address totals, and the last height applied to them.
+ *  r[hash][height][uint32][txid] -> [received:u64][spent:u64]
+ *  Address history, one row per transaction in block order.
+ *  g[hash][uint32] -> segment summary
+ *  Count, totals and first row of every 1000 history rows.
+ *
+ *  P -> Pruned Height (history rows below it have been dropped)
+ *
+ *  T -> [height:u32][header]
+ *  Last block written to each store of a split or sharded index.
+ *
  */
 
 const layout = {
@@ -38,10 +68,20 @@ const layout = {
   O: bdb.key("O"),
   H: bdb.key("H"),
   h: bdb.key("h", ["uint32"]),
-  o: bdb.key("o", ["hash", "hash"]),
+  o: bdb.key("o", ["hash", "uint32", "uint32", "hash"]),
+  s: bdb.key("s", ["hash", "uint32", "uint32", "hash"]),
   i: bdb.key("i", ["hash", "uint32"]),
   t: bdb.key("t", ["hash"]),
-  n: bdb.key("n", ["hash", "hash"])
+  n: bdb.key("n", ["hash", "hash"]),
+  e: bdb.key("e", ["hash"]),
+  E: bdb.key("E", ["uint32", "hash"]),
+  c: bdb.key("c", ["hash", "uint32"]),
+  u: bdb.key("u", ["hash", "hash", "uint32"]),
+  a: bdb.key("a", ["hash"]),
+  r: bdb.key("r", ["hash", "uint32", "uint32", "hash"]),
+  g: bdb.key("g", ["hash", "uint32"]),
+  P: bdb.key("P"),
+  T: bdb.key("T")
 };
 
 module.exports = layout;
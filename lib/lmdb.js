@@ -0,0 +1,386 @@
+/*!
+ * lmdb.js - lmdb storage backend for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const fs = require("bfile");
+
+/*
+ * Constants
+ */
+
+// Rows read per iterator transaction.
+const CHUNK_ROWS = 256;
+
+/**
+ * LMDB
+ * A memory mapped B+tree backend, exposing the subset of the
+ * `bdb` interface used by {@link NomenclateDB}. Reads go straight
+ * to the mapped pages without the level lookups (and compactions)
+ * of an LSM tree, which suits an index that is mostly read once
+ * synced. Batches are written in a single write transaction.
+ * Iterators read in chunks from short read transactions, unless
+ * opened with `snapshot` (see {@link LMDBIterator}).
+ * @alias module:nomenclate.LMDB
+ */
+
+class LMDB {
+  /**
+   * Create an LMDB database.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    assert(options && typeof options.location === "string");
+
+    // Only required when this backend is selected.
+    this.lmdb = require("node-lmdb");
+
+    this.location = options.location;
+    this.mapSize = options.mapSize || 2 ** 40;
+    this.env = null;
+    this.dbi = null;
+  }
+
+  /**
+   * Open the environment.
+   * @returns {Promise}
+   */
+
+  async open() {
+    assert(!this.env, "LMDB is already open.");
+
+    await fs.mkdirp(this.location);
+
+    this.env = new this.lmdb.Env();
+
+    this.env.open({
+      path: this.location,
+      mapSize: this.mapSize,
+      maxDbs: 1,
+      // Snapshot iterators hold a read transaction across
+      // awaits, while other reads on this thread open their own.
+      noTls: true
+    });
+
+    this.dbi = this.env.openDbi({
+      name: "nomenclate",
+      create: true,
+      keyIsBuffer: true
+    });
+  }
+
+  /**
+   * Close the environment.
+   * @returns {Promise}
+   */
+
+  async close() {
+    assert(this.env, "LMDB is not open.");
+
+    this.dbi.close();
+    this.env.close();
+
+    this.dbi = null;
+    this.env = null;
+  }
+
+  /**
+   * Get a value.
+   * @param {Buffer} key
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async get(key) {
+    const txn = this.env.beginTxn({ readOnly: true });
+
+    try {
+      const value = txn.getBinary(this.dbi, key, { keyIsBuffer: true });
+
+      // Copy out of the map before the transaction ends.
+      return value ? Buffer.from(value) : null;
+    } finally {
+      txn.abort();
+    }
+  }
+
+  /**
+   * Test whether a key exists.
+   * @param {Buffer} key
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async has(key) {
+    return (await this.get(key)) != null;
+  }
+
+  /**
+   * Write a single value.
+   * @param {Buffer} key
+   * @param {Buffer} value
+   * @returns {Promise}
+   */
+
+  async put(key, value) {
+    return this.batch()
+      .put(key, value)
+      .write();
+  }
+
+  /**
+   * Delete a single value.
+   * @param {Buffer} key
+   * @returns {Promise}
+   */
+
+  async del(key) {
+    return this.batch()
+      .del(key)
+      .write();
+  }
+
+  /**
+   * Create a batch.
+   * @returns {LMDBBatch}
+   */
+
+  batch() {
+    return new LMDBBatch(this);
+  }
+
+  /**
+   * Create an iterator.
+   * @param {Object} options
+   * @returns {LMDBIterator}
+   */
+
+  iterator(options) {
+    return new LMDBIterator(this, options);
+  }
+
+  /**
+   * B+trees do not need compacting.
+   * @returns {Promise}
+   */
+
+  async compactRange() {
+    return undefined;
+  }
+}
+
+/**
+ * LMDB Batch
+ * Buffers operations and applies them in one write transaction.
+ * @ignore
+ */
+
+class LMDBBatch {
+  constructor(db) {
+    this.db = db;
+    this.ops = [];
+  }
+
+  put(key, value) {
+    this.ops.push([key, value]);
+    return this;
+  }
+
+  del(key) {
+    this.ops.push([key, null]);
+    return this;
+  }
+
+  async write() {
+    const { dbi } = this.db;
+    const txn = this.db.env.beginTxn();
+
+    try {
+      for (const [key, value] of this.ops) {
+        if (value) {
+          txn.putBinary(dbi, key, value, { keyIsBuffer: true });
+          continue;
+        }
+
+        if (txn.getBinary(dbi, key, { keyIsBuffer: true }) != null)
+          txn.del(dbi, key, { keyIsBuffer: true });
+      }
+    } catch (e) {
+      txn.abort();
+      throw e;
+    }
+
+    txn.commit();
+
+    this.ops = [];
+  }
+
+  clear() {
+    this.ops = [];
+    return this;
+  }
+}
+
+/**
+ * LMDB Iterator
+ * Reads rows in chunks, each from its own read transaction,
+ * so that a reader paused between rows (a slow client, say)
+ * does not pin old pages and grow the map. A chunk resumes
+ * past the last key read. Iterators opened with `snapshot`
+ * keep one transaction throughout, for a consistent view.
+ * @ignore
+ */
+
+class LMDBIterator {
+  constructor(db, options) {
+    this.db = db;
+    this.gte = options.gte || null;
+    this.lte = options.lte || null;
+    this.reverse = Boolean(options.reverse);
+    this.keys = options.keys !== false;
+    this.values = Boolean(options.values);
+    this.limit = options.limit != null ? options.limit : -1;
+    this.hold = Boolean(options.snapshot);
+    this.txn = null;
+    this.cursor = null;
+    this.pending = [];
+    this.last = null;
+    this.done = false;
+    this.key = null;
+    this.value = null;
+  }
+
+  start() {
+    const { lmdb } = this.db;
+
+    this.txn = this.db.env.beginTxn({ readOnly: true });
+    this.cursor = new lmdb.Cursor(this.txn, this.db.dbi, {
+      keyIsBuffer: true
+    });
+  }
+
+  stop() {
+    if (this.cursor) {
+      this.cursor.close();
+      this.cursor = null;
+    }
+
+    if (this.txn) {
+      this.txn.abort();
+      this.txn = null;
+    }
+  }
+
+  seek() {
+    if (!this.reverse) {
+      const gte = this.last || this.gte;
+
+      if (!gte) return this.cursor.goToFirst();
+
+      const key = this.cursor.goToRange(gte);
+
+      // Resume past the last key read.
+      if (key != null && this.last && key.equals(this.last))
+        return this.cursor.goToNext();
+
+      return key;
+    }
+
+    const lte = this.last || this.lte;
+
+    if (!lte) return this.cursor.goToLast();
+
+    // Find the last key which is below `last`, or not above `lte`.
+    const key = this.cursor.goToRange(lte);
+
+    if (key == null) return this.cursor.goToLast();
+
+    const cmp = Buffer.compare(key, lte);
+
+    if (cmp > 0 || (cmp === 0 && this.last)) return this.cursor.goToPrev();
+
+    return key;
+  }
+
+  fill() {
+    if (!this.cursor) this.start();
+
+    try {
+      let key = this.seek();
+
+      while (this.pending.length < CHUNK_ROWS) {
+        if (key == null || this.limit === 0 || !this.inRange(key)) {
+          this.done = true;
+          break;
+        }
+
+        if (this.limit > 0) this.limit -= 1;
+
+        this.cursor.getCurrentBinary((k, v) => {
+          this.pending.push([Buffer.from(k), Buffer.from(v)]);
+        });
+
+        key = this.reverse ? this.cursor.goToPrev() : this.cursor.goToNext();
+      }
+    } finally {
+      if (this.done || !this.hold) this.stop();
+    }
+
+    if (this.pending.length > 0)
+      this.last = this.pending[this.pending.length - 1][0];
+  }
+
+  async next() {
+    this.key = null;
+    this.value = null;
+
+    if (this.pending.length === 0 && !this.done) this.fill();
+
+    if (this.pending.length === 0) return false;
+
+    [this.key, this.value] = this.pending.shift();
+
+    return true;
+  }
+
+  inRange(key) {
+    if (this.gte && Buffer.compare(key, this.gte) < 0) return false;
+    if (this.lte && Buffer.compare(key, this.lte) > 0) return false;
+    return true;
+  }
+
+  async each(cb) {
+    assert(typeof cb === "function");
+
+    try {
+      while (await this.next()) {
+        let result;
+
+        if (this.keys && this.values) result = await cb(this.key, this.value);
+        else if (this.keys) result = await cb(this.key);
+        else result = await cb(this.value);
+
+        // Stop early, as `bdb` does.
+        if (result === false) break;
+      }
+    } finally {
+      this.end();
+    }
+  }
+
+  end() {
+    this.stop();
+    this.pending = [];
+    this.done = true;
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = LMDB;
@@ -0,0 +1,345 @@
+/*!
+ * merkle.js - cached merkle proofs for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const blake2b = require("bcrypto/lib/blake2b");
+const { Lock } = require("bmutex");
+const layout = require("./layout");
+
+/**
+ * Merkle Tree
+ * An append-only merkle tree which keeps every node of its
+ * complete subtrees, so a branch and root for any prefix of
+ * the leaves takes a handful of hashes rather than hashing all
+ * of them again. Trees are built as {@link util.branchesAndRoot}
+ * builds them: an odd node at the end of a level is paired
+ * with itself.
+ * @alias module:nomenclate.MerkleTree
+ */
+
+class MerkleTree {
+  /**
+   * Create a merkle tree.
+   * @constructor
+   */
+
+  constructor() {
+    // Complete subtree roots at each level.
+    this.levels = [[]];
+  }
+
+  /**
+   * Get the number of leaves.
+   * @returns {Number}
+   */
+
+  get size() {
+    return this.levels[0].length;
+  }
+
+  /**
+   * Get a leaf.
+   * @param {Number} index
+   * @returns {Buffer}
+   */
+
+  leaf(index) {
+    return this.levels[0][index];
+  }
+
+  /**
+   * Add a leaf, and the subtree roots it completes.
+   * @param {Buffer} hash
+   */
+
+  push(hash) {
+    let node = hash;
+
+    for (let i = 0; ; i++) {
+      if (i === this.levels.length) this.levels.push([]);
+
+      const level = this.levels[i];
+
+      level.push(node);
+
+      if (level.length % 2 === 1) break;
+
+      node = blake2b.root(level[level.length - 2], node);
+    }
+  }
+
+  /**
+   * Drop the leaves from `size` on.
+   * @param {Number} size
+   */
+
+  truncate(size) {
+    for (let i = 0; i < this.levels.length; i++) {
+      const level = this.levels[i];
+      level.length = Math.min(level.length, Math.floor(size / 2 ** i));
+    }
+
+    while (this.levels.length > 1) {
+      if (this.levels[this.levels.length - 1].length > 0) break;
+      this.levels.pop();
+    }
+  }
+
+  /**
+   * Get a node of the tree over the leaves up to `last`.
+   * Nodes left of its right edge are stored, and those
+   * on it are hashed again.
+   * @private
+   * @param {Number} level
+   * @param {Number} index
+   * @param {Number} last - Index of the last leaf.
+   * @returns {Buffer}
+   */
+
+  node(level, index, last) {
+    const edge = Math.floor(last / 2 ** level);
+
+    assert(index <= edge);
+
+    if (index < edge || level === 0) return this.levels[level][index];
+
+    const left = this.node(level - 1, index * 2, last);
+
+    // The last node of an odd level is paired with itself.
+    if (index * 2 + 1 > Math.floor(last / 2 ** (level - 1)))
+      return blake2b.root(left, left);
+
+    return blake2b.root(left, this.node(level - 1, index * 2 + 1, last));
+  }
+
+  /**
+   * Get the branch of a leaf and the root of the tree over
+   * the leaves up to `last`.
+   * @param {Number} index
+   * @param {Number} [last=size - 1]
+   * @returns {Array} - [Buffer[], Buffer].
+   */
+
+  branch(index, last = this.size - 1) {
+    assert(index <= last && last < this.size);
+
+    const branch = [];
+
+    let level = 0;
+
+    for (; Math.floor(last / 2 ** level) > 0; level++) {
+      const pos = Math.floor(index / 2 ** level);
+      const edge = Math.floor(last / 2 ** level);
+
+      branch.push(this.node(level, Math.min(pos ^ 1, edge), last));
+    }
+
+    return [branch, this.node(level, 0, last)];
+  }
+}
+
+/**
+ * Proofs
+ * Merkle proofs from cached trees: a {@link MerkleTree} over
+ * every header hash, kept up to the tip (and cut back on
+ * reorgs), and the transaction trees of recently proved blocks,
+ * so a transaction or header proof no longer reads and hashes
+ * every header up to the checkpoint or the whole block.
+ * @alias module:nomenclate.Proofs
+ */
+
+class Proofs {
+  /**
+   * Create a proof cache.
+   * @constructor
+   * @param {NomenclateDB} ndb
+   * @param {Number} size - Block trees to keep.
+   */
+
+  constructor(ndb, size) {
+    assert(ndb && typeof ndb === "object");
+    assert(size >>> 0 === size);
+
+    this.ndb = ndb;
+    this.client = ndb.client;
+    this.size = size;
+    this.headers = new MerkleTree();
+    this.lock = new Lock();
+
+    // Block hash -> BlockTree, least recently used first.
+    this.blocks = new Map();
+  }
+
+  /**
+   * Bring the header tree up to the tip, dropping headers
+   * replaced by a reorg since it was last used.
+   * @private
+   * @returns {Promise}
+   */
+
+  async syncHeaders() {
+    const unlock = await this.lock.lock();
+    try {
+      const tree = this.headers;
+      const height = await this.ndb.getHeight();
+
+      if (tree.size > height + 1) tree.truncate(height + 1);
+
+      while (tree.size > 0) {
+        const last = tree.size - 1;
+        const raw = await this.ndb.db.get(layout.h.encode(last));
+
+        if (raw && blake2b.digest(raw).equals(tree.leaf(last))) break;
+
+        tree.truncate(last);
+      }
+
+      if (tree.size > height) return;
+
+      const iter = this.ndb.db.iterator({
+        gte: layout.h.encode(tree.size),
+        lte: layout.h.encode(height),
+        values: true
+      });
+
+      await iter.each((key, raw) => {
+        assert(layout.h.decode(key)[0] === tree.size, "Missing header.");
+        tree.push(blake2b.digest(raw));
+      });
+    } finally {
+      unlock();
+    }
+  }
+
+  /**
+   * Prove a header against the header root at a checkpoint.
+   * @param {Number} height
+   * @param {Number} cpHeight - At or above `height`, and the tip.
+   * @returns {Promise} - Returns {branch, root}.
+   */
+
+  async headerProof(height, cpHeight) {
+    assert(height <= cpHeight);
+
+    await this.syncHeaders();
+
+    assert(this.headers.size > cpHeight, "Checkpoint is above the tip.");
+
+    const [branch, root] = this.headers.branch(height, cpHeight);
+
+    return {
+      branch: branch.map(hash => hash.toString("hex")),
+      root: root.toString("hex")
+    };
+  }
+
+  /**
+   * Get the transaction tree of a block.
+   * @private
+   * @param {Buffer} hash - Block hash.
+   * @returns {Promise} - Returns {@link BlockTree}.
+   */
+
+  async getBlockTree(hash) {
+    const key = hash.toString("hex");
+
+    let tree = this.blocks.get(key);
+
+    if (tree) {
+      this.blocks.delete(key);
+      this.blocks.set(key, tree);
+      return tree;
+    }
+
+    const block = await this.client.getBlock(hash);
+
+    if (!block) return null;
+
+    tree = new BlockTree();
+
+    for (let i = 0; i < block.txs.length; i++) {
+      const txid = block.txs[i].hash();
+
+      tree.tree.push(txid);
+      tree.positions.set(txid.toString("hex"), i);
+    }
+
+    this.blocks.set(key, tree);
+
+    for (const old of this.blocks.keys()) {
+      if (this.blocks.size <= this.size) break;
+      this.blocks.delete(old);
+    }
+
+    return tree;
+  }
+
+  /**
+   * Prove a confirmed transaction: the transaction, its branch
+   * in its block, the block's header and, with a checkpoint at
+   * or above the block, the header's branch to the checkpoint.
+   * @param {Buffer} txid
+   * @param {Number} cpHeight - Checkpoint height, or 0 for none.
+   * @returns {Promise} - Returns Object, or null if unconfirmed.
+   */
+
+  async txProof(txid, cpHeight) {
+    const meta = await this.client.getMeta(txid);
+
+    if (!meta || meta.height < 0) return null;
+
+    const tree = await this.getBlockTree(meta.block);
+
+    if (!tree) return null;
+
+    const pos = tree.positions.get(txid.toString("hex"));
+
+    assert(pos != null, "Transaction not in its block.");
+
+    const [merkle] = tree.tree.branch(pos);
+    const header = await this.ndb.getHeaders(meta.height);
+
+    const proof = {
+      tx_hash: txid.toString("hex"),
+      hex: meta.tx.toHex(),
+      block_height: meta.height,
+      pos,
+      merkle: merkle.map(hash => hash.toString("hex")),
+      header: header ? header.toString("hex") : null,
+      branch: null,
+      root: null
+    };
+
+    if (cpHeight > 0 && cpHeight >= meta.height) {
+      const { branch, root } = await this.headerProof(meta.height, cpHeight);
+      proof.branch = branch;
+      proof.root = root;
+    }
+
+    return proof;
+  }
+}
+
+/**
+ * Block Tree
+ * @ignore
+ */
+
+class BlockTree {
+  constructor() {
+    this.tree = new MerkleTree();
+    this.positions = new Map();
+  }
+}
+
+/*
+ * Expose
+ */
+
+exports.MerkleTree = MerkleTree;
+exports.Proofs = Proofs;
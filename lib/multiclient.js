@@ -0,0 +1,658 @@
+/*!
+ * multiclient.js - multi daemon chain client for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const AsyncEmitter = require("bevent");
+
+/*
+ * Constants
+ */
+
+const EVENTS = ["block connect", "block disconnect", "chain reset"];
+
+/**
+ * Multi Client
+ * Wraps several chain clients (one per daemon). Chain events and
+ * single lookups go to the primary source, while catch-up ranges
+ * are split across every healthy source and fetched in parallel.
+ * Header hashes are cross-checked between sources, and sources
+ * which disagree with the majority or are too slow are dropped,
+ * and dropped sources are probed again every so often.
+ * @alias module:nomenclate.MultiClient
+ */
+
+class MultiClient extends AsyncEmitter {
+  /**
+   * Create a multi client.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    super();
+
+    this.options = new MultiClientOptions(options);
+
+    this.network = this.options.network;
+    this.logger = this.options.logger.context("nomenclate-multi");
+    this.sources = this.options.clients.map((client, i) => {
+      return new Source(i, client);
+    });
+
+    this.primary = this.sources[0];
+    this.opened = false;
+    this.timer = null;
+    this.probing = false;
+
+    this.init();
+  }
+
+  /**
+   * Initialize the client.
+   */
+
+  init() {
+    for (const source of this.sources) {
+      const { client } = source;
+
+      // Only the primary's chain events are used, so the
+      // others need not fetch a block for each of them.
+      if (source !== this.primary) watch(client, false);
+
+      client.on("error", err => this.emit("error", err));
+
+      client.on("connect", () => {
+        if (source === this.primary) this.emit("connect");
+      });
+
+      client.on("disconnect", () => {
+        if (source === this.primary) this.emit("disconnect");
+      });
+
+      for (const event of EVENTS) {
+        client.bind(event, (...args) => {
+          if (source !== this.primary) return undefined;
+          return this.emitAsync(event, ...args);
+        });
+      }
+    }
+  }
+
+  /**
+   * Open every source.
+   * @returns {Promise}
+   */
+
+  async open() {
+    assert(!this.opened, "MultiClient is already open.");
+    this.opened = true;
+
+    await Promise.all(this.sources.map(source => source.client.open()));
+
+    if (this.sources.length > 1) {
+      this.timer = setInterval(() => {
+        this.probe().catch(e => this.emit("error", e));
+      }, this.options.probeInterval);
+    }
+  }
+
+  /**
+   * Close every source.
+   * @returns {Promise}
+   */
+
+  async close() {
+    assert(this.opened, "MultiClient is not open.");
+    this.opened = false;
+
+    if (this.timer != null) {
+      clearInterval(this.timer);
+      this.timer = null;
+    }
+
+    await Promise.all(this.sources.map(source => source.client.close()));
+  }
+
+  /**
+   * Add a listener.
+   * @param {String} type
+   * @param {Function} handler
+   */
+
+  bind(type, handler) {
+    return this.on(type, handler);
+  }
+
+  /**
+   * Add a listener.
+   * @param {String} type
+   * @param {Function} handler
+   */
+
+  hook(type, handler) {
+    return this.on(type, handler);
+  }
+
+  /**
+   * Get sources which have not been dropped.
+   * @returns {Source[]}
+   */
+
+  healthy() {
+    return this.sources.filter(source => !source.dropped);
+  }
+
+  /**
+   * Drop a source. If it was the primary, the
+   * next healthy source is promoted.
+   * @param {Source} source
+   * @param {String} reason
+   */
+
+  drop(source, reason) {
+    if (source.dropped) return;
+
+    const healthy = this.healthy();
+
+    // Never drop the last source.
+    if (healthy.length === 1) {
+      this.logger.warning(
+        "Source %d is %s, but it is the last source left.",
+        source.id,
+        reason
+      );
+      return;
+    }
+
+    source.dropped = true;
+
+    this.logger.warning("Dropping source %d (%s).", source.id, reason);
+
+    if (source === this.primary) {
+      this.primary = this.healthy()[0];
+      watch(this.primary.client, true);
+      this.logger.warning("Source %d is now primary.", this.primary.id);
+    }
+
+    if (this.healthy().length === 1) {
+      this.logger.warning(
+        "Only source %d is left, hashes are no longer cross-checked.",
+        this.primary.id
+      );
+    }
+  }
+
+  /**
+   * Probe dropped sources and re-admit the ones which
+   * answer in time and agree with the primary's tip.
+   * Their rate is reset so they are measured afresh.
+   * @returns {Promise}
+   */
+
+  async probe() {
+    if (this.probing) return;
+
+    this.probing = true;
+
+    try {
+      await this._probe();
+    } finally {
+      this.probing = false;
+    }
+  }
+
+  /**
+   * Probe dropped sources (without a guard).
+   * @private
+   * @returns {Promise}
+   */
+
+  async _probe() {
+    const dropped = this.sources.filter(source => source.dropped);
+
+    if (dropped.length === 0) return;
+
+    const tip = this.getTip();
+
+    await Promise.all(
+      dropped.map(async source => {
+        let hashes;
+
+        try {
+          const { height } = tip;
+          const request = source.client.getHashes(height, height);
+          hashes = await this.timeout(source, request);
+        } catch (e) {
+          this.logger.debug("Source %d is still down: %s.", source.id, e);
+          return;
+        }
+
+        // Behind or on another chain.
+        if (hashes.length !== 1 || !hashes[0].equals(tip.hash)) return;
+
+        source.dropped = false;
+        source.rate = 0;
+
+        this.logger.info("Re-admitting source %d.", source.id);
+      })
+    );
+  }
+
+  /**
+   * Get chain tip.
+   * @returns {ChainEntry}
+   */
+
+  getTip() {
+    return this.primary.client.getTip();
+  }
+
+  /**
+   * Get hash range.
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise}
+   */
+
+  async getHashes(start = -1, end = -1) {
+    return this.primary.client.getHashes(start, end);
+  }
+
+  /**
+   * Get chain entry.
+   * @param {Hash/Number} hash
+   * @returns {Promise}
+   */
+
+  async getEntry(hash) {
+    return this.primary.client.getEntry(hash);
+  }
+
+  /**
+   * Get block
+   * @param {Hash} hash
+   * @returns {Promise}
+   */
+
+  async getBlock(hash) {
+    return this.primary.client.getBlock(hash);
+  }
+
+  /**
+   * Get a serialized block without decoding it.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async getRawBlock(hash) {
+    return this.primary.client.getRawBlock(hash);
+  }
+
+  /**
+   * Get a range of main chain entries and blocks.
+   * The range is checked against every healthy source,
+   * then split between the sources that agree and fetched
+   * in parallel. Results are returned in height order.
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise} - Returns [ChainEntry, Block][].
+   */
+
+  async getBlocks(start, end) {
+    const [hashes, sources] = await this.checkHashes(start, end);
+
+    const count = end - start + 1;
+    const size = Math.ceil(count / sources.length);
+    const jobs = [];
+
+    for (let i = 0; i < sources.length; i++) {
+      const from = start + i * size;
+      const to = Math.min(from + size - 1, end);
+
+      if (from > to) break;
+
+      jobs.push(this.fetch(sources[i], from, to));
+    }
+
+    const parts = await Promise.all(jobs);
+    const blocks = [].concat(...parts);
+
+    assert(blocks.length === count);
+
+    for (let i = 0; i < count; i++) {
+      const [entry, block] = blocks[i];
+
+      assert(entry.height === start + i);
+      assert(block.hash().equals(hashes[i]));
+    }
+
+    this.reportSlow();
+
+    return blocks;
+  }
+
+  /**
+   * Ask every healthy source for the hashes of a range and
+   * drop the ones which disagree with the majority. Sources
+   * which are simply behind are skipped for this range.
+   * @private
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise} - Returns [Hash[], Source[]].
+   */
+
+  async checkHashes(start, end) {
+    const sources = this.healthy();
+    const count = end - start + 1;
+
+    const results = await Promise.all(
+      sources.map(async source => {
+        try {
+          const hashes = source.client.getHashes(start, end);
+          return await this.timeout(source, hashes);
+        } catch (e) {
+          this.drop(source, e.message);
+          return null;
+        }
+      })
+    );
+
+    const votes = new Map();
+
+    for (let i = 0; i < sources.length; i++) {
+      const hashes = results[i];
+
+      if (!hashes || hashes.length !== count) continue;
+
+      const key = hashes[count - 1].toString("hex");
+      const vote = votes.get(key);
+
+      if (vote) vote.push(i);
+      else votes.set(key, [i]);
+    }
+
+    assert(votes.size > 0, "MultiClient: No source has the range.");
+
+    // Ties go to whichever side the primary is on.
+    let best = null;
+
+    for (const vote of votes.values()) {
+      if (
+        !best ||
+        vote.length > best.length ||
+        (vote.length === best.length &&
+          vote.some(i => sources[i] === this.primary))
+      )
+        best = vote;
+    }
+
+    for (const vote of votes.values()) {
+      if (vote === best) continue;
+
+      for (const i of vote) this.drop(sources[i], "hash mismatch");
+    }
+
+    // Agreeing on the last hash means agreeing
+    // on all of its ancestors as well.
+    const hashes = results[best[0]];
+
+    return [hashes, best.map(i => sources[i])];
+  }
+
+  /**
+   * Fetch part of a range from one source, falling
+   * back to the primary if the source fails.
+   * @private
+   * @param {Source} source
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise}
+   */
+
+  async fetch(source, start, end) {
+    const now = Date.now();
+
+    try {
+      const blocks = await this.timeout(
+        source,
+        source.client.getBlocks(start, end)
+      );
+
+      source.record(Date.now() - now, end - start + 1);
+
+      return blocks;
+    } catch (e) {
+      this.drop(source, e.message);
+
+      if (source === this.primary || !this.primary) throw e;
+
+      return this.primary.client.getBlocks(start, end);
+    }
+  }
+
+  /**
+   * Race a request against the source timeout.
+   * @private
+   * @param {Source} source
+   * @param {Promise} promise
+   * @returns {Promise}
+   */
+
+  timeout(source, promise) {
+    return new Promise((resolve, reject) => {
+      const timer = setTimeout(() => {
+        reject(new Error("timed out"));
+      }, this.options.timeout);
+
+      promise.then(
+        result => {
+          clearTimeout(timer);
+          resolve(result);
+        },
+        err => {
+          clearTimeout(timer);
+          reject(err);
+        }
+      );
+    });
+  }
+
+  /**
+   * Drop sources which are much slower per block than
+   * the fastest healthy source.
+   * @private
+   */
+
+  reportSlow() {
+    const healthy = this.healthy().filter(source => source.rate > 0);
+
+    if (healthy.length < 2) return;
+
+    const fastest = Math.min(...healthy.map(source => source.rate));
+
+    for (const source of healthy) {
+      if (source.rate > fastest * this.options.slowFactor)
+        this.drop(source, "slow");
+    }
+  }
+
+  /**
+   * Get tx
+   * @param {Hash} hash
+   * @returns {Promise}
+   */
+
+  async getTX(hash) {
+    return this.primary.client.getTX(hash);
+  }
+
+  /**
+   * Get transaction with metadata.
+   * @param {Hash} hash
+   * @returns {Promise}
+   */
+
+  async getMeta(hash) {
+    return this.primary.client.getMeta(hash);
+  }
+
+  /**
+   * Broadcast a transaction to every healthy source.
+   * @param {TX} tx
+   * @returns {Promise}
+   */
+
+  async sendTX(tx) {
+    const sources = this.healthy();
+    const results = await Promise.all(
+      sources.map(source => source.client.sendTX(tx).catch(e => e))
+    );
+
+    for (const result of results) {
+      if (!(result instanceof Error)) return result;
+    }
+
+    throw results[0];
+  }
+
+  /**
+   * Estimate a fee rate.
+   * @param {Number} blocks
+   * @returns {Promise}
+   */
+
+  async estimateFee(blocks) {
+    return this.primary.client.estimateFee(blocks);
+  }
+
+  /**
+   * Get mempool transactions for an address.
+   * @param {Address} addr
+   * @returns {Promise}
+   */
+
+  async getMempoolTXs(addr) {
+    return this.primary.client.getMempoolTXs(addr);
+  }
+
+  /**
+   * Test whether a transaction is in the mempool.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async hasMempoolTX(hash) {
+    return this.primary.client.hasMempoolTX(hash);
+  }
+
+  /**
+   * Get the fee a mempool transaction pays.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Number, or null if not found.
+   */
+
+  async getMempoolFee(hash) {
+    return this.primary.client.getMempoolFee(hash);
+  }
+
+  /**
+   * Get previous entry.
+   * @param {Block} block
+   * @returns {Promise} - Returns ChainEntry.
+   */
+
+  getPrevious(block) {
+    return this.primary.client.getPrevious(block);
+  }
+}
+
+/**
+ * Source
+ * A chain client along with its health.
+ * @ignore
+ */
+
+class Source {
+  constructor(id, client) {
+    this.id = id;
+    this.client = client;
+    this.dropped = false;
+
+    // Moving average of milliseconds per block.
+    this.rate = 0;
+  }
+
+  record(ms, blocks) {
+    const rate = ms / blocks;
+
+    if (this.rate === 0) this.rate = rate;
+    else this.rate = this.rate * 0.8 + rate * 0.2;
+  }
+}
+
+class MultiClientOptions {
+  /**
+   * Create multi client options.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    this.network = null;
+    this.logger = null;
+    this.clients = [];
+    this.timeout = 30000;
+    this.slowFactor = 4;
+    this.probeInterval = 60000;
+
+    if (options) this._fromOptions(options);
+  }
+
+  _fromOptions(options) {
+    assert(options.logger && typeof options.logger === "object");
+    this.logger = options.logger;
+
+    assert(Array.isArray(options.clients) && options.clients.length > 0);
+    this.clients = options.clients;
+    this.network = this.clients[0].network;
+
+    if (options.timeout != null) {
+      assert(options.timeout >>> 0 === options.timeout);
+      this.timeout = options.timeout;
+    }
+
+    if (options.slowFactor != null) {
+      assert(typeof options.slowFactor === "number");
+      assert(options.slowFactor > 1);
+      this.slowFactor = options.slowFactor;
+    }
+
+    if (options.probeInterval != null) {
+      assert(options.probeInterval >>> 0 === options.probeInterval);
+      assert(options.probeInterval > 0);
+      this.probeInterval = options.probeInterval;
+    }
+
+    return this;
+  }
+}
+
+/*
+ * Helpers
+ */
+
+function watch(client, watching) {
+  // Local clients have no blocks to skip fetching.
+  if (typeof client.watch === "function") client.watch(watching);
+}
+
+/*
+ * Expose
+ */
+
+module.exports = MultiClient;
@@ -7,8 +7,205 @@
 
 "use strict";
 
-class Nomenclate {
+const EventEmitter = require("events");
+const Config = require("bcfg");
+const Logger = require("blgr");
+const fs = require("bfile");
+const { Network } = require("hsd");
+const MultiClient = require("./multiclient");
+const BlockReader = require("./blockreader");
+const NomenclateDB = require("./nomenclatedb.js");
+const Indexer = require("./indexer.js");
+const HTTP = require("./http");
+const RPCServer = require("./rpc");
+const BinaryServer = require("./binary");
+const config = require("./config");
 
+/**
+ * Nomenclate
+ * Standalone Nomenclate daemon which indexes a
+ * remote hsd node over its HTTP/websocket API.
+ * @alias module:nomenclate.Nomenclate
+ * @extends EventEmitter
+ */
+
+class Nomenclate extends EventEmitter {
+  /**
+   * Create a standalone nomenclate server.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    super();
+
+    this.config = new Config("nomenclate");
+    this.config.inject(options);
+    this.config.load(options);
+
+    if (options.config) this.config.open("nomenclate.conf");
+
+    this.network = Network.get(this.config.getSuffix());
+    this.prefix = this.config.prefix;
+
+    this.logger = new Logger({
+      level: this.config.str("log-level", "info"),
+      console: this.config.bool("log-console", true),
+      filename: this.config.bool("log-file", false)
+        ? this.config.location("debug.log")
+        : null
+    });
+
+    this.client = this.createClient();
+
+    const base = {
+      network: this.network,
+      logger: this.logger,
+      client: this.client
+    };
+
+    this.ndb = new NomenclateDB(
+      Object.assign(config.dbOptions(this.config, this.prefix, false), base)
+    );
+
+    this.reader = null;
+
+    // Reading block files requires hsd to
+    // share a filesystem with the daemon.
+    const reader = config.readerOptions(this.config, this.prefix);
+
+    if (reader) this.reader = new BlockReader(Object.assign(reader, base));
+
+    this.indexer = new Indexer(
+      Object.assign(
+        config.indexerOptions(this.config, { syncBatch: 100, syncDepth: 4 }),
+        base,
+        {
+          ndb: this.ndb,
+          reader: this.reader
+        }
+      )
+    );
+
+    const services = Object.assign({}, base, {
+      ndb: this.ndb,
+      indexer: this.indexer
+    });
+
+    this.http = null;
+
+    const http = config.httpOptions(this.config);
+
+    if (http) this.http = new HTTP(Object.assign(http, services));
+
+    this.rpc = null;
+
+    const rpc = config.rpcOptions(this.config);
+
+    if (rpc) this.rpc = new RPCServer(Object.assign(rpc, services));
+
+    this.binary = null;
+
+    const binary = config.binaryOptions(this.config);
+
+    if (binary) this.binary = new BinaryServer(Object.assign(binary, services));
+
+    this.init();
+  }
+
+  /**
+   * Create the chain client. With `node-hosts` set, every
+   * listed daemon becomes a source for a {@link MultiClient}.
+   * @private
+   * @returns {RemoteClient|MultiClient}
+   */
+
+  createClient() {
+    const remotes = config.createRemotes(this.config, this.network);
+
+    if (remotes.length === 0) {
+      return config.createRemote(
+        this.config,
+        this.network,
+        this.config.str("node-host"),
+        this.config.uint("node-port")
+      );
+    }
+
+    return new MultiClient(
+      Object.assign(config.multiOptions(this.config), {
+        logger: this.logger,
+        clients: remotes
+      })
+    );
+  }
+
+  init() {
+    this.client.on("error", err => this.emit("error", err));
+    this.ndb.on("error", err => this.emit("error", err));
+    this.indexer.on("error", err => this.emit("error", err));
+
+    if (this.http) this.http.on("error", err => this.emit("error", err));
+
+    if (this.rpc) this.rpc.on("error", err => this.emit("error", err));
+
+    if (this.binary) this.binary.on("error", err => this.emit("error", err));
+  }
+
+  /**
+   * Create the prefix directory.
+   * @returns {Promise}
+   */
+
+  async ensure() {
+    if (this.config.bool("memory", false)) return;
+
+    await fs.mkdirp(this.prefix);
+  }
+
+  /**
+   * Open the logger, database, indexer and servers.
+   * @returns {Promise}
+   */
+
+  async open() {
+    await this.logger.open();
+
+    this.logger.info("Connecting to hsd on %s.", this.network);
+
+    await this.ndb.open();
+
+    await this.indexer.open();
+
+    if (this.http) await this.http.open();
+
+    if (this.rpc) await this.rpc.open();
+
+    if (this.binary) await this.binary.open();
+  }
+
+  /**
+   * Close the servers, indexer and database.
+   * @returns {Promise}
+   */
+
+  async close() {
+    if (this.binary) await this.binary.close();
+
+    if (this.rpc) await this.rpc.close();
+
+    if (this.http) await this.http.close();
+
+    await this.indexer.close();
+
+    await this.ndb.close();
+
+    await this.logger.close();
+  }
 }
 
+/*
+ * Expose
+ */
 
+module.exports = Nomenclate;
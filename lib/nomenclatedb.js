@@ -10,15 +10,76 @@
 //TODO remove this.
 const EventEmitter = require("events");
 const path = require("path");
-const { Network, Address, Covenant, Script, Coin } = require("hsd");
+const {
+  Network,
+  Address,
+  Covenant,
+  Script,
+  Coin,
+  Headers
+} = require("hsd");
 const Logger = require("blgr");
 const assert = require("bsert");
-const bdb = require("bdb");
 const layout = require("./layout");
+const snapshot = require("./snapshot");
+const SortedBatch = require("./batch");
+const RoutedDB = require("./routed");
+const GatedDB = require("./gated");
+const ShardedDB = require("./sharded");
+const SplitDB = require("./split");
+const backend = require("./backend");
+const flags = require("./flags");
+const {
+  AggregateRecord,
+  UnspentRecord,
+  FundingRecord,
+  SpendRecord,
+  HistoryRecord,
+  SegmentRecord,
+  StatusRecord,
+  SEGMENT_ROWS
+} = require("./records");
+const AddressFilter = require("./addressfilter");
+const ChangeLog = require("./changelog");
+const { Proofs } = require("./merkle");
+const HotCache = require("./hotcache");
+const HotKeys = require("./hotkeys");
+const { HistoryStream, HistoryMerge } = require("./history");
+const fs = require("bfile");
 const { Lock } = require("bmutex");
 const bio = require("bufio");
 const blake2b = require("bcrypto/lib/blake2b");
 
+/*
+ * Constants
+ */
+
+// Bump when the index layout changes. Older indexes keep
+// serving while a new one is rebuilt alongside them.
+const DB_VERSION = 4;
+
+// Version the rows of each index last changed in. Indexes
+// written by an older version are not served until rebuilt.
+const INDEX_VERSIONS = {
+  address: 2,
+  spend: 0,
+  name: 0,
+  balance: 0
+};
+
+// First version with history rows keyed by block position.
+const SEGMENT_VERSION = 4;
+
+// First version whose address totals count history rows.
+const COUNT_VERSION = 1;
+
+// First version with address status rows.
+const STATUS_VERSION = 3;
+const DB_NAME = "nomenclate";
+
+// Milliseconds to spend warming caches after a restart.
+const WARM_TIME = 60 * 1000;
+
 /**
  * NomenclateDB
  * @alias module:nomenclate.nomenclateDB
@@ -39,8 +100,58 @@ class NomenclateDB extends EventEmitter {
 
     this.network = this.options.network;
     this.logger = this.options.logger.context("nomenclate");
-    this.db = bdb.create(this.options);
+    this.location = this.options.location;
     this.client = this.options.client;
+
+    // Shadow rebuilds started since we were opened.
+    this.shadows = 0;
+    this.profile = "serving";
+    this.legacy = false;
+    this.version = DB_VERSION;
+    this.height = 0;
+
+    // Indexes to write, indexes which are complete
+    // on disk, and indexes which need a backfill.
+    this.features = this.options.features;
+    this.indexed = this.features;
+    this.missing = 0;
+
+    // History rows below this height have been pruned.
+    this.pruneHeight = 0;
+
+    this.filter = null;
+    this.filterFile = this.options.location + ".filter";
+    this.filterRebuild = null;
+    this.filterStop = false;
+
+    if (this.options.addressFilter)
+      this.filter = new AddressFilter(this.options.addressFilterSize);
+
+    this.cache = null;
+
+    if (this.options.hotCacheSize > 0)
+      this.cache = new HotCache(this.options.hotCacheSize);
+
+    this.hotkeys = null;
+    this.hotkeysFile = this.options.location + ".warm";
+    this.warming = null;
+    this.warmStop = false;
+
+    if (this.options.warmStart) this.hotkeys = new HotKeys();
+
+    this.proofs = new Proofs(this, this.options.proofCacheBlocks);
+
+    this.changes = null;
+
+    if (this.options.changeLog && !this.options.memory) {
+      this.changes = new ChangeLog({
+        location: this.options.location + ".changes",
+        segmentSize: this.options.changeLogSegmentSize,
+        retention: this.options.changeLogRetention
+      });
+    }
+
+    this.db = new GatedDB(this.createDB());
   }
 
   /**
@@ -49,275 +160,1721 @@ class NomenclateDB extends EventEmitter {
    */
 
   async open() {
+    if (!this.options.memory) {
+      await this.promoteShadow();
+
+      // Indexes from before the header store was split out
+      // are served as they are until they have been rebuilt.
+      if (await this.isLegacy()) {
+        this.legacy = true;
+        this.db = new GatedDB(this.createDB());
+      }
+
+      await this.verifyShards();
+    }
+
     await this.db.open();
 
-    await this.db.verify(layout.V.encode(), "nomenclate", 0);
+    await this.verifyVersion();
+
+    this.height = await this.getHeight();
+    this.pruneHeight = await this.getPruneHeight();
+
+    this.resetCache();
+
+    if (this.filter) await this.loadFilter();
+
+    if (this.hotkeys && !this.options.memory) await this.loadHotKeys();
+
+    if (this.changes) await this.changes.open();
+  }
+
+  /**
+   * Load the lookups counted before the last shutdown,
+   * and warm the caches for them in the background.
+   * @private
+   * @returns {Promise}
+   */
+
+  async loadHotKeys() {
+    if (!(await this.hotkeys.load(this.hotkeysFile, this.network))) return;
+
+    this.warming = this.warm()
+      .catch(e => this.emit("error", e))
+      .then(() => {
+        this.warming = null;
+      });
+  }
+
+  /**
+   * Read the most used addresses, names and header ranges,
+   * most used first, so that our caches and the database
+   * block cache hold them again. Yields between keys so that
+   * requests come first, and gives up after `WARM_TIME`.
+   * @private
+   * @returns {Promise}
+   */
+
+  async warm() {
+    const start = Date.now();
+    const done = { address: 0, name: 0, header: 0 };
+
+    const stopped = () => this.warmStop || Date.now() - start > WARM_TIME;
+
+    for (const [key] of this.hotkeys.top("address")) {
+      if (stopped()) break;
+
+      await this.warmAddress(Address.fromHash(Buffer.from(key, "hex")));
+      await yieldIO();
+
+      done.address += 1;
+    }
+
+    for (const [key] of this.hotkeys.top("name")) {
+      if (stopped() || !this.hasIndex("name")) break;
+
+      const hash = Buffer.from(key, "hex");
+
+      await this.warmRange(layout.n.min(hash), layout.n.max(hash));
+      await yieldIO();
+
+      done.name += 1;
+    }
+
+    for (const [start, end] of this.hotkeys.headerRanges()) {
+      if (stopped()) break;
+
+      await this.warmRange(layout.h.encode(start), layout.h.encode(end));
+      await yieldIO();
+
+      done.header += 1;
+    }
+
+    this.logger.info(
+      "Warmed %d addresses, %d names and %d header ranges in %d ms.",
+      done.address,
+      done.name,
+      done.header,
+      Date.now() - start
+    );
+  }
+
+  /**
+   * Read an address into the hot cache.
+   * @private
+   * @param {Address} addr
+   * @returns {Promise}
+   */
+
+  async warmAddress(addr) {
+    if (this.hasIndex("balance")) {
+      await this.addressAggregate(addr);
+      await this.addressCoins(addr);
+    }
+
+    if (this.hasIndex("address")) {
+      const funding = await this.addressFunding(addr);
+
+      if (funding) await this.addressSpent(addr, funding[0]);
+    }
+  }
+
+  /**
+   * Read a key range into the database block cache.
+   * @private
+   * @param {Buffer} gte
+   * @param {Buffer} lte
+   * @returns {Promise}
+   */
+
+  async warmRange(gte, lte) {
+    const iter = this.db.iterator({ gte, lte, values: true });
+
+    await iter.each(() => {});
+  }
+
+  /**
+   * Count a lookup for the next warm start.
+   * @param {String} kind - `address`, `name` or `header`.
+   * @param {Buffer|Number} key
+   */
+
+  touch(kind, key) {
+    if (this.hotkeys) this.hotkeys.record(kind, key);
+  }
+
+  /**
+   * Load the address filter saved at the last shutdown. The file
+   * is removed once read, so after a crash (or if the index has
+   * moved on without it) the filter is rebuilt from the index in
+   * the background. Lookups skip the filter until it is ready.
+   * @private
+   * @returns {Promise}
+   */
+
+  async loadFilter() {
+    if (this.options.memory) {
+      if (this.height === 0) this.filter.ready = true;
+      else this.startFilterRebuild();
+      return;
+    }
+
+    const height = await this.filter.load(this.filterFile, this.network);
+
+    await fs.remove(this.filterFile);
+
+    if (height !== -1 && height === this.height) {
+      this.filter.ready = true;
+      this.logger.info(
+        "Loaded address filter with %d addresses (%d% false positives).",
+        this.filter.count,
+        (this.filter.getRate() * 100).toFixed(3)
+      );
+      return;
+    }
+
+    this.filter.reset();
+    this.startFilterRebuild();
+  }
+
+  /**
+   * Rebuild the address filter in the background, reporting errors.
+   */
+
+  startFilterRebuild() {
+    if (this.filterRebuild) return;
+
+    this.filterRebuild = this.rebuildFilter()
+      .catch(e => this.emit("error", e))
+      .then(() => {
+        this.filterRebuild = null;
+      });
+  }
+
+  /**
+   * Stop a background filter rebuild, leaving the filter not ready.
+   * @returns {Promise}
+   */
+
+  async stopFilterRebuild() {
+    if (!this.filterRebuild) return;
+
+    this.filterStop = true;
+
+    try {
+      await this.filterRebuild;
+    } finally {
+      this.filterStop = false;
+    }
+  }
+
+  /**
+   * Add every address in the index to the filter. Addresses
+   * from new blocks are added as they are indexed meanwhile.
+   * @private
+   * @returns {Promise}
+   */
+
+  async rebuildFilter() {
+    let key = null;
+
+    // Pruning deletes o rows, but never a rows, which
+    // also have just one row per address to read.
+    if (this.hasIndex("balance")) key = layout.a;
+    else if (this.hasIndex("address")) key = layout.o;
+
+    if (!key) {
+      this.logger.warning("Address filter needs the address or balance index.");
+      return;
+    }
+
+    this.filter.ready = false;
+
+    this.logger.info("Rebuilding address filter.");
+
+    const iter = this.db.iterator({
+      gte: Buffer.from([key.id]),
+      lte: Buffer.from([key.id + 1]),
+      keys: true,
+      values: false
+    });
+
+    let stopped = false;
+
+    await iter.each(async raw => {
+      if (raw[0] !== key.id) return undefined;
+
+      if (this.filterStop) {
+        stopped = true;
+        return false;
+      }
+
+      this.filter.add(key.decode(raw)[0]);
+
+      return undefined;
+    });
+
+    if (stopped) return;
+
+    this.filter.ready = true;
+
+    this.logger.info(
+      "Address filter rebuilt with %d addresses (%d% false positives).",
+      this.filter.count,
+      (this.filter.getRate() * 100).toFixed(3)
+    );
+  }
+
+  /**
+   * Record an indexed address in the filter.
+   * @param {Buffer} hash
+   */
+
+  addAddress(hash) {
+    if (this.filter) this.filter.add(hash);
+  }
+
+  /**
+   * Update cached addresses for a block which was just written.
+   * @param {Block} block
+   * @param {Number} height
+   * @param {Map?} totals - Balance totals written for the block.
+   */
+
+  cacheBlock(block, height, totals) {
+    if (this.cache) this.cache.connect(block, height, totals);
+  }
+
+  /**
+   * Drop cached addresses after the index was rewritten.
+   */
+
+  resetCache() {
+    if (this.cache) this.cache.reset(this.height);
+  }
+
+  /**
+   * Whether an address has certainly never been indexed.
+   * @param {Address} addr
+   * @returns {Boolean}
+   */
+
+  isUnknown(addr) {
+    if (!this.filter || !this.filter.ready) return false;
+
+    return !this.filter.has(addr.getHash());
+  }
+
+  /**
+   * Create the underlying database for the current location and
+   * profile. Headers and chain metadata go to the `meta` store and
+   * everything else to the `index` store (sharded if more than one
+   * shard is configured), each with its own cache and compaction
+   * settings. The bulk profile only applies to the index store.
+   * @private
+   * @returns {DB}
+   */
+
+  createDB() {
+    const { options } = this;
+    const bulk = this.profile === "bulk";
+
+    const index = Object.assign({}, options, {
+      location: this.legacy ? this.location : path.join(this.location, "index"),
+      cacheSize: options.indexCacheSize,
+      writeBufferSize: bulk
+        ? options.bulkWriteBuffer
+        : options.indexWriteBuffer,
+      maxFileSize: bulk ? options.bulkFileSize : options.indexFileSize
+    });
+
+    const store =
+      index.shards > 1 ? new ShardedDB(index) : backend.create(index);
+
+    if (this.legacy) return store;
+
+    const meta = backend.create(
+      Object.assign({}, options, {
+        location: path.join(this.location, "meta"),
+        cacheSize: options.metaCacheSize,
+        writeBufferSize: options.metaWriteBuffer,
+        maxFileSize: options.metaFileSize,
+        compression: options.metaCompression
+      })
+    );
+
+    return new SplitDB(meta, store);
+  }
+
+  /**
+   * Whether the index on disk keeps everything in a single store.
+   * @private
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async isLegacy() {
+    if (!(await fs.exists(this.location))) return false;
+
+    const names = await fs.readdir(this.location);
+
+    return names.some(name => {
+      return name === "CURRENT" || name === "data.mdb" || /^shard/.test(name);
+    });
+  }
+
+  /**
+   * Make sure an existing index was created
+   * with the configured number of shards.
+   * @private
+   * @returns {Promise}
+   */
+
+  async verifyShards() {
+    const dir = this.legacy ? this.location : path.join(this.location, "index");
+
+    if (!(await fs.exists(dir))) return;
+
+    const names = await fs.readdir(dir);
+    const shards = names.filter(name => /^shard\d{3}$/.test(name)).length;
+    const expect = this.options.shards > 1 ? this.options.shards : 0;
+
+    if (shards !== expect) {
+      throw new Error(
+        `NomenclateDB has ${shards} shards, but ${expect} are configured ` +
+          "(remove the index to change the number of shards)."
+      );
+    }
+  }
+
+  /**
+   * Whether a row written at a height can be served. Stores
+   * are committed separately, so rows above the height
+   * committed on every store are hidden until it catches up.
+   * @param {Number} height
+   * @returns {Boolean}
+   */
+
+  isVisible(height) {
+    return height <= this.visibleHeight();
+  }
+
+  /**
+   * Get the highest height whose rows can be served.
+   * @returns {Number}
+   */
+
+  visibleHeight() {
+    if (!(this.db.db instanceof RoutedDB)) return 0xffffffff;
+
+    return this.db.height;
+  }
+
+  /**
+   * Get the height of the highest store, above the sync
+   * height if a crash left some stores with more blocks.
+   * @returns {Number}
+   */
+
+  getTopHeight() {
+    if (!(this.db.db instanceof RoutedDB)) return this.height;
+
+    return this.db.db.getTop();
+  }
+
+  /**
+   * Get the hash of a block which only some stores have.
+   * @param {Number} height
+   * @returns {Promise} - Returns Buffer, or null.
+   */
+
+  async getHashAhead(height) {
+    const raw = await this.db.db.getHeaderAhead(height);
+
+    if (!raw) return null;
+
+    return Headers.decode(raw).hash();
+  }
+
+  /**
+   * Create a batch undoing a block which only some stores have.
+   * @param {Number} height
+   * @returns {RoutedBatch}
+   */
+
+  rollbackBatch(height) {
+    return this.db.db.rollbackBatch(height);
+  }
+
+  /**
+   * Check the database name and schema version, writing
+   * them if the database is new. Uses the same format
+   * as `bdb`'s `verify`.
+   * @private
+   * @returns {Promise}
+   */
+
+  async verifyVersion() {
+    const key = layout.V.encode();
+    const raw = await this.db.get(key);
+
+    if (!raw) {
+      const value = Buffer.alloc(DB_NAME.length + 4);
+      value.write(DB_NAME, 0, "ascii");
+      value.writeUInt32LE(DB_VERSION, DB_NAME.length, true);
+      await this.db.put(key, value);
+      this.version = DB_VERSION;
+      return;
+    }
+
+    if (
+      raw.length !== DB_NAME.length + 4 ||
+      raw.toString("ascii", 0, DB_NAME.length) !== DB_NAME
+    )
+      throw new Error("Database name mismatch for NomenclateDB.");
+
+    this.version = raw.readUInt32LE(DB_NAME.length, true);
+
+    if (this.version > DB_VERSION)
+      throw new Error("NomenclateDB was created by a newer version.");
+
+    if (this.version < DB_VERSION) {
+      this.logger.warning(
+        "NomenclateDB version %d is outdated (current is %d).",
+        this.version,
+        DB_VERSION
+      );
+    }
+
+    if (this.legacy) {
+      this.logger.warning(
+        "NomenclateDB keeps headers and index rows in one store."
+      );
+    }
+  }
+
+  /**
+   * Whether the index was built with an older layout.
+   * @returns {Boolean}
+   */
+
+  get outdated() {
+    return this.version < DB_VERSION || this.legacy;
+  }
+
+  /**
+   * Finish or clean up after shadow rebuilds. A rebuilt index
+   * keeps running from its shadow directory until we are next
+   * opened, and is recorded in the `.current` file when it is
+   * swapped in. That one is moved into place, replacing the
+   * old index if a crash left it behind, and any other shadow
+   * directory is an unfinished rebuild and is removed.
+   * @private
+   * @returns {Promise}
+   */
+
+  async promoteShadow() {
+    const location = this.options.location;
+    const current = location + ".current";
+    const dir = path.dirname(location);
+    const prefix = path.basename(location) + ".shadow-";
+
+    let live = null;
+
+    if (await fs.exists(current)) {
+      live = path.join(dir, (await fs.readFile(current, "utf8")).trim());
+
+      if (!(await fs.exists(live))) live = null;
+    }
+
+    if (live) {
+      this.logger.info("Promoting rebuilt NomenclateDB.");
+
+      if (await fs.exists(location)) await fs.remove(location);
+
+      await fs.rename(live, location);
+    }
+
+    const names = (await fs.exists(dir)) ? await fs.readdir(dir) : [];
+
+    for (const name of names) {
+      if (!name.startsWith(prefix)) continue;
+
+      this.logger.info("Removing unfinished NomenclateDB rebuild.");
+
+      await fs.remove(path.join(dir, name));
+    }
+
+    if (await fs.exists(current)) await fs.remove(current);
+  }
+
+  /**
+   * Create and open an empty database next to this one,
+   * to be rebuilt and later swapped in with {@link NomenclateDB#swap}.
+   * Each shadow gets a directory of its own, as the one
+   * being served may itself be an earlier shadow.
+   * @returns {Promise} - Returns {@link NomenclateDB}.
+   */
+
+  async openShadow() {
+    this.shadows += 1;
+
+    const location = `${this.options.location}.shadow-${this.shadows}`;
+
+    if (!this.options.memory) await fs.remove(location);
+
+    // The filter is rebuilt from the shadow once it is swapped in.
+    const shadow = new NomenclateDB(
+      Object.assign({}, this.options, {
+        location,
+        addressFilter: false,
+        hotCacheSize: 0,
+        warmStart: false,
+        changeLog: false
+      })
+    );
+
+    await shadow.db.open();
+    await shadow.verifyVersion();
+    await shadow.verifyNetwork();
+
+    return shadow;
+  }
+
+  /**
+   * Close and remove a shadow database.
+   * @param {NomenclateDB} shadow
+   * @returns {Promise}
+   */
+
+  async dropShadow(shadow) {
+    await shadow.close();
+
+    if (!this.options.memory) await fs.remove(shadow.location);
+  }
+
+  /**
+   * Serve from a rebuilt shadow database and remove the old
+   * one. The shadow keeps running from its own directory
+   * and is moved into place the next time we are opened.
+   * Callers must hold the indexer lock.
+   * @param {NomenclateDB} shadow
+   * @returns {Promise}
+   */
+
+  async swap(shadow) {
+    const old = this.db;
+    const oldLocation = this.location;
+
+    if (this.filter) await this.stopFilterRebuild();
+
+    // Record the shadow as the live index first,
+    // so a crash from here on still promotes it.
+    if (!this.options.memory) {
+      const current = this.options.location + ".current";
+
+      await fs.writeFile(current + ".tmp", path.basename(shadow.location));
+      await fs.rename(current + ".tmp", current);
+    }
+
+    this.db = shadow.db;
+    this.location = shadow.location;
+    this.legacy = shadow.legacy;
+    this.indexed = shadow.indexed;
+    this.missing = shadow.missing;
+    this.pruneHeight = shadow.pruneHeight;
+    this.version = shadow.version;
+    this.height = shadow.height;
+
+    await old.close();
+
+    if (this.filter) {
+      this.filter.reset();
+      this.startFilterRebuild();
+    }
+
+    this.resetCache();
+
+    if (this.options.memory) return;
+
+    await fs.remove(oldLocation);
+  }
+
+  /**
+   * Save Block Header to a batch.
+   * @param {Batch} b
+   * @param {Headers} headers
+   * @param {Number} height
+   */
+
+  addHeaders(b, headers, height) {
+    let bw = bio.write();
+
+    bw = headers.write(bw);
+
+    const raw = bw.render();
+
+    b.put(layout.h.encode(height), raw);
+  }
+
+  /**
+   * Return header from the database.
+   * @returns {Promise}
+   */
+
+  async getHeaders(height) {
+    this.touch("header", height);
+
+    return await this.db.get(layout.h.encode(height));
+  }
+
+  /**
+   * Get the hash of the block indexed at a height.
+   * @param {Number} height
+   * @returns {Promise} - Returns Buffer, or null.
+   */
+
+  async getBlockHash(height) {
+    const raw = await this.db.get(layout.h.encode(height));
+
+    if (!raw) return null;
+
+    return Headers.decode(raw).hash();
+  }
+
+  async getHashByHeight(height) {
+    this.touch("header", height);
+
+    let header = await this.db.get(layout.h.encode(height));
+
+    return blake2b.digest(header);
+  }
+
+  /**
+   * Get the transaction which spent an output, from the input
+   * index. Rows are keyed by txid prefix, as they are written.
+   * @param {Buffer} txid
+   * @param {Number} index
+   * @returns {Promise} - Returns Buffer, or null if unspent.
+   */
+
+  async getSpender(txid, index) {
+    return this.db.get(layout.i.encode(txid.slice(0, 8), index));
+  }
+
+  /**
+   * Verify network.
+   * @returns {Promise}
+   */
+
+  async verifyNetwork() {
+    const raw = await this.db.get(layout.O.encode());
+
+    if (!raw) {
+      this.indexed = this.features;
+      this.missing = 0;
+      return this.writeFlags();
+    }
+
+    const magic = raw.readUInt32LE(0, true);
+
+    if (magic !== this.network.magic)
+      throw new Error("Network mismatch for NomenclateDB.");
+
+    // Indexes from before the flags were
+    // recorded always had every row.
+    const indexed = raw.length >= 8 ? raw.readUInt32LE(4, true) : flags.DEFAULT;
+    const disabled = indexed & ~this.features;
+
+    this.indexed = indexed & this.features;
+    this.missing = this.features & ~indexed;
+
+    if (disabled) {
+      this.logger.info(
+        "Disabled indexes: %s (existing rows are kept until a reindex).",
+        flags.toNames(disabled).join(", ")
+      );
+    }
+
+    if (this.missing) {
+      this.logger.info(
+        "Enabled indexes: %s (backfilling).",
+        flags.toNames(this.missing).join(", ")
+      );
+    }
+
+    if (disabled || raw.length < 8) return this.writeFlags();
+
+    return undefined;
+  }
+
+  /**
+   * Record the network and the complete indexes.
+   * @private
+   * @returns {Promise}
+   */
+
+  async writeFlags() {
+    const value = Buffer.allocUnsafe(8);
+    value.writeUInt32LE(this.network.magic, 0, true);
+    value.writeUInt32LE(this.indexed, 4, true);
+    await this.db.put(layout.O.encode(), value);
+  }
+
+  /**
+   * Mark backfilled indexes as complete.
+   * @param {Number} bits
+   * @returns {Promise}
+   */
+
+  async addFlags(bits) {
+    this.indexed |= bits & this.features;
+    this.missing &= ~bits;
+    await this.writeFlags();
+    this.resetCache();
+  }
+
+  /**
+   * Test whether every given index is complete and can be served.
+   * @param {...String} names
+   * @returns {Boolean}
+   */
+
+  hasIndex(...names) {
+    for (const name of names) {
+      if (!(this.indexed & flags.names[name])) return false;
+      if (this.version < INDEX_VERSIONS[name]) return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * Close the nomenclatedb, wait for the database to close.
+   * @returns {Promise}
+   */
+
+  async close() {
+    if (this.warming) {
+      this.warmStop = true;
+      await this.warming;
+    }
+
+    if (this.hotkeys && !this.options.memory)
+      await this.hotkeys.save(this.hotkeysFile, this.network);
+
+    if (this.filter) await this.stopFilterRebuild();
+
+    if (this.filter && this.filter.ready && !this.options.memory)
+      await this.filter.save(this.filterFile, this.network, this.height);
+
+    if (this.changes) await this.changes.close();
+
+    return this.db.close();
+  }
+
+  batch() {
+    return this.db.batch();
+  }
+
+  /**
+   * Create a batch which can span many blocks and
+   * is written in key order (see {@link SortedBatch}).
+   * @returns {SortedBatch}
+   */
+
+  sortedBatch() {
+    return new SortedBatch(this.db);
+  }
+
+  /**
+   * Reopen the database with a different profile. The `bulk`
+   * profile uses large write buffers and table files so that
+   * far fewer compactions run while catching up, `serving`
+   * uses the configured defaults. Reads and writes in flight
+   * are finished first, and new ones wait for the reopen.
+   * @param {String} profile - `bulk` or `serving`.
+   * @returns {Promise}
+   */
+
+  async setProfile(profile) {
+    assert(profile === "bulk" || profile === "serving");
+
+    if (profile === this.profile) return;
+
+    this.profile = profile;
+
+    if (this.options.memory) return;
+
+    await this.db.replace(async () => {
+      const db = this.createDB();
+      await db.open();
+      return db;
+    });
+
+    this.logger.info("NomenclateDB reopened with %s profile.", profile);
+  }
+
+  /**
+   * Run a full manual compaction.
+   * @returns {Promise}
+   */
+
+  async compact() {
+    await this.db.compactRange(Buffer.from([0x00]), Buffer.from([0xff]));
+  }
+
+  /**
+   * Get the size of the database files on disk.
+   * @returns {Promise} - Returns Number.
+   */
+
+  async getDiskSize() {
+    if (this.options.memory) return 0;
+
+    return getDirSize(this.location);
+  }
+
+  /**
+   * Write a snapshot of the index to a file. Blocks must
+   * not be written until `opened` is called.
+   * @param {String} file
+   * @param {Function?} opened
+   * @returns {Promise} - Returns {height, rows}.
+   */
+
+  async exportSnapshot(file, opened) {
+    return snapshot.write(this.db, this.network, file, opened);
+  }
+
+  /**
+   * Read the tip of a snapshot file.
+   * @param {String} file
+   * @returns {Promise} - Returns {height, hash, header, rows}.
+   */
+
+  async readSnapshot(file) {
+    return snapshot.readInfo(file, this.network);
+  }
+
+  /**
+   * Bulk load a snapshot file. The index must be empty. The
+   * snapshot brings its own version and flags, which are
+   * checked as on open: a snapshot from a newer version is
+   * removed again, and an outdated one is rebuilt as usual.
+   * @param {String} file
+   * @param {Object} info
+   * @returns {Promise}
+   */
+
+  async importSnapshot(file, info) {
+    assert(
+      !(await this.db.has(layout.H.encode())),
+      "Cannot import a snapshot into a non-empty NomenclateDB."
+    );
+
+    try {
+      await snapshot.load(this.db, file, info, async () => {
+        if (!this.options.memory) await this.verifyShards();
+        await this.verifyVersion();
+        await this.verifyNetwork();
+      });
+    } catch (e) {
+      await this.clear();
+      throw e;
+    }
+
+    this.height = info.height;
+    this.pruneHeight = await this.getPruneHeight();
+
+    if (this.filter) this.startFilterRebuild();
+
+    this.resetCache();
+  }
+
+  /**
+   * Remove every row, after a failed import.
+   * @private
+   * @returns {Promise}
+   */
+
+  async clear() {
+    const iter = this.db.iterator({
+      keys: true,
+      values: false
+    });
+
+    let b = this.db.batch();
+    let rows = 0;
+
+    await iter.each(async key => {
+      b.del(key);
+
+      if (++rows % 10000 === 0) {
+        await b.write();
+        b = this.db.batch();
+      }
+    });
+
+    await b.write();
+
+    // Back to the state of a new index.
+    await this.verifyVersion();
+    await this.verifyNetwork();
+  }
+
+  //Need to edit this function - add more error checking
+  async setHeight(height) {
+    const b = this.db.batch();
+
+    this.putHeight(b, height);
+
+    await b.write();
+
+    return;
+  }
+
+  /**
+   * Save the sync height to a batch.
+   * @param {Batch} b
+   * @param {Number} height
+   */
+
+  putHeight(b, height) {
+    this.height = height;
+
+    b.put(layout.H.encode(), fromU32(height));
+  }
+
+  async getHeight() {
+    let height = await this.db.get(layout.H.encode());
+
+    if (height == null) {
+      height = 0;
+    } else {
+      height = toU32(height);
+    }
+
+    return height;
+  }
+
+  /**
+   * Get the height below which history has been pruned.
+   * @returns {Promise} - Returns Number.
+   */
+
+  async getPruneHeight() {
+    const raw = await this.db.get(layout.P.encode());
+
+    if (!raw) return 0;
+
+    return toU32(raw);
+  }
+
+  /**
+   * Save the pruned height to a batch.
+   * @param {Batch} b
+   * @param {Number} height
+   */
+
+  putPruneHeight(b, height) {
+    this.pruneHeight = height;
+
+    b.put(layout.P.encode(), fromU32(height));
+  }
+
+  /**
+   * Whether history rows are being pruned.
+   * @returns {Boolean}
+   */
+
+  get pruned() {
+    return this.pruneHeight > 0;
+  }
+
+  /**
+   * Return the funding outputs for an address, confirmed and unconfirmed.
+   * @param addr - {Address}
+   * @returns {Promise} -> {[confirmed: Number, unconfirmed: Number]}
+   */
+  async addressFunding(addr) {
+    if (this.isUnknown(addr)) return [[], []];
+
+    const hash = addr.getHash();
+    const cached = this.cache && this.cache.get(hash, "funding");
+
+    if (cached) return [cached.slice(), []];
+
+    const generation = this.cache ? this.cache.generation : 0;
+
+    let confirmed = await this._addressFunding(addr);
+    let unconfirmed = await this._addressFundingUnconfirmed(addr);
+
+    if (this.cache)
+      this.cache.set(hash, "funding", confirmed.slice(), generation);
+
+    return [confirmed, unconfirmed];
+  }
+
+  async _addressFunding(addr) {
+    let hash = addr.getHash();
+    let funding = [];
+
+    const iter = this.db.iterator({
+      gte: layout.o.min(hash),
+      lte: layout.o.max(hash, this.visibleHeight()),
+      values: true
+    });
+
+    await iter.each(async (key, raw) => {
+      const [, height, , txid] = layout.o.decode(key);
+      const record = FundingRecord.decode(raw);
+
+      for (const [index, value] of record.outputs) {
+        funding.push({
+          tx_hash: txid.toString("hex"),
+          height,
+          output_index: index,
+          value
+        });
+      }
+    });
+
+    return funding;
+  }
+
+  //TODO
+  async _addressFundingUnconfirmed(hash) {
+    return [];
+  }
+
+  async addressSpent(hash, funding) {
+    const key = hash.getHash();
+    const cached = this.cache && this.cache.get(key, "spent");
+
+    if (cached) return [cached.slice(), []];
+
+    const generation = this.cache ? this.cache.generation : 0;
+
+    let confirmed = await this._addressSpent(hash, funding);
+    let unconfirmed = await this._addressSpentUnconfirmed(hash, funding);
+
+    if (this.cache) this.cache.set(key, "spent", confirmed.slice(), generation);
+
+    return [confirmed, unconfirmed];
+  }
+
+  async _addressSpent(addr, funding) {
+    let hash = addr.getHash();
+    let spents = [];
+
+    const iter = this.db.iterator({
+      gte: layout.s.min(hash),
+      lte: layout.s.max(hash, this.visibleHeight()),
+      values: true
+    });
+
+    await iter.each(async (key, raw) => {
+      const [, height, , txid] = layout.s.decode(key);
+      const record = SpendRecord.decode(raw);
+
+      for (const [prev, index, value] of record.inputs) {
+        spents.push({
+          tx_hash: txid.toString("hex"),
+          height,
+          funding_output: [prev.toString("hex"), index],
+          value
+        });
+      }
+    });
+
+    return spents;
+  }
+
+  async _addressSpentUnconfirmed(hash, funding) {
+    return [];
+  }
+
+  //Calculate Balance for an address
+  //TODO might actually be faster to have 1 function for both unconfirmed.
+  //Instead of in each subfunction.
+  async addressBalance(addr) {
+    this.touch("address", addr.getHash());
+
+    if (this.isUnknown(addr))
+      return { confirmed: 0, unconfirmed: 0, received: 0, spent: 0 };
+
+    if (this.hasIndex("balance")) return this.addressAggregate(addr);
+
+    let [fConfirmed, fUnconfirmed] = await this.addressFunding(addr);
+    let [sConfirmed, sUnconfirmed] = await this.addressSpent(addr, fConfirmed);
+
+    let totalFunded = 0;
+    for (let f of fConfirmed) {
+      totalFunded += f.value;
+    }
+
+    let totalSpent = 0;
+    for (let s of sConfirmed) {
+      totalSpent += s.value;
+    }
+
+    let balance = {
+      confirmed: totalFunded - totalSpent,
+      unconfirmed: totalFunded - totalSpent,
+      received: totalFunded,
+      spent: totalSpent
+    };
+
+    return balance;
+  }
+
+  async addressHistory(addr) {
+    this.touch("address", addr.getHash());
+
+    if (this.isUnknown(addr)) return [];
+
+    const merge = this.historyMerge(addr.getHash(), 0);
+
+    try {
+      return await merge.take(Infinity);
+    } finally {
+      await merge.end();
+    }
+  }
+
+  /**
+   * Merge the funding and spend rows of an address.
+   * @private
+   * @param {Buffer} hash
+   * @param {Number} startHeight
+   * @returns {HistoryMerge}
+   */
+
+  historyMerge(hash, startHeight) {
+    const height = this.visibleHeight();
+
+    return new HistoryMerge([
+      new HistoryStream(this.db, layout.o, hash, startHeight, height),
+      new HistoryStream(this.db, layout.s, hash, startHeight, height)
+    ]);
+  }
+
+  /**
+   * Get the Electrum status of an address: the hex SHA-256 of
+   * `txid:height:` for every transaction in its history, oldest
+   * first, then its mempool transactions at height 0 (or -1 if
+   * they spend other mempool transactions), sorted by txid. The
+   * confirmed part is kept up to date by the indexer, so this
+   * is one read plus the mempool. Null if there is no history.
+   * @param {Address} addr
+   * @returns {Promise} - Returns String or null.
+   */
+
+  async addressStatus(addr) {
+    const hash = addr.getHash();
+
+    this.touch("address", hash);
+
+    let status = null;
+
+    if (!this.isUnknown(addr)) {
+      const raw = await this.db.get(layout.e.encode(hash));
+
+      if (raw) status = StatusRecord.decode(raw);
+
+      // Ahead of the history rows other shards have committed.
+      if (status && !this.isVisible(status.height))
+        status = await this.computeStatus(hash, this.visibleHeight());
+    }
+
+    const txs = await this.addressMempool(addr);
+
+    if (!status && txs.length === 0) return null;
+
+    if (!status) status = new StatusRecord();
+
+    for (const { tx_hash, height } of txs)
+      status.add(Buffer.from(tx_hash, "hex"), height);
+
+    return status.ctx.digest().toString("hex");
+  }
+
+  /**
+   * Get the mempool transactions of an address as Electrum
+   * lists them, sorted by txid: at height 0, or -1 if they
+   * spend other mempool transactions, with the fee they pay.
+   * @param {Address} addr
+   * @returns {Promise} - Returns Object[].
+   */
+
+  async addressMempool(addr) {
+    const txs = await this.client.getMempoolTXs(addr);
+    const entries = [];
+
+    for (const tx of txs) {
+      const txid = tx.txid();
+
+      let height = 0;
+
+      for (const input of tx.inputs) {
+        if (await this.client.hasMempoolTX(input.prevout.txid())) {
+          height = -1;
+          break;
+        }
+      }
+
+      const fee = await this.client.getMempoolFee(txid);
+
+      entries.push({
+        tx_hash: txid,
+        height,
+        fee: fee != null ? fee : 0
+      });
+    }
+
+    entries.sort((a, b) => (a.tx_hash < b.tx_hash ? -1 : 1));
+
+    return entries;
+  }
+
+  /**
+   * Hash the status of an address from its history rows,
+   * which needs all of them: refused once any are pruned.
+   * @private
+   * @param {Buffer} hash
+   * @param {Number} height - Last height to include.
+   * @returns {Promise} - Returns StatusRecord, or null if empty.
+   */
+
+  async computeStatus(hash, height) {
+    if (this.pruned) {
+      throw new Error(
+        `Cannot hash a status: history below ${this.pruneHeight} is pruned.`
+      );
+    }
+    const merge = new HistoryMerge(
+      [
+        new HistoryStream(this.db, layout.o, hash, 0, height, false),
+        new HistoryStream(this.db, layout.s, hash, 0, height, false)
+      ],
+      false
+    );
+
+    const status = new StatusRecord();
+
+    let count = 0;
+
+    try {
+      for (let item; (item = await merge.next()); count++) {
+        status.add(Buffer.from(item.tx_hash, "hex"), item.height);
+        status.height = item.height;
+      }
+    } finally {
+      await merge.end();
+    }
+
+    return count > 0 ? status : null;
+  }
+
+  /**
+   * Whether address statuses are indexed.
+   * @returns {Boolean}
+   */
+
+  hasStatus() {
+    return this.hasIndex("address") && this.version >= STATUS_VERSION;
+  }
+
+  /**
+   * Get an address balance from its aggregate row.
+   * @param {Address} addr
+   * @returns {Promise}
+   */
+
+  async addressAggregate(addr) {
+    const agg = await this.getAggregate(addr.getHash());
+    const balance = agg.received - agg.spent;
+
+    return {
+      confirmed: balance,
+      unconfirmed: balance,
+      received: agg.received,
+      spent: agg.spent
+    };
+  }
+
+  /**
+   * Get the totals and history row count of an address.
+   * @private
+   * @param {Buffer} hash
+   * @returns {Promise} - Returns Object.
+   */
+
+  async getAggregate(hash) {
+    const cached = this.cache && this.cache.get(hash, "aggregate");
+
+    if (cached) return cached;
+
+    const generation = this.cache ? this.cache.generation : 0;
+    const raw = await this.db.get(layout.a.encode(hash));
+    const agg = raw ? AggregateRecord.decode(raw) : new AggregateRecord();
+
+    const { received, spent, count } = agg;
+    const result = { received, spent, count };
+
+    if (this.cache) this.cache.set(hash, "aggregate", result, generation);
+
+    return result;
+  }
+
+  /**
+   * Whether address history can be read by segment.
+   * @returns {Boolean}
+   */
+
+  hasSegments() {
+    return this.hasIndex("balance") && this.version >= SEGMENT_VERSION;
+  }
+
+  /**
+   * Get the history segments of an address, oldest first.
+   * @private
+   * @param {Buffer} hash
+   * @returns {Promise} - Returns {@link SegmentRecord}[].
+   */
+
+  async getSegments(hash) {
+    const segments = [];
+
+    const iter = this.db.iterator({
+      gte: layout.g.min(hash),
+      lte: layout.g.max(hash),
+      values: true
+    });
+
+    await iter.each((key, raw) => {
+      segments.push(SegmentRecord.decode(raw));
+    });
+
+    return segments;
   }
 
   /**
-   * Save Block Header to DB.
-   * @returns {Promise}
+   * Read the history rows of a segment, oldest first.
+   * @private
+   * @param {Buffer} hash
+   * @param {SegmentRecord} seg
+   * @returns {Promise} - Returns Object[].
    */
 
-  async addHeaders(headers, height) {
-    let bw = bio.write();
+  async getSegmentRows(hash, seg) {
+    const rows = [];
 
-    bw = headers.write(bw);
+    const iter = this.db.iterator({
+      gte: layout.r.min(hash, seg.start, seg.pos),
+      lte: layout.r.max(hash),
+      limit: seg.count,
+      values: true
+    });
 
-    const raw = bw.render();
+    await iter.each((key, raw) => {
+      const [, height, , txid] = layout.r.decode(key);
+      const row = HistoryRecord.decode(raw);
 
-    return await this.db.put(layout.h.encode(height), raw);
+      rows.push({
+        tx_hash: txid.toString("hex"),
+        height,
+        received: row.received,
+        spent: row.spent
+      });
+    });
+
+    return rows;
   }
 
   /**
-   * Return header from the database.
-   * @returns {Promise}
+   * Count the history rows of an address below a height. Only
+   * segments which straddle the height are read row by row.
+   * @private
+   * @param {Buffer} hash
+   * @param {SegmentRecord[]} segments
+   * @param {Number} height
+   * @returns {Promise} - Returns Number.
    */
 
-  async getHeaders(height) {
-    return await this.db.get(layout.h.encode(height));
-  }
+  async countBelow(hash, segments, height) {
+    let count = 0;
 
-  async getHashByHeight(height) {
-    let header = await this.db.get(layout.h.encode(height));
+    for (const seg of segments) {
+      if (seg.start >= height) break;
 
-    return blake2b.digest(header);
+      if (seg.end < height) {
+        count += seg.count;
+        continue;
+      }
+
+      for (const row of await this.getSegmentRows(hash, seg)) {
+        if (row.height >= height) break;
+        count += 1;
+      }
+    }
+
+    return count;
   }
 
   /**
-   * Verify network.
-   * @returns {Promise}
+   * Get a page of address history, newest first, one row per
+   * transaction. With the balance index, whole segments are
+   * skipped to find the page, so the cost does not grow with
+   * the size of the history. Otherwise the funding and spend
+   * rows are merged up to the page.
+   * @param {Address} addr
+   * @param {Number} offset
+   * @param {Number} limit
+   * @param {Number} [startHeight=0] - Leave out older rows.
+   * @returns {Promise} - Returns {total, result}. The total
+   * is null if it is not known without reading every row.
    */
 
-  async verifyNetwork() {
-    const raw = await this.db.get(layout.O.encode());
+  async addressHistoryPage(addr, offset, limit, startHeight = 0) {
+    this.touch("address", addr.getHash());
 
-    if (!raw) {
-      const b = this.db.batch();
-      b.put(layout.O.encode(), fromU32(this.network.magic));
-      return b.write();
-    }
+    if (this.isUnknown(addr)) return { total: 0, result: [] };
 
-    const magic = raw.readUInt32LE(0, true);
+    const hash = addr.getHash();
 
-    if (magic !== this.network.magic)
-      throw new Error("Network mismatch for NomenclateDB.");
+    if (!this.hasSegments())
+      return this.mergeHistoryPage(hash, offset, limit, startHeight);
+    const segments = await this.getSegments(hash);
 
-    return undefined;
-  }
+    let rows = 0;
 
-  /**
-   * Close the nomenclatedb, wait for the database to close.
-   * @returns {Promise}
-   */
+    for (const seg of segments) rows += seg.count;
 
-  async close() {
-    return this.db.close();
-  }
+    // Positions of the rows in ascending order.
+    const first = await this.countBelow(hash, segments, startHeight);
+    const result = [];
 
-  batch() {
-    return this.db.batch();
-  }
+    let pos = rows - 1 - offset;
 
-  //Need to edit this function - add more error checking
-  async setHeight(height) {
-    this.height = height;
+    while (pos >= first && result.length < limit) {
+      const seg = segments[Math.floor(pos / SEGMENT_ROWS)];
 
-    //Insert into DB.
-    await this.db.put(layout.H.encode(), fromU32(height));
+      if (!seg) break;
 
-    return;
-  }
+      const page = await this.getSegmentRows(hash, seg);
 
-  async getHeight() {
-    let height = await this.db.get(layout.H.encode());
+      for (let i = pos % SEGMENT_ROWS; i >= 0; i--, pos--) {
+        if (pos < first || result.length === limit) break;
 
-    if (height == null) {
-      height = 0;
-    } else {
-      height = toU32(height);
+        if (i < page.length) {
+          const { tx_hash, height } = page[i];
+          result.push({ tx_hash, height });
+        }
+      }
     }
 
-    return height;
+    return { total: rows - first, result };
   }
 
   /**
-   * Return the funding outputs for an address, confirmed and unconfirmed.
-   * @param addr - {Address}
-   * @returns {Promise} -> {[confirmed: Number, unconfirmed: Number]}
+   * Add what a page of history rows paid to and spent from an
+   * address, from its funding and spend rows at the heights of
+   * the page: `outputs` as [index, value] and `inputs` as
+   * [prev txid, index, value].
+   * @param {Address} addr
+   * @param {Object[]} rows - Rows of {@link NomenclateDB#addressHistoryPage}.
+   * @returns {Promise}
    */
-  async addressFunding(addr) {
-    try {
-      let confirmed = await this._addressFunding(addr);
-      let unconfirmed = await this._addressFundingUnconfirmed(addr);
-
-      return [confirmed, unconfirmed];
-    } catch (e) {
-      console.log(e);
-      return;
-    }
-  }
 
-  async _addressFunding(addr) {
-    let hash = addr.getHash();
-    let funding = [];
+  async addHistoryDetails(addr, rows) {
+    const hash = addr.getHash();
+    const heights = new Map();
 
-    const iter = this.db.iterator({
-      gte: layout.o.min(hash),
-      lte: layout.o.max(hash),
-      values: true
-    });
+    for (const row of rows) {
+      row.outputs = [];
+      row.inputs = [];
 
-    await iter.each(async (key, raw) => {
-      const [userHash, txid] = layout.o.decode(key);
+      if (!heights.has(row.height)) heights.set(row.height, new Map());
 
-      let tx = {
-        userHash,
-        tx_hash: txid.toString("hex"),
-        height: toU32(raw)
-      };
+      heights.get(row.height).set(row.tx_hash, row);
+    }
 
-      let newtx = await this.client.getTX(txid);
+    for (const [height, txs] of heights) {
+      const funding = this.db.iterator({
+        gte: layout.o.min(hash, height),
+        lte: layout.o.max(hash, height),
+        values: true
+      });
 
-      let outputIndex;
-      let value;
+      await funding.each((key, raw) => {
+        const [, , , txid] = layout.o.decode(key);
+        const row = txs.get(txid.toString("hex"));
 
-      for (let i = 0; i < newtx.outputs.length; i++) {
-        if (userHash.equals(newtx.outputs[i].address.getHash())) {
-          outputIndex = i;
-          value = newtx.outputs[i].value;
-          break;
-        }
-      }
+        if (row) row.outputs = FundingRecord.decode(raw).outputs;
+      });
 
-      let output = {
-        tx_hash: txid.toString("hex"),
-        height: toU32(raw),
-        output_index: outputIndex,
-        value
-      };
+      const spends = this.db.iterator({
+        gte: layout.s.min(hash, height),
+        lte: layout.s.max(hash, height),
+        values: true
+      });
 
-      funding.push(output);
-    });
+      await spends.each((key, raw) => {
+        const [, , , txid] = layout.s.decode(key);
+        const row = txs.get(txid.toString("hex"));
 
-    return funding;
+        if (row) row.inputs = SpendRecord.decode(raw).inputs;
+      });
+    }
   }
 
-  //TODO
-  async _addressFundingUnconfirmed(hash) {
-    return [];
-  }
+  /**
+   * Get a page of address history by merging its funding and
+   * spend rows, reading only as far as the end of the page. The
+   * total is exact when the page reaches the end of the history
+   * or the address totals count its rows, and null otherwise,
+   * since counting the rest would read all of them.
+   * @private
+   * @param {Buffer} hash
+   * @param {Number} offset
+   * @param {Number} limit
+   * @param {Number} startHeight
+   * @returns {Promise} - Returns {total, result}.
+   */
 
-  async addressSpent(hash, funding) {
-    let confirmed = await this._addressSpent(hash, funding);
-    let unconfirmed = await this._addressSpentUnconfirmed(hash, funding);
+  async mergeHistoryPage(hash, offset, limit, startHeight) {
+    const merge = this.historyMerge(hash, startHeight);
 
-    return [confirmed, unconfirmed];
+    try {
+      const skipped = await merge.skip(offset);
+      const result = await merge.take(limit);
+
+      if (skipped < offset || result.length < limit)
+        return { total: skipped + result.length, result };
+
+      return { total: await this.countHistory(hash, startHeight), result };
+    } finally {
+      await merge.end();
+    }
   }
 
-  async _addressSpent(hash, funding) {
-    let spents = [];
-    for (let o of funding) {
-      let txPrefix = Buffer.from(o.tx_hash, "hex").slice(0, 8);
+  /**
+   * Count the history rows of an address from its totals, if
+   * they count every row from the start height.
+   * @private
+   * @param {Buffer} hash
+   * @param {Number} startHeight
+   * @returns {Promise} - Returns Number or null.
+   */
 
-      const txHashX = await this.db.get(
-        layout.i.encode(txPrefix, o.output_index)
-      );
+  async countHistory(hash, startHeight) {
+    if (startHeight > 0) return null;
 
-      if (txHashX) {
-        // let newtx = await this.client.getTX(txHashX);
-        let height = await this.db.get(layout.t.encode(txHashX));
-        height = toU32(height);
-
-        // let found = false;
-
-        // for (let i = 0; i < newtx.inputs.length; i++) {
-        //   let outpoint = newtx.inputs[i].prevout;
-        //   if (
-        //     outpoint.hash.toString("hex") === o.tx_hash &&
-        //     outpoint.index === o.output_index
-        //   ) {
-        //     found = true;
-
-        //     break;
-        //   }
-        // }
-
-        // if (found) {
-        let spent = {
-          tx_hash: txHashX.toString("hex"),
-          height: height,
-          funding_output: [o.tx_hash, o.output_index],
-          value: o.value
-        };
-        spents.push(spent);
-        // }
-      }
-    }
+    if (!this.hasIndex("balance") || this.version < COUNT_VERSION)
+      return null;
 
-    return spents;
-  }
+    const { count } = await this.getAggregate(hash);
 
-  async _addressSpentUnconfirmed(hash, funding) {
-    return [];
+    return count;
   }
 
-  //Calculate Balance for an address
-  //TODO might actually be faster to have 1 function for both unconfirmed.
-  //Instead of in each subfunction.
-  async addressBalance(addr) {
-    let [fConfirmed, fUnconfirmed] = await this.addressFunding(addr);
-    let [sConfirmed, sUnconfirmed] = await this.addressSpent(addr, fConfirmed);
+  /**
+   * Get the balance of an address as of a height. Segments
+   * below the height are summed without reading their rows.
+   * @param {Address} addr
+   * @param {Number} height
+   * @returns {Promise}
+   */
 
-    let totalFunded = 0;
-    for (let f of fConfirmed) {
-      totalFunded += f.value;
-    }
+  async addressBalanceAt(addr, height) {
+    this.touch("address", addr.getHash());
 
-    let totalSpent = 0;
-    for (let s of sConfirmed) {
-      totalSpent += s.value;
+    let received = 0;
+    let spent = 0;
+
+    if (!this.isUnknown(addr)) {
+      const hash = addr.getHash();
+
+      for (const seg of await this.getSegments(hash)) {
+        if (seg.start > height) break;
+
+        if (seg.end <= height) {
+          received += seg.received;
+          spent += seg.spent;
+          continue;
+        }
+
+        for (const row of await this.getSegmentRows(hash, seg)) {
+          if (row.height > height) break;
+          received += row.received;
+          spent += row.spent;
+        }
+      }
     }
 
-    let balance = {
-      confirmed: totalFunded - totalSpent,
-      unconfirmed: totalFunded - totalSpent,
-      received: totalFunded,
-      spent: totalSpent
+    return {
+      height,
+      confirmed: received - spent,
+      unconfirmed: received - spent,
+      received,
+      spent
     };
-
-    return balance;
   }
 
-  async addressHistory(addr) {
-    let [fConfirmed, fUnconfirmed] = await this.addressFunding(addr);
-    let [sConfirmed, sUnconfirmed] = await this.addressSpent(addr, fConfirmed);
+  /**
+   * Get the unspent outputs of an address from its UTXO rows.
+   * @param {Address} addr
+   * @returns {Promise}
+   */
 
-    let txs = [];
+  async addressCoins(addr) {
+    const txs = [];
 
-    for (let f of fConfirmed) {
-      let newtx = {
-        tx_hash: f.tx_hash,
-        height: f.height
-      };
-      txs.push(newtx);
-    }
+    await this.eachCoin(addr.getHash(), (txid, index, coin) => {
+      txs.push({
+        tx_hash: txid.toString("hex"),
+        height: coin.height,
+        tx_pos: index,
+        value: coin.value
+      });
+    });
 
-    for (let s of sConfirmed) {
-      let newtx = {
-        tx_hash: s.tx_hash,
-        height: s.height
-      };
-      txs.push(newtx);
-    }
+    return txs;
+  }
 
-    //TODO implement mempool txs.
-    //Probably implement this through the client.
+  /**
+   * Call `cb` with (txid, index, UnspentRecord) for every
+   * unspent output of an address in the balance index.
+   * @param {Buffer} hash
+   * @param {Function} cb
+   * @returns {Promise}
+   */
 
-    return txs;
+  async eachCoin(hash, cb) {
+    const iter = this.db.iterator({
+      gte: layout.u.min(hash),
+      lte: layout.u.max(hash),
+      values: true
+    });
+
+    await iter.each(async (key, raw) => {
+      const [, txid, index] = layout.u.decode(key);
+      const coin = UnspentRecord.decode(raw);
+
+      if (!this.isVisible(coin.height)) return;
+
+      await cb(txid, index, coin);
+    });
   }
 
   async addressUnspent(addr) {
+    this.touch("address", addr.getHash());
+
+    if (this.isUnknown(addr)) return [];
+
+    if (this.hasIndex("balance")) return this.addressCoins(addr);
+
     let [fConfirmed, fUnconfirmed] = await this.addressFunding(addr);
     let [sConfirmed, sUnconfirmed] = await this.addressSpent(addr, fConfirmed);
 
@@ -334,7 +1891,8 @@ class NomenclateDB extends EventEmitter {
     }
 
     for (let s of sConfirmed) {
-      txs = txs.filter(tx => tx.tx_hash !== s.funding_output[0]);
+      const [hash, index] = s.funding_output;
+      txs = txs.filter(tx => tx.tx_hash !== hash || tx.tx_pos !== index);
     }
 
     return txs;
@@ -343,6 +1901,29 @@ class NomenclateDB extends EventEmitter {
   async nameHistory(nameHash) {
     let auctionList = [];
 
+    await this.eachNameTX(nameHash, (txid, height) => {
+      let tx = {
+        tx_hash: txid.toString("hex"),
+        height: height
+      };
+
+      auctionList.push(tx);
+    });
+
+    return auctionList;
+  }
+
+  /**
+   * Call `cb` with (txid, height) for every transaction
+   * of a name, in txid order.
+   * @param {Buffer} nameHash
+   * @param {Function} cb
+   * @returns {Promise}
+   */
+
+  async eachNameTX(nameHash, cb) {
+    this.touch("name", nameHash);
+
     const iter = this.db.iterator({
       gte: layout.n.min(nameHash),
       lte: layout.n.max(nameHash),
@@ -351,16 +1932,12 @@ class NomenclateDB extends EventEmitter {
 
     await iter.each(async (key, raw) => {
       const [, txid] = layout.n.decode(key);
+      const height = toU32(raw);
 
-      let tx = {
-        tx_hash: txid.toString("hex"),
-        height: toU32(raw)
-      };
+      if (!this.isVisible(height)) return;
 
-      auctionList.push(tx);
+      await cb(txid, height);
     });
-
-    return auctionList;
   }
 }
 
@@ -381,8 +1958,31 @@ class NomenclateOptions {
     this.maxFiles = 64;
     this.cacheSize = 16 << 20;
     this.compression = true;
+    this.bulkWriteBuffer = 256 << 20;
+    this.bulkFileSize = 64 << 20;
+    this.shards = 1;
+    this.backend = "leveldb";
+    this.mapSize = 2 ** 40;
+    this.indexCacheSize = null;
+    this.indexWriteBuffer = 4 << 20;
+    this.indexFileSize = 2 << 20;
+    this.metaCacheSize = 4 << 20;
+    this.metaWriteBuffer = 4 << 20;
+    this.metaFileSize = 32 << 20;
+    this.metaCompression = false;
+    this.features = flags.DEFAULT;
+    this.addressFilter = true;
+    this.addressFilterSize = 64 << 20;
+    this.hotCacheSize = 32 << 20;
+    this.warmStart = true;
+    this.changeLog = false;
+    this.changeLogSegmentSize = 64 << 20;
+    this.changeLogRetention = 1024 << 20;
+    this.proofCacheBlocks = 32;
 
     if (options) this._fromOptions(options);
+
+    if (this.indexCacheSize == null) this.indexCacheSize = this.cacheSize;
   }
 
   /**
@@ -438,6 +2038,117 @@ class NomenclateOptions {
       this.compression = options.compression;
     }
 
+    if (options.bulkWriteBuffer != null) {
+      assert(Number.isSafeInteger(options.bulkWriteBuffer));
+      this.bulkWriteBuffer = options.bulkWriteBuffer;
+    }
+
+    if (options.bulkFileSize != null) {
+      assert(Number.isSafeInteger(options.bulkFileSize));
+      this.bulkFileSize = options.bulkFileSize;
+    }
+
+    if (options.shards != null) {
+      assert(options.shards >>> 0 === options.shards);
+      assert(options.shards >= 1 && options.shards <= 256);
+      this.shards = options.shards;
+    }
+
+    if (options.backend != null) {
+      assert(backend.types.includes(options.backend), "Unknown backend.");
+      this.backend = options.backend;
+    }
+
+    if (options.mapSize != null) {
+      assert(Number.isSafeInteger(options.mapSize) && options.mapSize > 0);
+      this.mapSize = options.mapSize;
+    }
+
+    if (options.indexCacheSize != null) {
+      assert(Number.isSafeInteger(options.indexCacheSize));
+      this.indexCacheSize = options.indexCacheSize;
+    }
+
+    if (options.indexWriteBuffer != null) {
+      assert(Number.isSafeInteger(options.indexWriteBuffer));
+      this.indexWriteBuffer = options.indexWriteBuffer;
+    }
+
+    if (options.indexFileSize != null) {
+      assert(Number.isSafeInteger(options.indexFileSize));
+      this.indexFileSize = options.indexFileSize;
+    }
+
+    if (options.metaCacheSize != null) {
+      assert(Number.isSafeInteger(options.metaCacheSize));
+      this.metaCacheSize = options.metaCacheSize;
+    }
+
+    if (options.metaWriteBuffer != null) {
+      assert(Number.isSafeInteger(options.metaWriteBuffer));
+      this.metaWriteBuffer = options.metaWriteBuffer;
+    }
+
+    if (options.metaFileSize != null) {
+      assert(Number.isSafeInteger(options.metaFileSize));
+      this.metaFileSize = options.metaFileSize;
+    }
+
+    if (options.metaCompression != null) {
+      assert(typeof options.metaCompression === "boolean");
+      this.metaCompression = options.metaCompression;
+    }
+
+    if (options.features != null) {
+      assert(options.features >>> 0 === options.features);
+      assert((options.features & ~flags.ALL) === 0, "Unknown index flags.");
+      this.features = options.features;
+    }
+
+    if (options.addressFilter != null) {
+      assert(typeof options.addressFilter === "boolean");
+      this.addressFilter = options.addressFilter;
+    }
+
+    if (options.addressFilterSize != null) {
+      assert(Number.isSafeInteger(options.addressFilterSize));
+      assert(options.addressFilterSize >= 64);
+      this.addressFilterSize = options.addressFilterSize;
+    }
+
+    if (options.hotCacheSize != null) {
+      assert(Number.isSafeInteger(options.hotCacheSize));
+      assert(options.hotCacheSize >= 0);
+      this.hotCacheSize = options.hotCacheSize;
+    }
+
+    if (options.warmStart != null) {
+      assert(typeof options.warmStart === "boolean");
+      this.warmStart = options.warmStart;
+    }
+
+    if (options.changeLog != null) {
+      assert(typeof options.changeLog === "boolean");
+      this.changeLog = options.changeLog;
+    }
+
+    if (options.changeLogSegmentSize != null) {
+      assert(Number.isSafeInteger(options.changeLogSegmentSize));
+      assert(options.changeLogSegmentSize > 0);
+      this.changeLogSegmentSize = options.changeLogSegmentSize;
+    }
+
+    if (options.changeLogRetention != null) {
+      assert(Number.isSafeInteger(options.changeLogRetention));
+      assert(options.changeLogRetention > 0);
+      this.changeLogRetention = options.changeLogRetention;
+    }
+
+    if (options.proofCacheBlocks != null) {
+      assert(options.proofCacheBlocks >>> 0 === options.proofCacheBlocks);
+      this.proofCacheBlocks = options.proofCacheBlocks;
+    }
+
     return this;
   }
 
@@ -467,4 +2178,22 @@ function toU32(buf) {
   return num;
 }
 
+function yieldIO() {
+  return new Promise(resolve => setImmediate(resolve));
+}
+
+async function getDirSize(dir) {
+  let total = 0;
+
+  for (const name of await fs.readdir(dir)) {
+    const file = path.join(dir, name);
+    const stat = await fs.stat(file);
+
+    if (stat.isDirectory()) total += await getDirSize(file);
+    else total += stat.size;
+  }
+
+  return total;
+}
+
 module.exports = NomenclateDB;
@@ -9,9 +9,14 @@
 
 const EventEmitter = require("events");
 const ChainClient = require("./chainclient");
+const MultiClient = require("./multiclient");
+const BlockReader = require("./blockreader");
 const NomenclateDB = require("./nomenclatedb.js");
 const Indexer = require("./indexer.js");
 const HTTP = require("./http");
+const RPCServer = require("./rpc");
+const BinaryServer = require("./binary");
+const config = require("./config");
 const { Network } = require("hsd");
 
 /**
@@ -36,55 +41,73 @@ class Plugin extends EventEmitter {
     this.logger = node.logger;
     this.prefix = node.config.prefix;
 
-    this.client = new ChainClient(node.chain);
+    this.client = new ChainClient(node);
 
-    this.httpEnabled = this.config.bool("http-enabled", true);
-    this.rpcEnabled = this.config.bool("rpc-enabled", true);
-    this.grpcEnabled = this.config.bool("grpc-enabled", false);
+    // Cross-check the local chain against other daemons.
+    const remotes = config.createRemotes(this.config, this.network);
 
-    console.log("connecting to: %s", node.network);
+    if (remotes.length > 0) {
+      this.client = new MultiClient(
+        Object.assign(config.multiOptions(this.config), {
+          logger: this.logger,
+          clients: [this.client, ...remotes]
+        })
+      );
+    }
 
-    //Init DB here
-    this.ndb = new NomenclateDB({
+    const base = {
       network: this.network,
       logger: this.logger,
-      client: this.client,
-      memory: this.config.bool("memory", node.memory),
-      prefix: this.prefix,
-      maxFiles: this.config.uint("max-files"),
-      cacheSize: this.config.mb("cache-size")
-    });
+      client: this.client
+    };
 
-    this.indexer = new Indexer({
-      network: this.network,
-      logger: this.logger,
-      client: this.client,
-      ndb: this.ndb
-    });
+    //Init DB here
+    this.ndb = new NomenclateDB(
+      Object.assign(
+        config.dbOptions(this.config, this.prefix, node.memory),
+        base
+      )
+    );
+
+    this.reader = null;
 
-    if (this.httpEnabled) {
-      //Init http here
-      this.http = new HTTP({
-        network: this.network,
-        logger: this.logger,
+    const reader = config.readerOptions(this.config, this.prefix);
+
+    if (reader) this.reader = new BlockReader(Object.assign(reader, base));
+
+    this.indexer = new Indexer(
+      Object.assign(config.indexerOptions(this.config), base, {
         ndb: this.ndb,
-        client: this.client,
-        node: node,
-        // prefix: this.prefix,
-        ssl: this.config.bool("ssl"),
-        keyFile: this.config.path("ssl-key"),
-        certFile: this.config.path("ssl-cert"),
-        host: this.config.str("http-host"),
-        port: this.config.uint("http-port"),
-        apiKey: this.config.str("api-key", node.config.str("api-key")),
-        noAuth: this.config.bool("no-auth"),
-        cors: this.config.bool("cors")
-      });
-    }
+        reader: this.reader
+      })
+    );
+
+    const services = Object.assign({}, base, {
+      ndb: this.ndb,
+      indexer: this.indexer
+    });
+
+    this.http = null;
+
+    //Init http here
+    const http = config.httpOptions(this.config, node.config.str("api-key"));
+
+    if (http) this.http = new HTTP(Object.assign(http, services));
 
-    //Init RPC here
-    //
-    //Init GRPC here
+    this.rpc = null;
+
+    const rpc = config.rpcOptions(this.config);
+
+    if (rpc) this.rpc = new RPCServer(Object.assign(rpc, services));
+
+    this.binary = null;
+
+    const binary = config.binaryOptions(
+      this.config,
+      node.config.str("api-key")
+    );
+
+    if (binary) this.binary = new BinaryServer(Object.assign(binary, services));
 
     this.init();
   }
@@ -92,7 +115,12 @@ class Plugin extends EventEmitter {
   init() {
     this.ndb.on("error", err => this.emit("error", err));
     this.indexer.on("error", err => this.emit("error", err));
-    this.http.on("error", err => this.emit("error", err));
+
+    if (this.http) this.http.on("error", err => this.emit("error", err));
+
+    if (this.rpc) this.rpc.on("error", err => this.emit("error", err));
+
+    if (this.binary) this.binary.on("error", err => this.emit("error", err));
   }
 
   //Going to open the http server here and the database
@@ -101,11 +129,25 @@ class Plugin extends EventEmitter {
 
     await this.indexer.open();
 
-    await this.http.open();
+    if (this.http) await this.http.open();
+
+    if (this.rpc) await this.rpc.open();
+
+    if (this.binary) await this.binary.open();
   }
 
-  //Close the db and the http server.
-  async close() {}
+  //Close the db and the http and rpc servers.
+  async close() {
+    if (this.binary) await this.binary.close();
+
+    if (this.rpc) await this.rpc.close();
+
+    if (this.http) await this.http.close();
+
+    await this.indexer.close();
+
+    await this.ndb.close();
+  }
 }
 
 /**
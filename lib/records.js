@@ -0,0 +1,352 @@
+/*!
+ * records.js - index records for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const bio = require("bufio");
+const SHA256 = require("./sha256");
+
+/**
+ * Coin Record
+ * An output's value, height and address hash (`c` rows).
+ * @alias module:nomenclate.CoinRecord
+ */
+
+class CoinRecord extends bio.Struct {
+  constructor(value, height, hash) {
+    super();
+
+    this.value = value || 0;
+    this.height = height || 0;
+    this.hash = hash || Buffer.alloc(0);
+  }
+
+  getSize() {
+    return 12 + bio.sizeVarBytes(this.hash);
+  }
+
+  write(bw) {
+    bw.writeU64(this.value);
+    bw.writeU32(this.height);
+    bw.writeVarBytes(this.hash);
+    return bw;
+  }
+
+  read(br) {
+    this.value = br.readU64();
+    this.height = br.readU32();
+    this.hash = br.readVarBytes();
+    return this;
+  }
+}
+
+/**
+ * Unspent Record
+ * An unspent output of an address (`u` rows).
+ * @alias module:nomenclate.UnspentRecord
+ */
+
+class UnspentRecord extends bio.Struct {
+  constructor(value, height) {
+    super();
+
+    this.value = value || 0;
+    this.height = height || 0;
+  }
+
+  getSize() {
+    return 12;
+  }
+
+  write(bw) {
+    bw.writeU64(this.value);
+    bw.writeU32(this.height);
+    return bw;
+  }
+
+  read(br) {
+    this.value = br.readU64();
+    this.height = br.readU32();
+    return this;
+  }
+}
+
+/**
+ * Aggregate Record
+ * Address totals (`a` rows), and the number of history rows
+ * of the address. The height is the last block applied, so
+ * a block replayed after a crash is not counted twice.
+ * @alias module:nomenclate.AggregateRecord
+ */
+
+class AggregateRecord extends bio.Struct {
+  constructor() {
+    super();
+
+    this.received = 0;
+    this.spent = 0;
+    this.height = 0;
+    this.count = 0;
+  }
+
+  get balance() {
+    return this.received - this.spent;
+  }
+
+  getSize() {
+    return 24;
+  }
+
+  write(bw) {
+    bw.writeU64(this.received);
+    bw.writeU64(this.spent);
+    bw.writeU32(this.height);
+    bw.writeU32(this.count);
+    return bw;
+  }
+
+  read(br) {
+    this.received = br.readU64();
+    this.spent = br.readU64();
+    this.height = br.readU32();
+    // Rows written before history rows were counted.
+    this.count = br.left() >= 4 ? br.readU32() : 0;
+    return this;
+  }
+}
+
+/**
+ * Funding Record
+ * The outputs a transaction paid to an address (`o` rows).
+ * @alias module:nomenclate.FundingRecord
+ */
+
+class FundingRecord extends bio.Struct {
+  constructor() {
+    super();
+
+    // [index, value] pairs.
+    this.outputs = [];
+  }
+
+  getSize() {
+    return bio.sizeVarint(this.outputs.length) + this.outputs.length * 12;
+  }
+
+  write(bw) {
+    bw.writeVarint(this.outputs.length);
+
+    for (const [index, value] of this.outputs) {
+      bw.writeU32(index);
+      bw.writeU64(value);
+    }
+
+    return bw;
+  }
+
+  read(br) {
+    const count = br.readVarint();
+
+    for (let i = 0; i < count; i++)
+      this.outputs.push([br.readU32(), br.readU64()]);
+
+    return this;
+  }
+}
+
+/**
+ * Spend Record
+ * The outputs of an address a transaction spent (`s` rows).
+ * @alias module:nomenclate.SpendRecord
+ */
+
+class SpendRecord extends bio.Struct {
+  constructor() {
+    super();
+
+    // [txid, index, value] triples.
+    this.inputs = [];
+  }
+
+  getSize() {
+    let size = bio.sizeVarint(this.inputs.length);
+
+    for (const [hash] of this.inputs) size += bio.sizeVarBytes(hash) + 12;
+
+    return size;
+  }
+
+  write(bw) {
+    bw.writeVarint(this.inputs.length);
+
+    for (const [hash, index, value] of this.inputs) {
+      bw.writeVarBytes(hash);
+      bw.writeU32(index);
+      bw.writeU64(value);
+    }
+
+    return bw;
+  }
+
+  read(br) {
+    const count = br.readVarint();
+
+    for (let i = 0; i < count; i++)
+      this.inputs.push([br.readVarBytes(), br.readU32(), br.readU64()]);
+
+    return this;
+  }
+}
+
+/**
+ * History Record
+ * What a transaction paid to and spent from an address
+ * (`r` rows).
+ * @alias module:nomenclate.HistoryRecord
+ */
+
+class HistoryRecord extends bio.Struct {
+  constructor(received, spent) {
+    super();
+
+    this.received = received || 0;
+    this.spent = spent || 0;
+  }
+
+  getSize() {
+    return 16;
+  }
+
+  write(bw) {
+    bw.writeU64(this.received);
+    bw.writeU64(this.spent);
+    return bw;
+  }
+
+  read(br) {
+    this.received = br.readU64();
+    this.spent = br.readU64();
+    return this;
+  }
+}
+
+/**
+ * Segment Record
+ * Summary of `SEGMENT_ROWS` consecutive history rows of an
+ * address (`g` rows): how many there are, their totals, the
+ * block position of the first row and the height range they
+ * cover. The
+ * end height is an upper bound, since disconnecting a block
+ * only lowers it to the height below that block.
+ * @alias module:nomenclate.SegmentRecord
+ */
+
+class SegmentRecord extends bio.Struct {
+  constructor() {
+    super();
+
+    this.count = 0;
+    this.received = 0;
+    this.spent = 0;
+    this.start = 0;
+    this.end = 0;
+    this.pos = 0;
+  }
+
+  get balance() {
+    return this.received - this.spent;
+  }
+
+  getSize() {
+    return 32;
+  }
+
+  write(bw) {
+    bw.writeU32(this.count);
+    bw.writeU64(this.received);
+    bw.writeU64(this.spent);
+    bw.writeU32(this.start);
+    bw.writeU32(this.end);
+    bw.writeU32(this.pos);
+    return bw;
+  }
+
+  read(br) {
+    this.count = br.readU32();
+    this.received = br.readU64();
+    this.spent = br.readU64();
+    this.start = br.readU32();
+    this.end = br.readU32();
+    this.pos = br.readU32();
+    return this;
+  }
+}
+
+/**
+ * Status Record
+ * The Electrum status of an address (`e` rows): a SHA-256
+ * midstate over `txid:height:` for every transaction in its
+ * history, oldest first, and the last height hashed into it.
+ * Undo rows (`E` rows) hold the record from before a block.
+ * @alias module:nomenclate.StatusRecord
+ */
+
+class StatusRecord extends bio.Struct {
+  constructor() {
+    super();
+
+    this.height = 0;
+    this.ctx = new SHA256();
+  }
+
+  /**
+   * Add a transaction to the history.
+   * @param {Buffer} txid
+   * @param {Number} height
+   */
+
+  add(txid, height) {
+    const entry = txid.toString("hex") + ":" + height.toString(10) + ":";
+    this.ctx.update(Buffer.from(entry, "ascii"));
+  }
+
+  getSize() {
+    return 4 + this.ctx.getSize();
+  }
+
+  write(bw) {
+    bw.writeU32(this.height);
+    this.ctx.write(bw);
+    return bw;
+  }
+
+  read(br) {
+    this.height = br.readU32();
+    this.ctx.read(br);
+    return this;
+  }
+}
+
+/*
+ * Constants
+ */
+
+// History rows summarized by each segment.
+const SEGMENT_ROWS = 1000;
+
+/*
+ * Expose
+ */
+
+exports.CoinRecord = CoinRecord;
+exports.UnspentRecord = UnspentRecord;
+exports.AggregateRecord = AggregateRecord;
+exports.FundingRecord = FundingRecord;
+exports.SpendRecord = SpendRecord;
+exports.HistoryRecord = HistoryRecord;
+exports.SegmentRecord = SegmentRecord;
+exports.StatusRecord = StatusRecord;
+exports.SEGMENT_ROWS = SEGMENT_ROWS;
@@ -0,0 +1,503 @@
+/*!
+ * remoteclient.js - remote chain client for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const AsyncEmitter = require("bevent");
+const { NodeClient } = require("hs-client");
+const { Network, ChainEntry, Block, TX } = require("hsd");
+
+/**
+ * Remote Client
+ * Talks to hsd over its HTTP and websocket node API so that
+ * Nomenclate can be run outside of the hsd process. Exposes
+ * the same interface as {@link ChainClient}.
+ * @alias module:nomenclate.RemoteClient
+ */
+
+class RemoteClient extends AsyncEmitter {
+  /**
+   * Create a remote client.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    super();
+
+    this.options = new RemoteClientOptions(options);
+
+    this.network = this.options.network;
+    this.client = new NodeClient({
+      network: this.network.type,
+      host: this.options.host,
+      port: this.options.port,
+      ssl: this.options.ssl,
+      apiKey: this.options.apiKey,
+      timeout: this.options.timeout
+    });
+
+    this.opened = false;
+    this.tip = null;
+
+    // Whether to fetch blocks for chain events. Clients
+    // only used for lookups just follow the tip.
+    this.watching = true;
+
+    this.init();
+  }
+
+  /**
+   * Initialize the client.
+   */
+
+  init() {
+    this.client.on("error", err => this.emit("error", err));
+
+    this.client.on("connect", async () => {
+      try {
+        this.tip = await this._getTip();
+      } catch (e) {
+        this.emit("error", e);
+        return;
+      }
+
+      this.emit("connect");
+    });
+
+    this.client.on("disconnect", () => {
+      this.emit("disconnect");
+    });
+
+    // The node only sends filtered transactions with
+    // `block connect`, so we listen for the bare entry
+    // and fetch the full block ourselves.
+    this.client.bind("chain connect", async raw => {
+      try {
+        const entry = ChainEntry.decode(raw);
+
+        if (!this.watching) {
+          this.tip = entry;
+          return;
+        }
+
+        const block = await this.getBlock(entry.hash);
+
+        this.tip = entry;
+
+        await this.emitAsync("block connect", entry, block);
+      } catch (e) {
+        this.emit("error", e);
+      }
+    });
+
+    this.client.bind("chain disconnect", async raw => {
+      try {
+        const entry = ChainEntry.decode(raw);
+
+        if (!this.watching) {
+          this.tip = await this._getTip();
+          return;
+        }
+
+        const block = await this.getBlock(entry.hash);
+
+        this.tip = await this._getTip();
+
+        await this.emitAsync("block disconnect", entry, block);
+      } catch (e) {
+        this.emit("error", e);
+      }
+    });
+
+    this.client.bind("chain reset", async raw => {
+      try {
+        const tip = ChainEntry.decode(raw);
+
+        this.tip = tip;
+
+        await this.emitAsync("chain reset", tip);
+      } catch (e) {
+        this.emit("error", e);
+      }
+    });
+  }
+
+  /**
+   * Open the client.
+   * @returns {Promise}
+   */
+
+  async open() {
+    assert(!this.opened, "RemoteClient is already open.");
+    this.opened = true;
+
+    await this.client.open();
+
+    // The socket's connect handler sets the tip too, but
+    // only after open returns, and callers need it now.
+    this.tip = await this._getTip();
+  }
+
+  /**
+   * Close the client.
+   * @returns {Promise}
+   */
+
+  async close() {
+    assert(this.opened, "RemoteClient is not open.");
+    this.opened = false;
+
+    await this.client.close();
+  }
+
+  /**
+   * Turn fetching blocks for chain events on or off.
+   * @param {Boolean} watching
+   */
+
+  watch(watching) {
+    assert(typeof watching === "boolean");
+    this.watching = watching;
+  }
+
+  /**
+   * Add a listener.
+   * @param {String} type
+   * @param {Function} handler
+   */
+
+  bind(type, handler) {
+    return this.on(type, handler);
+  }
+
+  /**
+   * Add a listener.
+   * @param {String} type
+   * @param {Function} handler
+   */
+
+  hook(type, handler) {
+    return this.on(type, handler);
+  }
+
+  /**
+   * Get chain tip. The tip is cached from the
+   * node's chain events so this stays synchronous
+   * like {@link ChainClient#getTip}.
+   * @returns {ChainEntry}
+   */
+
+  getTip() {
+    return this.tip;
+  }
+
+  /**
+   * Fetch chain tip from the node.
+   * @private
+   * @returns {Promise}
+   */
+
+  async _getTip() {
+    const raw = await this.client.getTip();
+    assert(raw, "RemoteClient: Node returned no tip.");
+    return ChainEntry.decode(raw);
+  }
+
+  /**
+   * Get hash range.
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise}
+   */
+
+  async getHashes(start = -1, end = -1) {
+    const hashes = await this.client.getHashes(start, end);
+    return hashes.map(hash => toHash(hash));
+  }
+
+  /**
+   * Get chain entry. Returns null if the
+   * entry is not in the main chain.
+   * @param {Hash/Number} hash
+   * @returns {Promise}
+   */
+
+  async getEntry(hash) {
+    if (Buffer.isBuffer(hash)) hash = hash.toString("hex");
+
+    const raw = await this.client.getEntry(hash);
+
+    if (!raw) return null;
+
+    return ChainEntry.decode(raw);
+  }
+
+  /**
+   * Get block
+   * @param {Hash} hash
+   * @returns {Promise}
+   */
+
+  async getBlock(hash) {
+    const raw = await this.getRawBlock(hash);
+
+    if (!raw) return null;
+
+    return Block.decode(raw);
+  }
+
+  /**
+   * Get a serialized block without decoding it.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async getRawBlock(hash) {
+    if (Buffer.isBuffer(hash)) hash = hash.toString("hex");
+
+    const hex = await this.client.execute("getblock", [hash, false]);
+
+    if (!hex) return null;
+
+    return Buffer.from(hex, "hex");
+  }
+
+  /**
+   * Get a range of main chain entries and blocks. All
+   * blocks are requested with a single batched RPC call
+   * and the entries are pipelined over the websocket.
+   * @param {Number} start
+   * @param {Number} end
+   * @returns {Promise} - Returns [ChainEntry, Block][].
+   */
+
+  async getBlocks(start, end) {
+    assert(start <= end);
+
+    const hashes = await this.getHashes(start, end);
+
+    assert(
+      hashes.length === end - start + 1,
+      "RemoteClient: Node returned a short hash range."
+    );
+
+    const calls = hashes.map((hash, i) => {
+      return {
+        method: "getblock",
+        params: [hash.toString("hex"), false],
+        id: i
+      };
+    });
+
+    const [entries, results] = await Promise.all([
+      Promise.all(hashes.map(hash => this.getEntry(hash))),
+      this.client.post("/", calls)
+    ]);
+
+    assert(Array.isArray(results), "RemoteClient: Bad batch response.");
+
+    const blocks = [];
+
+    for (const res of results) {
+      if (res.error)
+        throw new Error("RemoteClient: " + res.error.message);
+
+      const entry = entries[res.id];
+      const block = Block.decode(Buffer.from(res.result, "hex"));
+
+      assert(entry, "RemoteClient: Block is no longer in main chain.");
+      assert(block.hash().equals(entry.hash));
+
+      blocks[res.id] = [entry, block];
+    }
+
+    return blocks;
+  }
+
+  /**
+   * Get transaction with metadata. Requires the node
+   * to be running with the transaction index.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns {tx, height, block, mtime}.
+   */
+
+  async getMeta(hash) {
+    if (Buffer.isBuffer(hash)) hash = hash.toString("hex");
+
+    const json = await this.client.getTX(hash);
+
+    if (!json) return null;
+
+    return {
+      tx: TX.decode(Buffer.from(json.hex, "hex")),
+      height: json.height,
+      block: json.block ? Buffer.from(json.block, "hex") : null,
+      mtime: json.mtime
+    };
+  }
+
+  /**
+   * Get tx
+   * @param {Hash} hash
+   * @returns {Promise}
+   */
+
+  async getTX(hash) {
+    const meta = await this.getMeta(hash);
+
+    if (!meta) return null;
+
+    return meta.tx;
+  }
+
+  /**
+   * Broadcast a transaction through the node.
+   * @param {TX} tx
+   * @returns {Promise}
+   */
+
+  async sendTX(tx) {
+    return this.client.broadcast(tx.toHex());
+  }
+
+  /**
+   * Estimate a fee rate.
+   * @param {Number} blocks
+   * @returns {Promise}
+   */
+
+  async estimateFee(blocks) {
+    const json = await this.client.estimateFee(blocks);
+    return json.rate;
+  }
+
+  /**
+   * Get mempool transactions for an address. The node API
+   * does not expose the mempool address index, so this is
+   * always empty in standalone mode.
+   * @param {Address} addr
+   * @returns {Promise}
+   */
+
+  async getMempoolTXs(addr) {
+    return [];
+  }
+
+  /**
+   * Test whether a transaction is in the mempool. Always
+   * false, as there are no mempool transactions to check.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async hasMempoolTX(hash) {
+    return false;
+  }
+
+  /**
+   * Get the fee a mempool transaction pays. Always
+   * null, as there are no mempool transactions.
+   * @param {Hash} hash
+   * @returns {Promise} - Returns Number, or null if not found.
+   */
+
+  async getMempoolFee(hash) {
+    return null;
+  }
+
+  /**
+   * Get previous entry.
+   * @param {Block} block
+   * @returns {Promise} - Returns ChainEntry.
+   */
+
+  getPrevious(block) {
+    return this.getEntry(block.prevBlock);
+  }
+}
+
+class RemoteClientOptions {
+  /**
+   * Create remote client options.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    this.network = Network.primary;
+    this.host = "127.0.0.1";
+    this.port = this.network.rpcPort;
+    this.ssl = false;
+    this.apiKey = null;
+    this.timeout = 60000;
+
+    if (options) this._fromOptions(options);
+  }
+
+  _fromOptions(options) {
+    if (options.network != null) {
+      this.network = Network.get(options.network);
+      this.port = this.network.rpcPort;
+    }
+
+    if (options.host != null) {
+      assert(typeof options.host === "string");
+      this.host = options.host;
+    }
+
+    if (options.port != null) {
+      assert(
+        (options.port & 0xffff) === options.port,
+        "Port must be a number."
+      );
+      this.port = options.port;
+    }
+
+    if (options.ssl != null) {
+      assert(typeof options.ssl === "boolean");
+      this.ssl = options.ssl;
+    }
+
+    if (options.apiKey != null) {
+      assert(typeof options.apiKey === "string");
+      this.apiKey = options.apiKey;
+    }
+
+    if (options.timeout != null) {
+      assert(options.timeout >>> 0 === options.timeout);
+      this.timeout = options.timeout;
+    }
+
+    return this;
+  }
+
+  /**
+   * Instantiate remote client options from object.
+   * @param {Object} options
+   * @returns {RemoteClientOptions}
+   */
+
+  static fromOptions(options) {
+    return new this()._fromOptions(options);
+  }
+}
+
+/*
+ * Helpers
+ */
+
+function toHash(hash) {
+  if (Buffer.isBuffer(hash)) return hash;
+  return Buffer.from(hash, "hex");
+}
+
+/*
+ * Expose
+ */
+
+module.exports = RemoteClient;
@@ -0,0 +1,463 @@
+/*!
+ * routed.js - routed databases for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const layout = require("./layout");
+
+/*
+ * Constants
+ */
+
+const HEIGHT_KEY = layout.H.encode();
+const TIP_KEY = layout.T.encode();
+
+/**
+ * Routed DB
+ * Spreads keys over several stores, exposing the subset of
+ * the `bdb` interface used by {@link NomenclateDB}. Subclasses
+ * decide which store a key lives on.
+ *
+ * The sync height (`H`) and the header of the block it was
+ * written with (`T`) go to every store with each block.
+ * Stores are committed in parallel, so after a crash some of
+ * them may be ahead: the committed height is the lowest one,
+ * and the blocks above it have to be undone on the stores
+ * which have them (see {@link RoutedDB#rollbackBatch}).
+ * @alias module:nomenclate.RoutedDB
+ */
+
+class RoutedDB {
+  /**
+   * Create a routed database.
+   * @constructor
+   * @param {DB[]} stores
+   */
+
+  constructor(stores) {
+    assert(Array.isArray(stores) && stores.length > 0);
+
+    this.stores = stores;
+
+    // Height committed on every store.
+    this.height = 0;
+
+    // Height of each store.
+    this.heights = stores.map(() => 0);
+  }
+
+  /**
+   * Get the store a key lives on.
+   * @abstract
+   * @param {Buffer} key
+   * @returns {Number}
+   */
+
+  route(key) {
+    throw new Error("Abstract method.");
+  }
+
+  /**
+   * Get the store a whole key range lives on.
+   * @param {Buffer} gte
+   * @param {Buffer} lte
+   * @returns {Number} - Returns -1 if the range spans stores.
+   */
+
+  routeRange(gte, lte) {
+    return -1;
+  }
+
+  /**
+   * Open every store and read the committed height.
+   * @returns {Promise}
+   */
+
+  async open() {
+    await Promise.all(this.stores.map(db => db.open()));
+
+    const values = await Promise.all(this.stores.map(db => db.get(HEIGHT_KEY)));
+
+    // A store without a height has not committed anything.
+    this.heights = values.map(raw => (raw ? raw.readUInt32LE(0, true) : 0));
+    this.height = Math.min(...this.heights);
+  }
+
+  /**
+   * Get the height of the highest store, which is above
+   * the committed height if a crash left some stores ahead.
+   * @returns {Number}
+   */
+
+  getTop() {
+    return Math.max(...this.heights);
+  }
+
+  /**
+   * Get a value from the stores which have a block,
+   * whichever store the key would normally be read from.
+   * @param {Buffer} key
+   * @param {Number} height
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async getAhead(key, height) {
+    for (let i = 0; i < this.stores.length; i++) {
+      if (this.heights[i] < height) continue;
+
+      const value = await this.stores[i].get(key);
+
+      if (value) return value;
+    }
+
+    return null;
+  }
+
+  /**
+   * Get the header of a block left on some stores only.
+   * @param {Number} height
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async getHeaderAhead(height) {
+    const header = await this.getAhead(layout.h.encode(height), height);
+
+    if (header) return header;
+
+    for (let i = 0; i < this.stores.length; i++) {
+      if (this.heights[i] !== height) continue;
+
+      const raw = await this.stores[i].get(TIP_KEY);
+
+      if (raw) return raw.slice(4);
+    }
+
+    return null;
+  }
+
+  /**
+   * Close every store.
+   * @returns {Promise}
+   */
+
+  async close() {
+    await Promise.all(this.stores.map(db => db.close()));
+  }
+
+  /**
+   * Get a value. The sync height is the
+   * lowest height found on any store.
+   * @param {Buffer} key
+   * @returns {Promise} - Returns Buffer.
+   */
+
+  async get(key) {
+    if (!key.equals(HEIGHT_KEY)) return this.stores[this.route(key)].get(key);
+
+    const values = await Promise.all(this.stores.map(db => db.get(key)));
+
+    let min = null;
+
+    for (const value of values) {
+      // A store without a height has not committed anything.
+      if (!value) return null;
+
+      if (!min || value.readUInt32LE(0, true) < min.readUInt32LE(0, true))
+        min = value;
+    }
+
+    return min;
+  }
+
+  /**
+   * Test whether a key exists.
+   * @param {Buffer} key
+   * @returns {Promise} - Returns Boolean.
+   */
+
+  async has(key) {
+    return (await this.get(key)) != null;
+  }
+
+  /**
+   * Write a single value.
+   * @param {Buffer} key
+   * @param {Buffer} value
+   * @returns {Promise}
+   */
+
+  async put(key, value) {
+    const b = this.batch();
+    b.put(key, value);
+    return b.write();
+  }
+
+  /**
+   * Delete a single value.
+   * @param {Buffer} key
+   * @returns {Promise}
+   */
+
+  async del(key) {
+    const b = this.batch();
+    b.del(key);
+    return b.write();
+  }
+
+  /**
+   * Create a batch spanning every store.
+   * @returns {RoutedBatch}
+   */
+
+  batch() {
+    return new RoutedBatch(this, 0);
+  }
+
+  /**
+   * Create a batch which undoes the block at a height, only
+   * writing to the stores which have it. Rows of the other
+   * stores can still be read while building it, as they are
+   * left as they were before the block.
+   * @param {Number} height
+   * @returns {RoutedBatch}
+   */
+
+  rollbackBatch(height) {
+    assert(height > this.height);
+    return new RoutedBatch(this, height);
+  }
+
+  /**
+   * Create an iterator. Ranges which live on a single
+   * store are read from it, anything wider is merged.
+   * @param {Object} options
+   * @returns {Iterator|MergedIterator}
+   */
+
+  iterator(options) {
+    const { gte, lte } = options;
+
+    if (gte && lte) {
+      const index = this.routeRange(gte, lte);
+
+      if (index !== -1) return this.stores[index].iterator(options);
+    }
+
+    // Keys are always needed to merge in order.
+    const storeOptions = Object.assign({}, options, { keys: true });
+
+    return new MergedIterator(
+      this.stores.map(db => db.iterator(storeOptions)),
+      options
+    );
+  }
+
+  /**
+   * Compact a key range on every store in parallel.
+   * @param {Buffer} start
+   * @param {Buffer} end
+   * @returns {Promise}
+   */
+
+  async compactRange(start, end) {
+    await Promise.all(this.stores.map(db => db.compactRange(start, end)));
+  }
+}
+
+/**
+ * Routed Batch
+ * Splits writes between stores. The sync height, and the
+ * header of the block it was written with, are put on every
+ * store, and the store batches are written in parallel.
+ * Writes to stores below `min` are dropped.
+ * @ignore
+ */
+
+class RoutedBatch {
+  constructor(db, min) {
+    this.db = db;
+    this.batches = db.stores.map((store, i) =>
+      db.heights[i] >= min ? store.batch() : null
+    );
+    this.height = -1;
+    this.header = null;
+  }
+
+  put(key, value) {
+    if (key.equals(HEIGHT_KEY) || key.equals(TIP_KEY)) {
+      for (const b of this.batches) if (b) b.put(key, value);
+      if (key.equals(HEIGHT_KEY)) this.height = value.readUInt32LE(0, true);
+      return this;
+    }
+
+    if (key[0] === layout.h.id) {
+      const [height] = layout.h.decode(key);
+
+      if (!this.header || height > this.header.height)
+        this.header = { height, value };
+    }
+
+    const b = this.batches[this.db.route(key)];
+
+    if (b) b.put(key, value);
+
+    return this;
+  }
+
+  del(key) {
+    if (key.equals(HEIGHT_KEY) || key.equals(TIP_KEY)) {
+      for (const b of this.batches) if (b) b.del(key);
+      return this;
+    }
+
+    const b = this.batches[this.db.route(key)];
+
+    if (b) b.del(key);
+
+    return this;
+  }
+
+  async write() {
+    const { header } = this;
+
+    // Lets a store ahead of the others after a
+    // crash find the block it has to undo.
+    if (header && header.height === this.height) {
+      const raw = Buffer.allocUnsafe(4 + header.value.length);
+      raw.writeUInt32LE(header.height, 0, true);
+      header.value.copy(raw, 4);
+
+      for (const b of this.batches) if (b) b.put(TIP_KEY, raw);
+    }
+
+    await Promise.all(this.batches.map(b => b && b.write()));
+
+    // Only now is the height visible on every store.
+    if (this.height !== -1) {
+      for (let i = 0; i < this.batches.length; i++)
+        if (this.batches[i]) this.db.heights[i] = this.height;
+
+      this.db.height = Math.min(...this.db.heights);
+    }
+  }
+
+  clear() {
+    for (const b of this.batches) if (b) b.clear();
+    this.height = -1;
+    this.header = null;
+    return this;
+  }
+}
+
+/**
+ * Merged Iterator
+ * Iterates several stores in key order. Keys found on more
+ * than one store (the sync height) are returned once, with
+ * the sync height taken as the lowest of them. Merged
+ * iterators can themselves be merged.
+ * @ignore
+ */
+
+class MergedIterator {
+  constructor(iters, options) {
+    this.iters = iters;
+    this.reverse = Boolean(options.reverse);
+    this.keys = options.keys !== false;
+    this.values = Boolean(options.values);
+    this.limit = options.limit != null ? options.limit : -1;
+    this.heads = null;
+    this.key = null;
+    this.value = null;
+  }
+
+  async next() {
+    if (!this.heads) {
+      this.heads = [];
+      for (const iter of this.iters) await this.advance(iter);
+    }
+
+    this.key = null;
+    this.value = null;
+
+    // Every store was given the limit, so
+    // it also has to hold across them.
+    if (this.limit === 0 || this.heads.length === 0) return false;
+
+    let best = this.heads[0];
+
+    for (const head of this.heads) {
+      const cmp = head.key.compare(best.key);
+      if (this.reverse ? cmp > 0 : cmp < 0) best = head;
+    }
+
+    const same = this.heads.filter(head => head.key.equals(best.key));
+
+    let value = best.value;
+
+    if (this.values && best.key.equals(HEIGHT_KEY)) {
+      for (const head of same) {
+        if (head.value.readUInt32LE(0, true) < value.readUInt32LE(0, true))
+          value = head.value;
+      }
+    }
+
+    for (const head of same) {
+      this.heads.splice(this.heads.indexOf(head), 1);
+      await this.advance(head.iter);
+    }
+
+    this.key = best.key;
+    this.value = value;
+
+    if (this.limit > 0) this.limit -= 1;
+
+    return true;
+  }
+
+  async each(cb) {
+    assert(typeof cb === "function");
+
+    try {
+      while (await this.next()) {
+        let result;
+
+        if (this.keys && this.values) result = await cb(this.key, this.value);
+        else if (this.keys) result = await cb(this.key);
+        else result = await cb(this.value);
+
+        // Stop early, as `bdb` does.
+        if (result === false) break;
+      }
+    } finally {
+      await this.end();
+    }
+  }
+
+  async end() {
+    if (this.heads) {
+      for (const head of this.heads) await head.iter.end();
+    }
+
+    this.heads = [];
+  }
+
+  async advance(iter) {
+    if (!(await iter.next())) return;
+
+    this.heads.push({
+      iter,
+      key: iter.key,
+      value: iter.value
+    });
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = RoutedDB;
@@ -0,0 +1,1040 @@
+/*!
+ * rpc.js - electrum json-rpc server for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const EventEmitter = require("events");
+const net = require("net");
+const tls = require("tls");
+const fs = require("bfile");
+const assert = require("bsert");
+const Network = require("hsd").protocol.Network;
+const { Address, TX } = require("hsd");
+const version = require("../package.json").version;
+const protocol = require("../package.json").protocol;
+const util = require("./util.js");
+
+/*
+ * Constants
+ */
+
+// Longest request line, in bytes.
+const MAX_LINE = 1 << 20;
+
+// Most headers returned by `blockchain.block.headers`.
+const MAX_HEADERS = 2016;
+
+/**
+ * JSON-RPC error codes.
+ * @enum {Number}
+ */
+
+const errors = {
+  PARSE_ERROR: -32700,
+  INVALID_REQUEST: -32600,
+  METHOD_NOT_FOUND: -32601,
+  INVALID_PARAMS: -32602,
+  INTERNAL_ERROR: -32603,
+  // Electrum: a route needs an index which is off.
+  NOT_AVAILABLE: 1
+};
+
+/**
+ * RPC Server
+ * Electrum style JSON-RPC over a raw TCP (or TLS) socket, one
+ * request per line. Connections are persistent and pipelined:
+ * requests are answered as soon as they finish, matched by id,
+ * and a line holding an array is a batch answered with one
+ * array. Address and header subscriptions are notified as new
+ * blocks are indexed.
+ * @alias module:nomenclate.RPCServer
+ * @extends EventEmitter
+ */
+
+class RPCServer extends EventEmitter {
+  /**
+   * Create an rpc server.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    super();
+
+    this.options = new RPCOptions(options);
+
+    this.network = this.options.network;
+    this.logger = this.options.logger.context("rpc-nomenclate");
+    this.ndb = this.options.ndb;
+    this.client = this.options.client;
+    this.indexer = this.options.indexer;
+
+    this.server = null;
+    this.conns = new Set();
+    this.methods = new Map();
+
+    // Notifications run one at a time, for the latest tip.
+    this.notifying = null;
+    this.nextTip = -1;
+
+    // Addresses touched since the last notification,
+    // or null if any of them may have changed.
+    this.touched = new Set();
+
+    this.init();
+  }
+
+  /**
+   * Initialize the method table.
+   * @private
+   */
+
+  init() {
+    this.add("server.version", this.serverVersion);
+    this.add("server.banner", this.serverBanner);
+    this.add("server.ping", this.serverPing);
+    this.add("server.features", this.serverFeatures);
+    this.add("server.donation_address", this.serverDonationAddress);
+    this.add("server.peers.subscribe", this.serverPeersSubscribe);
+
+    this.add("blockchain.block.header", this.blockHeader);
+    this.add("blockchain.block.headers", this.blockHeaders);
+    this.add("blockchain.headers.subscribe", this.headersSubscribe);
+    this.add("blockchain.estimatefee", this.estimateFee);
+    this.add("blockchain.relayfee", this.relayFee);
+
+    this.add("blockchain.address.get_balance", this.addressBalance);
+    this.add("blockchain.address.get_history", this.addressHistory);
+    this.add("blockchain.address.get_mempool", this.addressMempool);
+    this.add("blockchain.address.listunspent", this.addressUnspent);
+    this.add("blockchain.address.subscribe", this.addressSubscribe);
+    this.add("blockchain.address.unsubscribe", this.addressUnsubscribe);
+
+    this.add("blockchain.transaction.broadcast", this.txBroadcast);
+    this.add("blockchain.transaction.get", this.txGet);
+    this.add("blockchain.transaction.get_merkle", this.txMerkle);
+    this.add("blockchain.transaction.id_from_pos", this.txFromPos);
+
+    if (this.indexer) {
+      this.indexer.on("tip", (height, touched) => {
+        this.queueNotify(height, touched);
+      });
+    }
+  }
+
+  /**
+   * Add a method.
+   * @private
+   * @param {String} name
+   * @param {Function} handler - Called with (params, conn).
+   */
+
+  add(name, handler) {
+    this.methods.set(name, handler.bind(this));
+  }
+
+  /**
+   * Start listening.
+   * @returns {Promise}
+   */
+
+  async open() {
+    assert(!this.server, "RPC server is already open.");
+
+    const handler = socket => this.accept(socket);
+
+    if (this.options.ssl) {
+      assert(this.options.keyFile, "RPC server needs an SSL key.");
+      assert(this.options.certFile, "RPC server needs an SSL certificate.");
+
+      const key = await fs.readFile(this.options.keyFile);
+      const cert = await fs.readFile(this.options.certFile);
+
+      this.server = tls.createServer({ key, cert }, handler);
+    } else {
+      this.server = net.createServer(handler);
+    }
+
+    this.server.maxConnections = this.options.maxConnections;
+
+    await new Promise((resolve, reject) => {
+      this.server.once("error", reject);
+      this.server.listen(this.options.port, this.options.host, () => {
+        this.server.removeListener("error", reject);
+        resolve();
+      });
+    });
+
+    this.server.on("error", err => this.emit("error", err));
+
+    const address = this.server.address();
+
+    this.logger.info(
+      "Nomenclate RPC server listening on %s (port=%d, ssl=%s).",
+      address.address,
+      address.port,
+      this.options.ssl
+    );
+  }
+
+  /**
+   * Close every connection and stop listening.
+   * @returns {Promise}
+   */
+
+  async close() {
+    if (!this.server) return;
+
+    for (const conn of this.conns) conn.destroy();
+
+    this.nextTip = -1;
+
+    if (this.notifying) await this.notifying;
+
+    await new Promise(resolve => this.server.close(resolve));
+
+    this.server = null;
+  }
+
+  /**
+   * Handle a new connection.
+   * @private
+   * @param {net.Socket} socket
+   */
+
+  accept(socket) {
+    const conn = new RPCConnection(this, socket);
+
+    this.conns.add(conn);
+
+    socket.on("close", () => this.conns.delete(conn));
+
+    this.logger.debug("RPC connection from %s.", socket.remoteAddress);
+  }
+
+  /**
+   * Answer one request line, which may be a batch.
+   * @private
+   * @param {RPCConnection} conn
+   * @param {String} line
+   * @returns {Promise} - Returns Object, Object[] or null.
+   */
+
+  async handleLine(conn, line) {
+    let msg;
+
+    try {
+      msg = JSON.parse(line);
+    } catch (e) {
+      return toError(null, errors.PARSE_ERROR, "Parse error.");
+    }
+
+    if (!Array.isArray(msg)) return this.handleRequest(conn, msg);
+
+    if (msg.length === 0 || msg.length > this.options.maxBatch) {
+      return toError(
+        null,
+        errors.INVALID_REQUEST,
+        "Batches hold 1 to " + this.options.maxBatch + " requests."
+      );
+    }
+
+    const results = await Promise.all(
+      msg.map(req => this.handleRequest(conn, req))
+    );
+
+    const out = results.filter(res => res !== null);
+
+    return out.length > 0 ? out : null;
+  }
+
+  /**
+   * Answer one request. Requests without an id are
+   * notifications and get no answer.
+   * @private
+   * @param {RPCConnection} conn
+   * @param {Object} req
+   * @returns {Promise} - Returns Object or null.
+   */
+
+  async handleRequest(conn, req) {
+    if (!req || typeof req !== "object" || typeof req.method !== "string")
+      return toError(null, errors.INVALID_REQUEST, "Invalid request.");
+
+    const id = req.id === undefined ? null : req.id;
+    const params = req.params == null ? [] : req.params;
+    const method = this.methods.get(req.method);
+
+    let result;
+
+    try {
+      if (!method) throw new RPCError(errors.METHOD_NOT_FOUND, "Not found.");
+
+      if (!Array.isArray(params))
+        throw new RPCError(errors.INVALID_PARAMS, "Params must be an array.");
+
+      result = await method(params, conn);
+    } catch (e) {
+      if (req.id === undefined) return null;
+
+      if (e.type === "RPCError") return toError(id, e.code, e.message);
+
+      this.logger.debug("RPC %s failed: %s", req.method, e.message);
+
+      return toError(id, errors.INTERNAL_ERROR, e.message);
+    }
+
+    if (req.id === undefined) return null;
+
+    return {
+      jsonrpc: "2.0",
+      id,
+      result: result === undefined ? null : result
+    };
+  }
+
+  /**
+   * Queue a notification for a new tip. Tips arriving while
+   * one is being sent replace each other, so subscribers are
+   * only told of the latest one, in height order, along with
+   * the addresses touched by every block since the last one.
+   * @private
+   * @param {Number} height
+   * @param {Set?} touched - Hex hashes of the addresses whose
+   * status changed, or null if any may have (on a reorg).
+   */
+
+  queueNotify(height, touched) {
+    this.nextTip = height;
+
+    if (!touched) this.touched = null;
+    else if (this.touched) for (const key of touched) this.touched.add(key);
+
+    if (this.notifying) return;
+
+    this.notifying = this.drainNotify()
+      .catch(e => this.emit("error", e))
+      .then(() => {
+        this.notifying = null;
+      });
+  }
+
+  /**
+   * Send queued notifications until none are left.
+   * @private
+   * @returns {Promise}
+   */
+
+  async drainNotify() {
+    while (this.nextTip !== -1) {
+      const height = this.nextTip;
+      const touched = this.touched;
+
+      this.nextTip = -1;
+      this.touched = new Set();
+
+      await this.notify(height, touched);
+    }
+  }
+
+  /**
+   * Notify subscribers of a new tip. Each subscribed address
+   * which was touched is looked up once, however many
+   * connections follow it.
+   * @private
+   * @param {Number} height
+   * @param {Set?} touched - Addresses to check, or null for all.
+   * @returns {Promise}
+   */
+
+  async notify(height, touched) {
+    if (this.conns.size === 0) return;
+
+    const header = await this.ndb.getHeaders(height);
+
+    if (!header) return;
+
+    const hex = header.toString("hex");
+    const statuses = new Map();
+
+    for (const conn of this.conns) {
+      if (conn.headers) {
+        conn.send({
+          jsonrpc: "2.0",
+          method: "blockchain.headers.subscribe",
+          params: [{ height, hex }]
+        });
+      }
+
+      for (const [key, sub] of conn.addresses) {
+        if (touched && !touched.has(key)) continue;
+
+        let status = statuses.get(key);
+
+        if (status === undefined) {
+          status = await this.ndb.addressStatus(sub.addr);
+          statuses.set(key, status);
+        }
+
+        if (status === sub.status) continue;
+
+        sub.status = status;
+
+        conn.send({
+          jsonrpc: "2.0",
+          method: "blockchain.address.subscribe",
+          params: [sub.name, status]
+        });
+      }
+    }
+  }
+
+  /**
+   * Read an address parameter.
+   * @private
+   * @param {Array} params
+   * @param {Number} [index=0]
+   * @returns {Address}
+   */
+
+  address(params, index = 0) {
+    const str = params[index];
+
+    if (typeof str !== "string")
+      throw new RPCError(errors.INVALID_PARAMS, "Address is required.");
+
+    try {
+      return Address.fromString(str, this.network);
+    } catch (e) {
+      throw new RPCError(errors.INVALID_PARAMS, "Invalid address.");
+    }
+  }
+
+  /**
+   * Read a uint32 parameter.
+   * @private
+   * @param {Array} params
+   * @param {Number} index
+   * @param {Number?} fallback - Value if missing.
+   * @returns {Number}
+   */
+
+  u32(params, index, fallback) {
+    const num = params[index];
+
+    if (num == null && fallback != null) return fallback;
+
+    if (num >>> 0 !== num)
+      throw new RPCError(errors.INVALID_PARAMS, "Expected a uint32.");
+
+    return num;
+  }
+
+  /**
+   * Read a hex hash parameter.
+   * @private
+   * @param {Array} params
+   * @param {Number} index
+   * @returns {String}
+   */
+
+  hash(params, index) {
+    const str = params[index];
+
+    if (typeof str !== "string" || !/^[0-9a-f]{64}$/i.test(str))
+      throw new RPCError(errors.INVALID_PARAMS, "Expected a hash.");
+
+    return str.toLowerCase();
+  }
+
+  /**
+   * Fail unless every given index can be served.
+   * @private
+   * @param {...String} names
+   */
+
+  requireIndex(...names) {
+    if (!this.ndb.hasIndex(...names)) {
+      throw new RPCError(
+        errors.NOT_AVAILABLE,
+        "This method needs the " + names.join(" and ") + " index."
+      );
+    }
+  }
+
+  /**
+   * Fail if history has been pruned. Electrum clients check
+   * the history against the status hash, which is kept over
+   * the full history.
+   * @private
+   */
+
+  requireUnpruned() {
+    if (this.ndb.pruned) {
+      throw new RPCError(
+        errors.NOT_AVAILABLE,
+        "History below height " + this.ndb.pruneHeight + " has been pruned."
+      );
+    }
+  }
+
+  /**
+   * Prove a header against the header root at a checkpoint.
+   * @private
+   * @param {Number} height
+   * @param {Number} cpHeight
+   * @returns {Promise} - Returns {branch, root}.
+   */
+
+  async headerProof(height, cpHeight) {
+    if (cpHeight < height)
+      throw new RPCError(errors.INVALID_PARAMS, "Checkpoint is below height.");
+
+    if (cpHeight > (await this.ndb.getHeight()))
+      throw new RPCError(errors.INVALID_PARAMS, "Checkpoint is above the tip.");
+
+    return this.ndb.proofs.headerProof(height, cpHeight);
+  }
+
+  /**
+   * Find a transaction in a block and its merkle branch.
+   * @private
+   * @param {Number} height
+   * @param {Function} match - Returns the position in `block.txs`.
+   * @returns {Promise} - Returns {tx, pos, merkle}.
+   */
+
+  async blockMerkle(height, match) {
+    const entry = await this.client.getEntry(height);
+
+    if (!entry) throw new RPCError(errors.INVALID_PARAMS, "Unknown height.");
+
+    const block = await this.client.getBlock(entry.hash);
+    const hashes = block.txs.map(tx => tx.hash());
+    const pos = match(block.txs);
+
+    if (pos < 0 || pos >= block.txs.length)
+      throw new RPCError(errors.INVALID_PARAMS, "Transaction not in block.");
+
+    const [merkle] = util.branchesAndRoot(hashes, pos);
+
+    return { tx: block.txs[pos], pos, merkle };
+  }
+
+  /*
+   * Server methods
+   */
+
+  async serverVersion(params) {
+    return ["Nomenclate " + version, protocol[protocol.length - 1]];
+  }
+
+  async serverBanner(params) {
+    return "Welcome to Nomenclate";
+  }
+
+  async serverPing(params) {
+    return null;
+  }
+
+  async serverFeatures(params) {
+    const genesis = await this.client.getEntry(0);
+    const { host, port, ssl } = this.options;
+
+    return {
+      genesis_hash: genesis.hash.toString("hex"),
+      hosts: { [host]: ssl ? { ssl_port: port } : { tcp_port: port } },
+      protocol_max: protocol[protocol.length - 1],
+      protocol_min: protocol[0],
+      server_version: "Nomenclate " + version,
+      pruning: this.ndb.pruned ? this.ndb.pruneHeight : null
+    };
+  }
+
+  async serverDonationAddress(params) {
+    return "";
+  }
+
+  async serverPeersSubscribe(params) {
+    return [];
+  }
+
+  /*
+   * Blockchain methods
+   */
+
+  async blockHeader(params) {
+    const height = this.u32(params, 0);
+    const cpHeight = this.u32(params, 1, 0);
+    const header = await this.ndb.getHeaders(height);
+
+    if (!header) throw new RPCError(errors.INVALID_PARAMS, "Unknown height.");
+
+    if (cpHeight === 0) return header.toString("hex");
+
+    const proof = await this.headerProof(height, cpHeight);
+
+    return { header: header.toString("hex"), ...proof };
+  }
+
+  async blockHeaders(params) {
+    const start = this.u32(params, 0);
+    const count = Math.min(this.u32(params, 1), MAX_HEADERS);
+    const cpHeight = this.u32(params, 2, 0);
+    const headers = [];
+
+    for (let i = start; i < start + count; i++) {
+      const header = await this.ndb.getHeaders(i);
+
+      if (!header) break;
+
+      headers.push(header.toString("hex"));
+    }
+
+    const result = {
+      count: headers.length,
+      hex: headers.join(""),
+      max: MAX_HEADERS
+    };
+
+    if (cpHeight === 0 || headers.length === 0) return result;
+
+    const proof = await this.headerProof(start + headers.length - 1, cpHeight);
+
+    return { ...result, ...proof };
+  }
+
+  async headersSubscribe(params, conn) {
+    const height = await this.ndb.getHeight();
+    const header = await this.ndb.getHeaders(height);
+
+    conn.headers = true;
+
+    return { height, hex: header.toString("hex") };
+  }
+
+  async estimateFee(params) {
+    return this.client.estimateFee(this.u32(params, 0, 0));
+  }
+
+  async relayFee(params) {
+    return 0;
+  }
+
+  /*
+   * Address methods
+   */
+
+  async addressBalance(params) {
+    const addr = this.address(params);
+
+    if (!this.ndb.hasIndex("balance")) this.requireIndex("address");
+
+    const balance = await this.ndb.addressBalance(addr);
+
+    // Mempool values are not tracked.
+    return { confirmed: balance.confirmed, unconfirmed: 0 };
+  }
+
+  async addressHistory(params) {
+    const addr = this.address(params);
+
+    this.requireIndex("address");
+    this.requireUnpruned();
+
+    // Electrum lists history oldest first, then the mempool
+    // in the order the status hashes it.
+    const history = await this.ndb.addressHistory(addr);
+    const txs = await this.ndb.addressMempool(addr);
+
+    history.reverse();
+
+    return history.concat(txs);
+  }
+
+  async addressMempool(params) {
+    const addr = this.address(params);
+
+    return this.ndb.addressMempool(addr);
+  }
+
+  async addressUnspent(params) {
+    const addr = this.address(params);
+
+    if (!this.ndb.hasIndex("balance")) this.requireIndex("address");
+
+    return util.sortTXs(await this.ndb.addressUnspent(addr));
+  }
+
+  async addressSubscribe(params, conn) {
+    const addr = this.address(params);
+
+    if (!this.ndb.hasStatus()) {
+      throw new RPCError(
+        errors.NOT_AVAILABLE,
+        "Address statuses are not indexed yet."
+      );
+    }
+
+    const key = addr.getHash("hex");
+
+    if (
+      !conn.addresses.has(key) &&
+      conn.addresses.size >= this.options.maxSubscriptions
+    )
+      throw new RPCError(errors.INVALID_REQUEST, "Too many subscriptions.");
+
+    const status = await this.ndb.addressStatus(addr);
+
+    conn.addresses.set(key, { name: params[0], addr, status });
+
+    return status;
+  }
+
+  async addressUnsubscribe(params, conn) {
+    const addr = this.address(params);
+
+    return conn.addresses.delete(addr.getHash("hex"));
+  }
+
+  /*
+   * Transaction methods
+   */
+
+  async txBroadcast(params) {
+    const raw = params[0];
+
+    if (typeof raw !== "string")
+      throw new RPCError(errors.INVALID_PARAMS, "Raw transaction required.");
+
+    let tx;
+
+    try {
+      tx = TX.decode(Buffer.from(raw, "hex"));
+    } catch (e) {
+      throw new RPCError(errors.INVALID_PARAMS, "Invalid transaction.");
+    }
+
+    await this.client.sendTX(tx);
+
+    return tx.txid();
+  }
+
+  async txGet(params) {
+    const hash = this.hash(params, 0);
+
+    if (params[1])
+      throw new RPCError(errors.INVALID_PARAMS, "Verbose is not supported.");
+
+    const meta = await this.client.getMeta(Buffer.from(hash, "hex"));
+
+    if (!meta) throw new RPCError(errors.INVALID_PARAMS, "Unknown tx.");
+
+    return meta.tx.toHex();
+  }
+
+  async txMerkle(params) {
+    const hash = this.hash(params, 0);
+    const height = this.u32(params, 1);
+
+    const { pos, merkle } = await this.blockMerkle(height, txs =>
+      txs.findIndex(tx => tx.hash().toString("hex") === hash)
+    );
+
+    return { merkle, block_height: height, pos };
+  }
+
+  async txFromPos(params) {
+    const height = this.u32(params, 0);
+    const pos = this.u32(params, 1);
+
+    const { tx, merkle } = await this.blockMerkle(height, () => pos);
+    const hash = tx.hash().toString("hex");
+
+    if (!params[2]) return hash;
+
+    return { tx_hash: hash, merkle };
+  }
+}
+
+/**
+ * RPC Connection
+ * A client socket, its partial request line and subscriptions.
+ * Reading pauses while too many requests are in flight or the
+ * client is not reading its answers.
+ * @ignore
+ */
+
+class RPCConnection {
+  constructor(server, socket) {
+    this.server = server;
+    this.socket = socket;
+    this.buffer = "";
+    this.pending = 0;
+    this.paused = false;
+    this.blocked = false;
+    this.destroyed = false;
+
+    this.headers = false;
+    this.addresses = new Map();
+
+    this.init();
+  }
+
+  init() {
+    const { timeout } = this.server.options;
+
+    this.socket.setEncoding("utf8");
+    this.socket.setNoDelay(true);
+    this.socket.setTimeout(timeout);
+
+    this.socket.on("data", data => this.feed(data));
+    this.socket.on("drain", () => {
+      this.blocked = false;
+      this.maybeResume();
+    });
+    this.socket.on("timeout", () => this.destroy());
+    this.socket.on("error", () => this.destroy());
+    this.socket.on("close", () => {
+      this.destroyed = true;
+    });
+  }
+
+  feed(data) {
+    this.buffer += data;
+
+    let i;
+
+    while ((i = this.buffer.indexOf("\n")) !== -1) {
+      const line = this.buffer.slice(0, i);
+
+      this.buffer = this.buffer.slice(i + 1);
+
+      if (line.trim().length > 0) this.handle(line);
+    }
+
+    if (this.buffer.length > MAX_LINE) this.destroy();
+  }
+
+  handle(line) {
+    this.pending += 1;
+
+    if (this.pending >= this.server.options.maxPending) this.pause();
+
+    this.server
+      .handleLine(this, line)
+      .then(res => {
+        if (res) this.send(res);
+      })
+      .catch(e => this.server.emit("error", e))
+      .then(() => {
+        this.pending -= 1;
+        this.maybeResume();
+      });
+  }
+
+  send(msg) {
+    if (this.destroyed) return;
+
+    if (!this.socket.write(JSON.stringify(msg) + "\n")) {
+      this.blocked = true;
+      this.pause();
+    }
+  }
+
+  pause() {
+    if (this.paused) return;
+
+    this.paused = true;
+    this.socket.pause();
+  }
+
+  maybeResume() {
+    if (!this.paused || this.destroyed) return;
+
+    if (this.pending >= this.server.options.maxPending) return;
+
+    if (this.blocked) return;
+
+    this.paused = false;
+    this.socket.resume();
+  }
+
+  destroy() {
+    if (this.destroyed) return;
+
+    this.destroyed = true;
+    this.socket.destroy();
+  }
+}
+
+/**
+ * RPC Error
+ * @ignore
+ */
+
+class RPCError extends Error {
+  constructor(code, msg) {
+    super(msg);
+
+    this.type = "RPCError";
+    this.code = code;
+  }
+}
+
+class RPCOptions {
+  /**
+   * Create rpc options.
+   * @constructor
+   * @param {Object} options
+   */
+
+  constructor(options) {
+    this.network = Network.primary;
+    this.logger = null;
+    this.ndb = null;
+    this.client = null;
+    this.indexer = null;
+
+    this.host = "127.0.0.1";
+    this.port = 50001;
+    this.ssl = false;
+    this.keyFile = null;
+    this.certFile = null;
+
+    this.maxConnections = 1000;
+    this.maxBatch = 100;
+    this.maxPending = 64;
+    this.maxSubscriptions = 1000;
+    this.timeout = 10 * 60 * 1000;
+
+    this.fromOptions(options);
+  }
+
+  /**
+   * Inject properties from object.
+   * @private
+   * @param {Object} options
+   * @returns {RPCOptions}
+   */
+
+  fromOptions(options) {
+    assert(options);
+    assert(
+      options.ndb && typeof options.ndb === "object",
+      "RPC Server requires a NomenclateDB."
+    );
+    assert(
+      options.client && typeof options.client === "object",
+      "RPC Server requires a chain client."
+    );
+
+    this.ndb = options.ndb;
+    this.client = options.client;
+
+    if (options.network != null) this.network = Network.get(options.network);
+
+    if (options.logger != null) {
+      assert(typeof options.logger === "object");
+      this.logger = options.logger;
+    }
+
+    if (options.indexer != null) {
+      assert(typeof options.indexer === "object");
+      this.indexer = options.indexer;
+    }
+
+    if (options.host != null) {
+      assert(typeof options.host === "string");
+      this.host = options.host;
+    }
+
+    if (options.ssl != null) {
+      assert(typeof options.ssl === "boolean");
+      this.ssl = options.ssl;
+
+      // Electrum's SSL port.
+      if (this.ssl) this.port = 50002;
+    }
+
+    if (options.port != null) {
+      assert(
+        (options.port & 0xffff) === options.port,
+        "Port must be a number."
+      );
+      this.port = options.port;
+    }
+
+    if (options.keyFile != null) {
+      assert(typeof options.keyFile === "string");
+      this.keyFile = options.keyFile;
+    }
+
+    if (options.certFile != null) {
+      assert(typeof options.certFile === "string");
+      this.certFile = options.certFile;
+    }
+
+    if (options.maxConnections != null) {
+      assert(options.maxConnections >>> 0 === options.maxConnections);
+      this.maxConnections = options.maxConnections;
+    }
+
+    if (options.maxBatch != null) {
+      assert(options.maxBatch >>> 0 === options.maxBatch);
+      assert(options.maxBatch > 0);
+      this.maxBatch = options.maxBatch;
+    }
+
+    if (options.maxPending != null) {
+      assert(options.maxPending >>> 0 === options.maxPending);
+      assert(options.maxPending > 0);
+      this.maxPending = options.maxPending;
+    }
+
+    if (options.maxSubscriptions != null) {
+      assert(options.maxSubscriptions >>> 0 === options.maxSubscriptions);
+      this.maxSubscriptions = options.maxSubscriptions;
+    }
+
+    if (options.timeout != null) {
+      assert(options.timeout >>> 0 === options.timeout);
+      this.timeout = options.timeout;
+    }
+
+    return this;
+  }
+
+  /**
+   * Instantiate rpc options from object.
+   * @param {Object} options
+   * @returns {RPCOptions}
+   */
+
+  static fromOptions(options) {
+    return new RPCOptions().fromOptions(options);
+  }
+}
+
+/*
+ * Helpers
+ */
+
+function toError(id, code, message) {
+  return {
+    jsonrpc: "2.0",
+    id,
+    error: { code, message }
+  };
+}
+
+/*
+ * Expose
+ */
+
+RPCServer.errors = errors;
+
+module.exports = RPCServer;
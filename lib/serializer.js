@@ -0,0 +1,332 @@
+/*!
+ * serializer.js - compiled json serializers for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+
+/*
+ * Constants
+ */
+
+const HEX = Buffer.from("0123456789abcdef", "ascii");
+
+/**
+ * JSON Writer
+ * A reusable, growing output buffer which compiled serializers
+ * write JSON text into. Buffers are written as hex straight
+ * into it, without making a string for each.
+ * @alias module:nomenclate.JSONWriter
+ */
+
+class JSONWriter {
+  /**
+   * Create a writer.
+   * @constructor
+   * @param {Number} [size=65536] - Initial size.
+   */
+
+  constructor(size = 1 << 16) {
+    this.data = Buffer.allocUnsafe(size);
+    this.offset = 0;
+  }
+
+  /**
+   * Start a new document.
+   * @returns {JSONWriter}
+   */
+
+  reset() {
+    this.offset = 0;
+    return this;
+  }
+
+  /**
+   * Make room for `size` more bytes.
+   * @private
+   * @param {Number} size
+   */
+
+  reserve(size) {
+    const need = this.offset + size;
+
+    if (need <= this.data.length) return;
+
+    let len = this.data.length * 2;
+
+    while (len < need) len *= 2;
+
+    const data = Buffer.allocUnsafe(len);
+
+    this.data.copy(data, 0, 0, this.offset);
+    this.data = data;
+  }
+
+  /**
+   * Write ASCII text as it is.
+   * @param {String} str
+   */
+
+  raw(str) {
+    this.reserve(str.length);
+    this.offset += this.data.write(str, this.offset, "latin1");
+  }
+
+  /**
+   * Write a number (null if not finite).
+   * @param {Number} num
+   */
+
+  number(num) {
+    this.raw(Number.isFinite(num) ? String(num) : "null");
+  }
+
+  /**
+   * Write a boolean.
+   * @param {Boolean} value
+   */
+
+  bool(value) {
+    if (value == null) this.raw("null");
+    else this.raw(value ? "true" : "false");
+  }
+
+  /**
+   * Write a buffer as a hex string. Strings are taken
+   * to be hex already and are written as they are.
+   * @param {Buffer|String|null} value
+   */
+
+  hex(value) {
+    if (value == null) {
+      this.raw("null");
+      return;
+    }
+
+    if (typeof value === "string") {
+      this.reserve(value.length + 2);
+      this.data[this.offset++] = 0x22;
+      this.offset += this.data.write(value, this.offset, "latin1");
+      this.data[this.offset++] = 0x22;
+      return;
+    }
+
+    this.reserve(value.length * 2 + 2);
+
+    const { data } = this;
+
+    let pos = this.offset;
+
+    data[pos++] = 0x22;
+
+    for (let i = 0; i < value.length; i++) {
+      data[pos++] = HEX[value[i] >>> 4];
+      data[pos++] = HEX[value[i] & 0x0f];
+    }
+
+    data[pos++] = 0x22;
+
+    this.offset = pos;
+  }
+
+  /**
+   * Write a string, escaped.
+   * @param {String|null} str
+   */
+
+  string(str) {
+    if (str == null) this.raw("null");
+    else this.json(str);
+  }
+
+  /**
+   * Write any value with `JSON.stringify`.
+   * @param {*} value
+   */
+
+  json(value) {
+    const str = value === undefined ? "null" : JSON.stringify(value);
+
+    this.reserve(Buffer.byteLength(str, "utf8"));
+    this.offset += this.data.write(str, this.offset, "utf8");
+  }
+
+  /**
+   * Copy out the document.
+   * @returns {Buffer}
+   */
+
+  render() {
+    return Buffer.from(this.data.slice(0, this.offset));
+  }
+}
+
+/*
+ * Schema
+ */
+
+/**
+ * Response shapes for {@link compile}. A leaf writes a value
+ * with the {@link JSONWriter} method of the same name, objects
+ * list their fields in order, and `get` reads a field with a
+ * function instead of by name, called with the object, the
+ * serializer's context and the object's index in its array.
+ * Fields of `optional` are left out when undefined.
+ * @alias module:nomenclate.schema
+ */
+
+const schema = {
+  hex: { kind: "hex" },
+  number: { kind: "number" },
+  bool: { kind: "bool" },
+  string: { kind: "string" },
+  json: { kind: "json" },
+
+  array(item) {
+    return { kind: "array", item };
+  },
+
+  object(fields) {
+    return { kind: "object", fields };
+  },
+
+  get(fn, type) {
+    assert(typeof fn === "function");
+    return { kind: "get", fn, type };
+  },
+
+  optional(type) {
+    return { kind: "optional", type };
+  }
+};
+
+/**
+ * Compile a serializer for a response shape. The serializer
+ * writes a value as JSON, with no intermediate objects, and is
+ * called as `serialize(writer, value, ctx)`.
+ * @param {Object} shape - Built from {@link schema}.
+ * @returns {Function}
+ */
+
+function compile(shape) {
+  const fns = [];
+
+  let vars = 0;
+
+  const name = prefix => prefix + vars++;
+
+  const gen = (type, expr, parent, index) => {
+    switch (type.kind) {
+      case "hex":
+      case "number":
+      case "bool":
+      case "string":
+      case "json":
+        return `w.${type.kind}(${expr});\n`;
+      case "get": {
+        const call = `${parent}, ctx, ${index}`;
+        fns.push(type.fn);
+        return gen(type.type, `fns[${fns.length - 1}](${call})`, parent, index);
+      }
+      case "array": {
+        const a = name("a");
+        const i = name("i");
+
+        return (
+          `const ${a} = ${expr};\n` +
+          `if (${a} == null) { w.raw("null"); } else {\n` +
+          `w.raw("[");\n` +
+          `for (let ${i} = 0; ${i} < ${a}.length; ${i}++) {\n` +
+          `if (${i} > 0) w.raw(",");\n` +
+          gen(type.item, `${a}[${i}]`, a, i) +
+          `}\n` +
+          `w.raw("]");\n` +
+          `}\n`
+        );
+      }
+      case "object": {
+        const o = name("o");
+        const entries = Object.entries(type.fields);
+        const optional = entries.some(([, t]) => t.kind === "optional");
+
+        let code = `const ${o} = ${expr};\n`;
+
+        code += `if (${o} == null) { w.raw("null"); } else {\n`;
+
+        // Separators are only known while writing
+        // if a field can be left out.
+        if (optional) {
+          const s = name("s");
+
+          code += `let ${s} = "{";\n`;
+
+          for (const [key, t] of entries) {
+            const field = JSON.stringify(JSON.stringify(key) + ":");
+            const v = name("v");
+            const inner = t.kind === "optional" ? t.type : t;
+
+            code += `const ${v} = ${fieldExpr(inner, o, key, index)};\n`;
+
+            if (t.kind === "optional") code += `if (${v} !== undefined) {\n`;
+
+            code += `w.raw(${s} + ${field});\n${s} = ",";\n`;
+            code += gen(unwrap(inner), v, o, index);
+
+            if (t.kind === "optional") code += `}\n`;
+          }
+
+          code += `w.raw(${s} === "{" ? "{}" : "}");\n`;
+        } else {
+          let sep = "{";
+
+          for (const [key, t] of entries) {
+            const field = JSON.stringify(sep + JSON.stringify(key) + ":");
+
+            code += `w.raw(${field});\n`;
+            code += gen(t, `${o}[${JSON.stringify(key)}]`, o, index);
+
+            sep = ",";
+          }
+
+          code += entries.length > 0 ? `w.raw("}");\n` : `w.raw("{}");\n`;
+        }
+
+        return code + `}\n`;
+      }
+      default:
+        throw new Error("Unknown schema type.");
+    }
+  };
+
+  // Read a field ahead of writing it, for optional fields.
+  const fieldExpr = (type, parent, key, index) => {
+    if (type.kind !== "get") return `${parent}[${JSON.stringify(key)}]`;
+
+    fns.push(type.fn);
+
+    return `fns[${fns.length - 1}](${parent}, ctx, ${index})`;
+  };
+
+  const unwrap = type => (type.kind === "get" ? type.type : type);
+
+  const body = gen(shape, "value", "value", "-1");
+
+  // eslint-disable-next-line no-new-func
+  const factory = new Function(
+    "fns",
+    `return function serialize(w, value, ctx) {\n${body}};`
+  );
+
+  return factory(fns);
+}
+
+/*
+ * Expose
+ */
+
+exports.JSONWriter = JSONWriter;
+exports.schema = schema;
+exports.compile = compile;
@@ -0,0 +1,133 @@
+/*!
+ * sha256.js - resumable sha256 for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+
+// The JavaScript context, as its state is reachable.
+const Hash = require("bcrypto/lib/js/sha256");
+
+/**
+ * SHA256
+ * A `bcrypto` SHA-256 context whose midstate (the chaining
+ * value, the unprocessed tail and the length) can be saved and
+ * resumed, so a digest over a growing message can be kept up
+ * to date without hashing the whole message again.
+ * @alias module:nomenclate.SHA256
+ */
+
+class SHA256 {
+  /**
+   * Create a SHA256 context.
+   * @constructor
+   */
+
+  constructor() {
+    this.ctx = new Hash();
+    this.ctx.init();
+  }
+
+  /**
+   * Get the length of the message so far.
+   * @returns {Number}
+   */
+
+  get size() {
+    return this.ctx.size;
+  }
+
+  /**
+   * Add data to the message.
+   * @param {Buffer} data
+   * @returns {SHA256}
+   */
+
+  update(data) {
+    this.ctx.update(data);
+    return this;
+  }
+
+  /**
+   * Get the digest of the message so far, leaving
+   * the context usable.
+   * @returns {Buffer}
+   */
+
+  digest() {
+    return this.clone().ctx.final();
+  }
+
+  /**
+   * Copy the context.
+   * @returns {SHA256}
+   */
+
+  clone() {
+    const copy = new SHA256();
+    copy.ctx.state.set(this.ctx.state);
+    this.ctx.block.copy(copy.ctx.block);
+    copy.ctx.size = this.ctx.size;
+    return copy;
+  }
+
+  /**
+   * Get the serialized size of the midstate.
+   * @returns {Number}
+   */
+
+  getSize() {
+    return 41 + (this.size % 64);
+  }
+
+  /**
+   * Write the midstate.
+   * @param {BufferWriter} bw
+   * @returns {BufferWriter}
+   */
+
+  write(bw) {
+    const { state, block } = this.ctx;
+    const pos = this.size % 64;
+
+    for (let i = 0; i < 8; i++) bw.writeU32BE(state[i]);
+
+    bw.writeU64(this.size);
+    bw.writeU8(pos);
+    bw.copy(block, 0, pos);
+
+    return bw;
+  }
+
+  /**
+   * Read a midstate.
+   * @param {BufferReader} br
+   * @returns {SHA256}
+   */
+
+  read(br) {
+    const { state, block } = this.ctx;
+
+    for (let i = 0; i < 8; i++) state[i] = br.readU32BE();
+
+    const size = br.readU64();
+    const pos = br.readU8();
+
+    assert(pos === size % 64, "Invalid SHA256 midstate.");
+
+    br.readBytes(pos).copy(block, 0);
+
+    this.ctx.size = size;
+
+    return this;
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = SHA256;
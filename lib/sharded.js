@@ -0,0 +1,132 @@
+/*!
+ * sharded.js - sharded database for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const path = require("path");
+const fs = require("bfile");
+const backend = require("./backend");
+const layout = require("./layout");
+const RoutedDB = require("./routed");
+
+/*
+ * Constants
+ */
+
+// Rows keyed by a hash, spread across shards by the
+// first byte of that hash. Everything else (version,
+// network, headers) lives on the first shard.
+const ROUTED = new Set(
+  [
+    layout.o,
+    layout.s,
+    layout.e,
+    layout.i,
+    layout.t,
+    layout.n,
+    layout.c,
+    layout.u,
+    layout.a,
+    layout.r,
+    layout.g
+  ].map(key => key.id)
+);
+
+/**
+ * Sharded DB
+ * Spreads the index rows over several databases so that
+ * writes and compactions run in parallel. See {@link RoutedDB}
+ * for how blocks are committed across shards.
+ * @alias module:nomenclate.ShardedDB
+ * @extends RoutedDB
+ */
+
+class ShardedDB extends RoutedDB {
+  /**
+   * Create a sharded database.
+   * @constructor
+   * @param {Object} options - Backend options, plus `shards`.
+   */
+
+  constructor(options) {
+    assert(options && options.shards >>> 0 === options.shards);
+    assert(options.shards > 1 && options.shards <= 256);
+
+    const shards = [];
+
+    for (let i = 0; i < options.shards; i++) {
+      const location = options.memory
+        ? options.location
+        : path.join(options.location, ShardedDB.dirname(i));
+
+      shards.push(backend.create(Object.assign({}, options, { location })));
+    }
+
+    super(shards);
+
+    this.location = options.location;
+    this.memory = Boolean(options.memory);
+  }
+
+  /**
+   * Get the directory name of a shard.
+   * @param {Number} index
+   * @returns {String}
+   */
+
+  static dirname(index) {
+    return "shard" + index.toString(10).padStart(3, "0");
+  }
+
+  /**
+   * Open every shard.
+   * @returns {Promise}
+   */
+
+  async open() {
+    if (!this.memory) await fs.mkdirp(this.location);
+
+    await super.open();
+  }
+
+  /**
+   * Get the shard a key lives on.
+   * @param {Buffer} key
+   * @returns {Number}
+   */
+
+  route(key) {
+    // Hashes are prefixed by their length in keys.
+    if (key.length > 2 && ROUTED.has(key[0]))
+      return key[2] % this.stores.length;
+
+    return 0;
+  }
+
+  /**
+   * Ranges inside a single hash prefix live on one shard.
+   * @param {Buffer} gte
+   * @param {Buffer} lte
+   * @returns {Number}
+   */
+
+  routeRange(gte, lte) {
+    if (gte.length < 3 || lte.length < 3) return -1;
+
+    for (let i = 0; i < 3; i++) {
+      if (gte[i] !== lte[i]) return -1;
+    }
+
+    return this.route(gte);
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = ShardedDB;
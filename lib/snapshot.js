@@ -0,0 +1,305 @@
+/*!
+ * snapshot.js - index snapshots for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const zlib = require("zlib");
+const { promisify } = require("util");
+const fs = require("bfile");
+const bio = require("bufio");
+const blake2b = require("bcrypto/lib/blake2b");
+const { Headers } = require("hsd");
+const layout = require("./layout");
+
+/*
+ * Snapshot File Layout:
+ *  Header:
+ *    [magic:u32][version:u8][network magic:u32]
+ *  Chunks (repeated, in key order):
+ *    [raw size:u32][size:u32][rows:u32][blake2b(raw):32][deflate(raw)]
+ *    raw = ([key:varbytes][value:varbytes])*
+ *  End marker:
+ *    A chunk header with zero rows, whose checksum is
+ *    blake2b over every chunk checksum.
+ *  Trailer:
+ *    [height:u32][tip header:varbytes][rows:u64][trailer size:u32][magic:u32]
+ */
+
+const MAGIC = 0x6e6d736e;
+const VERSION = 0;
+const HEADER_SIZE = 9;
+const CHUNK_HEADER_SIZE = 44;
+const CHUNK_SIZE = 4 << 20;
+
+const deflate = promisify(zlib.deflateRaw);
+const inflate = promisify(zlib.inflateRaw);
+
+/**
+ * @exports snapshot
+ */
+
+const snapshot = exports;
+
+/**
+ * Write every row of the database to a snapshot file. Split,
+ * sharded and LMDB databases are read through an iterator per
+ * store, each with its own snapshot, taken when the first row
+ * is read. The caller must make sure no block is written until
+ * `opened` is called (see {@link Indexer#exportSnapshot}) for
+ * the file to be consistent at a single height.
+ * @param {DB} db
+ * @param {Network} network
+ * @param {String} file
+ * @param {Function?} opened - Called once every store is read
+ * from its snapshot.
+ * @returns {Promise} - Returns {height, rows}.
+ */
+
+snapshot.write = async function write(db, network, file, opened) {
+  const tmp = file + ".tmp";
+  const fd = await fs.open(tmp, "w");
+  const checksums = [];
+
+  let pos = 0;
+  let height = -1;
+  let tip = null;
+  let rows = 0;
+  let chunk = [];
+  let size = 0;
+
+  const append = async data => {
+    await fs.write(fd, data, 0, data.length, pos);
+    pos += data.length;
+  };
+
+  const flush = async () => {
+    const bw = bio.write(size);
+
+    for (const [key, value] of chunk) {
+      bw.writeVarBytes(key);
+      bw.writeVarBytes(value);
+    }
+
+    const raw = bw.render();
+    const data = await deflate(raw);
+    const checksum = blake2b.digest(raw);
+
+    const hw = bio.write(CHUNK_HEADER_SIZE);
+    hw.writeU32(raw.length);
+    hw.writeU32(data.length);
+    hw.writeU32(chunk.length);
+    hw.writeBytes(checksum);
+
+    await append(hw.render());
+    await append(data);
+
+    checksums.push(checksum);
+    rows += chunk.length;
+    chunk = [];
+    size = 0;
+  };
+
+  try {
+    const hw = bio.write(HEADER_SIZE);
+    hw.writeU32(MAGIC);
+    hw.writeU8(VERSION);
+    hw.writeU32(network.magic);
+    await append(hw.render());
+
+    const iter = db.iterator({
+      keys: true,
+      values: true,
+      snapshot: true
+    });
+
+    const heightKey = layout.H.encode();
+
+    try {
+      // The first read opens the iterator of every store.
+      let more = await iter.next();
+
+      if (opened) opened();
+
+      while (more) {
+        const { key, value } = iter;
+
+        // `H` sorts before `h`, so we always know
+        // the height before reaching its header.
+        if (key.equals(heightKey)) height = value.readUInt32LE(0, true);
+        else if (height !== -1 && key.equals(layout.h.encode(height)))
+          tip = value;
+
+        chunk.push([key, value]);
+        size += bio.sizeVarBytes(key) + bio.sizeVarBytes(value);
+
+        if (size >= CHUNK_SIZE) await flush();
+
+        more = await iter.next();
+      }
+    } finally {
+      await iter.end();
+    }
+
+    if (chunk.length > 0) await flush();
+
+    assert(height !== -1 && tip, "Snapshot: Database has no tip.");
+
+    const ew = bio.write(CHUNK_HEADER_SIZE);
+    ew.writeU32(0);
+    ew.writeU32(0);
+    ew.writeU32(0);
+    ew.writeBytes(blake2b.digest(Buffer.concat(checksums)));
+    await append(ew.render());
+
+    const trailerSize = 4 + bio.sizeVarBytes(tip) + 8;
+    const tw = bio.write(trailerSize + 8);
+    tw.writeU32(height);
+    tw.writeVarBytes(tip);
+    tw.writeU64(rows);
+    tw.writeU32(trailerSize);
+    tw.writeU32(MAGIC);
+    await append(tw.render());
+  } finally {
+    await fs.close(fd);
+  }
+
+  await fs.rename(tmp, file);
+
+  return { height, rows };
+};
+
+/**
+ * Read the tip of a snapshot file.
+ * @param {String} file
+ * @param {Network} network
+ * @returns {Promise} - Returns {height, hash, header, rows}.
+ */
+
+snapshot.readInfo = async function readInfo(file, network) {
+  const { size } = await fs.stat(file);
+  const fd = await fs.open(file, "r");
+
+  try {
+    const head = await readAt(fd, 0, HEADER_SIZE);
+    const hr = bio.read(head);
+
+    assert(hr.readU32() === MAGIC, "Snapshot: Bad magic.");
+    assert(hr.readU8() === VERSION, "Snapshot: Unknown version.");
+    assert(hr.readU32() === network.magic, "Snapshot: Network mismatch.");
+
+    const end = bio.read(await readAt(fd, size - 8, 8));
+    const trailerSize = end.readU32();
+
+    assert(end.readU32() === MAGIC, "Snapshot: Truncated file.");
+
+    const trailer = await readAt(fd, size - 8 - trailerSize, trailerSize);
+    const tr = bio.read(trailer);
+    const height = tr.readU32();
+    const header = tr.readVarBytes();
+    const rows = tr.readU64();
+
+    return {
+      height,
+      hash: Headers.decode(header).hash(),
+      header,
+      rows
+    };
+  } finally {
+    await fs.close(fd);
+  }
+};
+
+/**
+ * Bulk load a snapshot file into an empty database.
+ * The sync height is written last, and only once every
+ * chunk (and the rows, by `verify`) has been checked, so
+ * a failed import is never mistaken for a synced index.
+ * @param {DB} db
+ * @param {String} file
+ * @param {Object} info - From {@link snapshot.readInfo}.
+ * @param {Function?} verify - Called once every row is loaded.
+ * @returns {Promise}
+ */
+
+snapshot.load = async function load(db, file, info, verify) {
+  const fd = await fs.open(file, "r");
+  const heightKey = layout.H.encode();
+  const checksums = [];
+
+  let pos = HEADER_SIZE;
+  let rows = 0;
+  let height = null;
+
+  try {
+    for (;;) {
+      const hr = bio.read(await readAt(fd, pos, CHUNK_HEADER_SIZE));
+      const rawSize = hr.readU32();
+      const dataSize = hr.readU32();
+      const count = hr.readU32();
+      const checksum = hr.readBytes(32);
+
+      pos += CHUNK_HEADER_SIZE;
+
+      if (count === 0) {
+        const expect = blake2b.digest(Buffer.concat(checksums));
+        assert(checksum.equals(expect), "Snapshot: Bad file checksum.");
+        break;
+      }
+
+      const raw = await inflate(await readAt(fd, pos, dataSize));
+
+      pos += dataSize;
+
+      assert(raw.length === rawSize, "Snapshot: Bad chunk size.");
+      assert(
+        blake2b.digest(raw).equals(checksum),
+        "Snapshot: Bad chunk checksum."
+      );
+
+      const br = bio.read(raw);
+      const b = db.batch();
+
+      for (let i = 0; i < count; i++) {
+        const key = br.readVarBytes();
+        const value = br.readVarBytes();
+
+        if (key.equals(heightKey)) {
+          height = value;
+          continue;
+        }
+
+        b.put(key, value);
+      }
+
+      await b.write();
+
+      checksums.push(checksum);
+      rows += count;
+    }
+  } finally {
+    await fs.close(fd);
+  }
+
+  assert(rows === info.rows, "Snapshot: Row count mismatch.");
+  assert(height, "Snapshot: Missing height.");
+  assert(height.readUInt32LE(0, true) === info.height);
+
+  if (verify) await verify();
+
+  await db.put(heightKey, height);
+};
+
+/*
+ * Helpers
+ */
+
+async function readAt(fd, pos, size) {
+  const data = Buffer.allocUnsafe(size);
+  const bytes = await fs.read(fd, data, 0, size, pos);
+  assert(bytes === size, "Snapshot: Unexpected end of file.");
+  return data;
+}
@@ -0,0 +1,75 @@
+/*!
+ * split.js - split header and index stores for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const layout = require("./layout");
+const RoutedDB = require("./routed");
+
+/*
+ * Constants
+ */
+
+// Cold, sequentially written rows.
+const META = new Set(
+  [layout.V, layout.O, layout.H, layout.h, layout.P].map(key => key.id)
+);
+
+/**
+ * Split DB
+ * Keeps headers and chain metadata in one store and the
+ * high churn address, spend and name rows in another, so
+ * that header appends and reads are not slowed down by
+ * compactions of the random access index. See {@link RoutedDB}
+ * for how blocks are committed across both stores.
+ * @alias module:nomenclate.SplitDB
+ * @extends RoutedDB
+ */
+
+class SplitDB extends RoutedDB {
+  /**
+   * Create a split database.
+   * @constructor
+   * @param {DB} meta - Header and metadata store.
+   * @param {DB} index - Index store (may be sharded).
+   */
+
+  constructor(meta, index) {
+    super([meta, index]);
+
+    this.meta = meta;
+    this.index = index;
+  }
+
+  /**
+   * Get the store a key lives on.
+   * @param {Buffer} key
+   * @returns {Number}
+   */
+
+  route(key) {
+    return META.has(key[0]) ? 0 : 1;
+  }
+
+  /**
+   * Ranges under a single key prefix live on one store.
+   * @param {Buffer} gte
+   * @param {Buffer} lte
+   * @returns {Number}
+   */
+
+  routeRange(gte, lte) {
+    if (gte[0] !== lte[0]) return -1;
+
+    return this.route(gte);
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = SplitDB;
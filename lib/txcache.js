@@ -0,0 +1,215 @@
+/*!
+ * txcache.js - confirmed transaction cache for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+
+/*
+ * Constants
+ */
+
+// Rough in-memory size of an entry besides its
+// serialized transaction, in bytes.
+const ENTRY_SIZE = 200;
+
+// Rough in-memory size of rendered JSON per
+// byte of serialized transaction.
+const JSON_FACTOR = 5;
+
+/**
+ * TX Cache
+ * A memory bounded LRU of confirmed transactions, keyed by
+ * txid, holding the serialized transaction and its rendered
+ * JSON. Explorers fetch every transaction on a history page,
+ * and the same few pages are asked for again and again, so
+ * these are served without looking up and decoding the
+ * transaction again. Only confirmed transactions are cached,
+ * and those above a disconnected block are dropped.
+ * @alias module:nomenclate.TXCache
+ */
+
+class TXCache {
+  /**
+   * Create a transaction cache.
+   * @constructor
+   * @param {Number} capacity - Size in bytes.
+   */
+
+  constructor(capacity) {
+    assert(Number.isSafeInteger(capacity) && capacity > 0);
+
+    this.capacity = capacity;
+    this.size = 0;
+
+    // In access order, least recently used first.
+    this.entries = new Map();
+
+    // Last tip seen, and the highest cached height.
+    this.height = null;
+    this.maxHeight = -1;
+
+    // Bumped when blocks are disconnected, so that lookups
+    // which raced with a reorg are not cached.
+    this.generation = 0;
+
+    this.hits = 0;
+    this.misses = 0;
+    this.evictions = 0;
+  }
+
+  /**
+   * Get a cached transaction, marking it as used.
+   * @param {String} txid
+   * @returns {TXEntry|null}
+   */
+
+  get(txid) {
+    const entry = this.entries.get(txid);
+
+    if (!entry) {
+      this.misses += 1;
+      return null;
+    }
+
+    this.entries.delete(txid);
+    this.entries.set(txid, entry);
+
+    this.hits += 1;
+
+    return entry;
+  }
+
+  /**
+   * Cache a confirmed transaction read at `generation`.
+   * @param {String} txid
+   * @param {TXEntry} entry
+   * @param {Number} generation
+   */
+
+  set(txid, entry, generation) {
+    assert(entry.height >= 0);
+
+    if (generation !== this.generation) return;
+
+    const prev = this.entries.get(txid);
+
+    if (prev) {
+      this.entries.delete(txid);
+      this.size -= prev.getSize();
+    }
+
+    this.entries.set(txid, entry);
+    this.size += entry.getSize();
+
+    if (entry.height > this.maxHeight) this.maxHeight = entry.height;
+
+    this.compact();
+  }
+
+  /**
+   * Evict the least recently used transactions until
+   * the cache is within its capacity.
+   * @private
+   */
+
+  compact() {
+    for (const [txid, entry] of this.entries) {
+      if (this.size <= this.capacity) break;
+
+      this.entries.delete(txid);
+      this.size -= entry.getSize();
+      this.evictions += 1;
+    }
+  }
+
+  /**
+   * Follow the tip, dropping transactions confirmed above
+   * it when it moves back.
+   * @param {Number} height
+   */
+
+  tip(height) {
+    const last = this.height;
+
+    this.height = height;
+
+    if (last != null && height >= last) return;
+
+    this.generation += 1;
+
+    if (this.maxHeight <= height) return;
+
+    for (const [txid, entry] of this.entries) {
+      if (entry.height <= height) continue;
+
+      this.entries.delete(txid);
+      this.size -= entry.getSize();
+    }
+
+    this.maxHeight = height;
+  }
+
+  /**
+   * Get cache statistics.
+   * @returns {Object}
+   */
+
+  getStats() {
+    const lookups = this.hits + this.misses;
+
+    return {
+      transactions: this.entries.size,
+      size: this.size,
+      capacity: this.capacity,
+      hits: this.hits,
+      misses: this.misses,
+      hitRate: lookups > 0 ? this.hits / lookups : 0,
+      evictions: this.evictions
+    };
+  }
+}
+
+/**
+ * TX Entry
+ * A cached transaction. `json` is rendered without the hex,
+ * which is taken from `raw`, or the confirmation count,
+ * which moves with the tip.
+ * @alias module:nomenclate.TXEntry
+ */
+
+class TXEntry {
+  /**
+   * Create a cache entry.
+   * @constructor
+   * @param {Buffer} raw - Serialized transaction.
+   * @param {Number} height
+   * @param {Object} json
+   */
+
+  constructor(raw, height, json) {
+    this.raw = raw;
+    this.height = height;
+    this.json = json;
+  }
+
+  /**
+   * Get the rough in-memory size.
+   * @returns {Number}
+   */
+
+  getSize() {
+    return ENTRY_SIZE + this.raw.length * (1 + JSON_FACTOR);
+  }
+}
+
+/*
+ * Expose
+ */
+
+TXCache.TXEntry = TXEntry;
+
+module.exports = TXCache;
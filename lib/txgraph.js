@@ -0,0 +1,169 @@
+/*!
+ * txgraph.js - transaction graph walks for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const assert = require("bsert");
+const util = require("./util.js");
+
+/*
+ * Constants
+ */
+
+// Transactions read at once while expanding a level.
+const CONCURRENCY = 16;
+
+/**
+ * TX Graph
+ * Walks the spend graph out from a transaction, breadth first:
+ * back through its inputs' prevouts to the transactions which
+ * funded it, or forward through the input index to the
+ * transactions which spent its outputs. Each level is read as
+ * one batch, and the walk stops at a depth, a number of edges
+ * followed per transaction and a number of transactions. Walks
+ * forward are also cut short by pruning, which drops the input
+ * index rows of old blocks.
+ * @alias module:nomenclate.TXGraph
+ */
+
+class TXGraph {
+  /**
+   * Create a graph walker.
+   * @constructor
+   * @param {NomenclateDB} ndb
+   * @param {Object} client
+   */
+
+  constructor(ndb, client) {
+    assert(ndb && typeof ndb === "object");
+    assert(client && typeof client === "object");
+
+    this.ndb = ndb;
+    this.client = client;
+  }
+
+  /**
+   * Walk the graph from a transaction. Edges are
+   * [funding txid, output index, spending txid] in both
+   * directions, in the order they were found.
+   * @param {Buffer} txid
+   * @param {Object} options
+   * @param {Boolean} options.descendants - Walk forward.
+   * @param {Number} options.depth - Levels to walk.
+   * @param {Number} options.fanout - Edges per transaction.
+   * @param {Number} options.limit - Transactions to reach.
+   * @returns {Promise} - Returns {edges, truncated}.
+   */
+
+  async walk(txid, options) {
+    const { descendants, depth, fanout, limit } = options;
+    const seen = new Set([txid.toString("hex")]);
+    const edges = [];
+    const state = { pruned: false };
+
+    let frontier = [txid];
+    let truncated = false;
+
+    for (let level = 0; level < depth && frontier.length > 0; level++) {
+      const next = [];
+      const found = await util.mapLimit(frontier, CONCURRENCY, hash =>
+        descendants ? this.spenders(hash, state) : this.prevouts(hash)
+      );
+
+      for (const list of found) {
+        if (list.length > fanout) truncated = true;
+
+        for (const edge of list.slice(0, fanout)) {
+          const hash = descendants ? edge[2] : edge[0];
+          const key = hash.toString("hex");
+
+          if (!seen.has(key)) {
+            if (seen.size >= limit) {
+              truncated = true;
+              continue;
+            }
+
+            seen.add(key);
+            next.push(hash);
+          }
+
+          edges.push(edge);
+        }
+      }
+
+      frontier = next;
+    }
+
+    return { edges, truncated: truncated || state.pruned };
+  }
+
+  /**
+   * Get the edges to a transaction from the outputs it spends.
+   * @private
+   * @param {Buffer} txid
+   * @returns {Promise} - Returns Array[].
+   */
+
+  async prevouts(txid) {
+    const meta = await this.client.getMeta(txid);
+
+    if (!meta) return [];
+
+    const edges = [];
+
+    for (const input of meta.tx.inputs) {
+      if (input.isCoinbase()) continue;
+
+      const { prevout } = input;
+
+      edges.push([Buffer.from(prevout.txid(), "hex"), prevout.index, txid]);
+    }
+
+    return edges;
+  }
+
+  /**
+   * Get the edges from a transaction's outputs to
+   * the transactions which spent them. Sets `state.pruned`
+   * if some of them may have been pruned.
+   * @private
+   * @param {Buffer} txid
+   * @param {Object} state
+   * @returns {Promise} - Returns Array[].
+   */
+
+  async spenders(txid, state) {
+    const meta = await this.client.getMeta(txid);
+
+    if (!meta) return [];
+
+    // Spends of outputs at or below the pruned
+    // height may have lost their input rows.
+    const pruned = this.ndb.pruneHeight;
+
+    if (pruned > 0 && meta.height !== -1 && meta.height <= pruned)
+      state.pruned = true;
+
+    const { outputs } = meta.tx;
+    const spenders = await Promise.all(
+      outputs.map((output, i) => this.ndb.getSpender(txid, i))
+    );
+
+    const edges = [];
+
+    for (let i = 0; i < spenders.length; i++) {
+      if (spenders[i]) edges.push([txid, i, spenders[i]]);
+    }
+
+    return edges;
+  }
+}
+
+/*
+ * Expose
+ */
+
+module.exports = TXGraph;
@@ -91,3 +91,32 @@ util.branchesAndRoot = function branchesAndRoot(hashes, index) {
 
   return [branches, hashes[hashes.length - 1]];
 };
+
+/**
+ * Map over items with at most `limit` calls
+ * to `fn` running at once, keeping their order.
+ * @param {Array} items
+ * @param {Number} limit
+ * @param {Function} fn - Returns a promise.
+ * @returns {Promise} - Returns Array.
+ */
+
+util.mapLimit = async function mapLimit(items, limit, fn) {
+  const result = new Array(items.length).fill(null);
+  const jobs = [];
+
+  let next = 0;
+
+  const run = async () => {
+    while (next < items.length) {
+      const i = next++;
+      result[i] = await fn(items[i]);
+    }
+  };
+
+  for (let i = 0; i < limit && i < items.length; i++) jobs.push(run());
+
+  await Promise.all(jobs);
+
+  return result;
+};
@@ -0,0 +1,355 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const net = require("net");
+const bio = require("bufio");
+const Logger = require("blgr");
+const { Network } = require("hsd");
+const BinaryServer = require("../lib/binary");
+const common = require("./util/common");
+
+const { methods, types } = BinaryServer;
+
+const MAGIC = 0x6e6d6270;
+const HEIGHT = 300;
+
+function header(height) {
+  return Buffer.alloc(80, height & 0xff);
+}
+
+function txid(byte) {
+  return Buffer.alloc(32, byte);
+}
+
+class FakeDB extends common.FakeDB {
+  constructor() {
+    super(HEIGHT);
+
+    this.rows = [
+      { txid: txid(0x02), height: 200 },
+      { txid: txid(0x01), height: 1 }
+    ];
+  }
+
+  historyMerge(hash, startHeight) {
+    const rows = this.rows.filter(row => row.height >= startHeight);
+
+    return {
+      nextRow: async () => rows.shift() || null,
+      end: async () => {}
+    };
+  }
+
+  async getHeaders(height) {
+    return height <= this.height ? header(height) : null;
+  }
+}
+
+// Reads whole frames from the server.
+class Peer {
+  constructor(port) {
+    this.socket = net.connect(port, "127.0.0.1");
+    this.buffer = Buffer.alloc(0);
+    this.frames = [];
+    this.waiting = null;
+    this.closed = new Promise(resolve => this.socket.on("close", resolve));
+
+    this.socket.on("data", data => {
+      this.buffer = Buffer.concat([this.buffer, data]);
+
+      while (this.buffer.length >= 4) {
+        const size = this.buffer.readUInt32LE(0);
+
+        if (this.buffer.length < 4 + size) break;
+
+        this.frames.push({
+          id: this.buffer.readUInt32LE(4),
+          type: this.buffer[8],
+          payload: this.buffer.slice(9, 4 + size)
+        });
+
+        this.buffer = this.buffer.slice(4 + size);
+      }
+
+      if (this.waiting && this.frames.length > 0) this.waiting();
+    });
+  }
+
+  send(id, method, payload) {
+    const head = Buffer.alloc(9);
+
+    head.writeUInt32LE(5 + payload.length, 0);
+    head.writeUInt32LE(id, 4);
+    head[8] = method;
+
+    this.socket.write(Buffer.concat([head, payload]));
+  }
+
+  async read() {
+    if (this.frames.length === 0)
+      await new Promise(resolve => (this.waiting = resolve));
+
+    this.waiting = null;
+
+    return this.frames.shift();
+  }
+
+  // Read the frames of one response, up to its END or ERROR.
+  async response() {
+    const frames = [];
+
+    for (;;) {
+      const frame = await this.read();
+
+      frames.push(frame);
+
+      if (frame.type !== types.ROWS) return frames;
+    }
+  }
+
+  close() {
+    this.socket.destroy();
+  }
+}
+
+function range(start, count) {
+  const bw = bio.write(bio.sizeVarint2(start) + bio.sizeVarint2(count));
+
+  bw.writeVarint2(start);
+  bw.writeVarint2(count);
+
+  return bw.render();
+}
+
+function address(byte) {
+  const bw = bio.write(22);
+
+  bw.writeU8(0);
+  bw.writeVarBytes(Buffer.alloc(20, byte));
+
+  return bw.render();
+}
+
+describe("Binary Server", function() {
+  let server, peer;
+
+  beforeEach(async () => {
+    server = new BinaryServer({
+      network: "regtest",
+      logger: new Logger(),
+      ndb: new FakeDB(),
+      port: 0
+    });
+
+    await server.open();
+
+    peer = new Peer(server.server.address().port);
+  });
+
+  afterEach(async () => {
+    peer.close();
+    await server.close();
+  });
+
+  it("should open with a hello frame", async () => {
+    const hello = await peer.read();
+    const br = bio.read(hello.payload);
+
+    assert.strictEqual(hello.id, 0);
+    assert.strictEqual(hello.type, types.HELLO);
+    assert.strictEqual(br.readU32(), MAGIC);
+    assert.strictEqual(br.readU8(), 0);
+    assert.strictEqual(br.readU32(), Network.get("regtest").magic);
+    assert.strictEqual(br.readVarint2(), HEIGHT);
+    assert.strictEqual(br.left(), 0);
+  });
+
+  it("should stream headers up to the tip", async () => {
+    await peer.read();
+
+    peer.send(7, methods.HEADERS, range(HEIGHT - 2, 10));
+
+    const frames = await peer.response();
+    const end = frames.pop();
+    const rows = bio.read(Buffer.concat(frames.map(f => f.payload)));
+
+    for (const frame of frames) {
+      assert.strictEqual(frame.id, 7);
+      assert.strictEqual(frame.type, types.ROWS);
+    }
+
+    for (let height = HEIGHT - 2; height <= HEIGHT; height++)
+      assert.bufferEqual(rows.readVarBytes(), header(height));
+
+    assert.strictEqual(rows.left(), 0);
+    assert.strictEqual(end.id, 7);
+    assert.strictEqual(end.type, types.END);
+    assert.strictEqual(bio.read(end.payload).readVarint2(), 3);
+  });
+
+  it("should stream history rows newest first", async () => {
+    await peer.read();
+
+    peer.send(1, methods.HISTORY, address(0x0a));
+
+    const [rows, end] = await peer.response();
+    const br = bio.read(rows.payload);
+
+    assert.bufferEqual(br.readHash(), txid(0x02));
+    assert.strictEqual(br.readVarint2(), 200);
+    assert.bufferEqual(br.readHash(), txid(0x01));
+    assert.strictEqual(br.readVarint2(), 1);
+    assert.strictEqual(br.left(), 0);
+    assert.strictEqual(end.type, types.END);
+    assert.strictEqual(bio.read(end.payload).readVarint2(), 2);
+  });
+
+  it("should answer errors and keep requests in order", async () => {
+    await peer.read();
+
+    peer.send(1, 0xff, Buffer.alloc(0));
+    peer.send(2, methods.BALANCE, address(0x0a));
+    peer.send(3, methods.HEADERS, range(0, 1));
+
+    const [unknown] = await peer.response();
+
+    assert.strictEqual(unknown.id, 1);
+    assert.strictEqual(unknown.type, types.ERROR);
+    assert.strictEqual(
+      bio.read(unknown.payload).readVarString("utf8"),
+      "Unknown method."
+    );
+
+    // Balances need an index this server does not have.
+    const [missing] = await peer.response();
+
+    assert.strictEqual(missing.id, 2);
+    assert.strictEqual(missing.type, types.ERROR);
+
+    const frames = await peer.response();
+
+    assert.deepStrictEqual(frames.map(f => [f.id, f.type]), [
+      [3, types.ROWS],
+      [3, types.END]
+    ]);
+  });
+
+  it("should drop a connection sending an oversize frame", async () => {
+    await peer.read();
+
+    const head = Buffer.alloc(4);
+
+    head.writeUInt32LE((1 << 16) + 1, 0);
+    peer.socket.write(head);
+
+    await peer.closed;
+  });
+
+  it("should stop reading history once the client is gone", async () => {
+    await peer.read();
+
+    const ndb = server.ndb;
+    let ended = false;
+    let read = 0;
+
+    // Far more rows than fit in the socket buffers.
+    ndb.historyMerge = () => ({
+      nextRow: async () => {
+        read += 1;
+        return { txid: txid(0x03), height: 5 };
+      },
+      end: async () => {
+        ended = true;
+      }
+    });
+
+    peer.send(1, methods.HISTORY, address(0x0a));
+
+    await peer.read();
+
+    peer.close();
+
+    while (!ended) await new Promise(resolve => setTimeout(resolve, 10));
+
+    const total = read;
+
+    await new Promise(resolve => setTimeout(resolve, 50));
+
+    assert.strictEqual(read, total);
+  });
+});
+
+describe("Binary Server Auth", function() {
+  let server, peer;
+
+  function auth(key) {
+    const bw = bio.write(bio.sizeVarString(key, "ascii"));
+    bw.writeVarString(key, "ascii");
+    return bw.render();
+  }
+
+  beforeEach(async () => {
+    server = new BinaryServer({
+      network: "regtest",
+      logger: new Logger(),
+      ndb: new FakeDB(),
+      port: 0,
+      apiKey: "secret"
+    });
+
+    await server.open();
+
+    peer = new Peer(server.server.address().port);
+
+    await peer.read();
+  });
+
+  afterEach(async () => {
+    peer.close();
+    await server.close();
+  });
+
+  it("should answer requests after the API key", async () => {
+    peer.send(1, methods.AUTH, auth("secret"));
+
+    const [ok] = await peer.response();
+
+    assert.strictEqual(ok.type, types.END);
+
+    peer.send(2, methods.HEADERS, range(0, 1));
+
+    const frames = await peer.response();
+
+    assert.deepStrictEqual(frames.map(f => [f.id, f.type]), [
+      [2, types.ROWS],
+      [2, types.END]
+    ]);
+  });
+
+  it("should close a connection which does not authenticate", async () => {
+    peer.send(1, methods.HEADERS, range(0, 1));
+
+    const [error] = await peer.response();
+
+    assert.strictEqual(error.type, types.ERROR);
+    assert.strictEqual(
+      bio.read(error.payload).readVarString("utf8"),
+      "Authenticate first."
+    );
+
+    await peer.closed;
+  });
+
+  it("should close a connection with the wrong API key", async () => {
+    peer.send(1, methods.AUTH, auth("guess"));
+
+    const [error] = await peer.response();
+
+    assert.strictEqual(error.type, types.ERROR);
+
+    await peer.closed;
+  });
+});
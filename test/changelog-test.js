@@ -0,0 +1,275 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const fs = require("bfile");
+const { Address } = require("hsd");
+const ChangeLog = require("../lib/changelog");
+const NomenclateDB = require("../lib/nomenclatedb");
+const Indexer = require("../lib/indexer");
+const flags = require("../lib/flags");
+const { Client, tmpdir } = require("./util/common");
+
+const { BlockChanges, types } = ChangeLog;
+
+const ADDR = Address.fromHash(Buffer.alloc(20, 0x0a), 0);
+
+function hash(byte) {
+  return Buffer.alloc(32, byte);
+}
+
+function changes(height, byte = height) {
+  const entry = BlockChanges.fromEntry({ height, hash: hash(byte) });
+  entry.receive(Buffer.alloc(20, byte), 1000 * height);
+  entry.spend(hash(0xee), height, hash(byte), null);
+  return entry;
+}
+
+async function readAll(log) {
+  const { entries } = await log.read(log.start, Infinity);
+  return entries.map(([, payload]) => BlockChanges.decode(payload));
+}
+
+// Just enough of a block for the balance index.
+function entry(height) {
+  return {
+    height,
+    hash: hash(height),
+    toHeaders: () => ({
+      write: bw => {
+        bw.writeBytes(hash(height));
+        return bw;
+      }
+    })
+  };
+}
+
+function block(height) {
+  return {
+    txs: [
+      {
+        txid: () => hash(0x80 + height).toString("hex"),
+        inputs: [{ isCoinbase: () => true }],
+        outputs: [
+          {
+            address: ADDR,
+            value: 1000,
+            covenant: { isName: () => false }
+          }
+        ]
+      }
+    ]
+  };
+}
+
+describe("Change Log", function() {
+  let location, log;
+
+  beforeEach(async () => {
+    location = tmpdir();
+    log = new ChangeLog({ location, segmentSize: 256, retention: 1024 });
+    await log.open();
+  });
+
+  afterEach(async () => {
+    await log.close();
+    await fs.rimraf(location);
+  });
+
+  it("should encode and decode block changes", () => {
+    const entry = changes(7);
+
+    entry.name(hash(0x01), hash(0x02), 3, 2);
+
+    const decoded = BlockChanges.decode(entry.encode());
+
+    assert.strictEqual(decoded.type, types.CONNECT);
+    assert.strictEqual(decoded.height, 7);
+    assert.bufferEqual(decoded.hash, hash(7));
+    assert.deepStrictEqual(decoded.getJSON(), entry.getJSON());
+  });
+
+  it("should read entries back from their offsets", async () => {
+    for (let height = 1; height <= 3; height++)
+      await log.connect(changes(height));
+
+    const { entries, next } = await log.read(0, 2);
+
+    assert.strictEqual(entries.length, 2);
+    assert.strictEqual(entries[0][0], 0);
+    assert.strictEqual(BlockChanges.decode(entries[1][1]).height, 2);
+
+    const rest = await log.read(next, 10);
+
+    assert.strictEqual(rest.entries.length, 1);
+    assert.strictEqual(BlockChanges.decode(rest.entries[0][1]).height, 3);
+    assert.strictEqual(rest.next, log.offset);
+
+    await assert.rejects(log.read(next + 1, 1), /Not an entry offset/);
+  });
+
+  it("should skip a replayed tip and rewind for a lower block", async () => {
+    await log.connect(changes(1));
+    await log.connect(changes(2));
+    await log.connect(changes(2));
+
+    assert.strictEqual((await readAll(log)).length, 2);
+
+    // A reorg: block 2 is replaced.
+    await log.connect(changes(2, 0x22));
+
+    const all = await readAll(log);
+
+    assert.deepStrictEqual(all.map(e => [e.type, e.height]), [
+      [types.CONNECT, 1],
+      [types.CONNECT, 2],
+      [types.REWIND, 1],
+      [types.CONNECT, 2]
+    ]);
+
+    assert.strictEqual(log.height, 2);
+    assert.bufferEqual(log.hash, hash(0x22));
+  });
+
+  it("should drop a torn entry and find the tip on open", async () => {
+    await log.connect(changes(1));
+    await log.connect(changes(2));
+
+    const { offset } = log;
+
+    await log.close();
+
+    // Half of the next entry made it to disk.
+    const file = log.file(log.tail().start);
+    const torn = changes(3).encode().slice(0, 10);
+    await fs.writeFile(file, Buffer.concat([await fs.readFile(file), torn]));
+
+    log = new ChangeLog({ location, segmentSize: 256, retention: 1024 });
+    await log.open();
+
+    assert.strictEqual(log.offset, offset);
+    assert.strictEqual(log.height, 2);
+    assert.bufferEqual(log.hash, hash(2));
+
+    await log.connect(changes(3));
+
+    assert.deepStrictEqual((await readAll(log)).map(e => e.height), [1, 2, 3]);
+  });
+
+  it("should roll segments and drop the oldest", async () => {
+    for (let height = 1; height <= 40; height++)
+      await log.connect(changes(height));
+
+    assert(log.segments.length > 1);
+    assert(log.start > 0);
+
+    let size = 0;
+
+    for (const segment of log.segments) size += segment.size;
+
+    assert(size <= 1024);
+
+    const all = await readAll(log);
+
+    assert.strictEqual(all[all.length - 1].height, 40);
+
+    for (let i = 1; i < all.length; i++)
+      assert.strictEqual(all[i].height, all[i - 1].height + 1);
+
+    await assert.rejects(log.read(0, 1), /offset was dropped/);
+  });
+});
+
+describe("Change Log (indexer)", function() {
+  let location, ndb, indexer;
+
+  beforeEach(async () => {
+    const client = new Client();
+
+    location = tmpdir();
+
+    ndb = new NomenclateDB({
+      network: "regtest",
+      memory: true,
+      location: "test",
+      client,
+      features: flags.BALANCE,
+      addressFilter: false,
+      hotCacheSize: 0,
+      warmStart: false
+    });
+
+    // In memory databases do not keep a log of their own.
+    ndb.changes = new ChangeLog({ location });
+
+    indexer = new Indexer({ network: "regtest", client, ndb, bulkBlocks: 2 });
+
+    await ndb.open();
+  });
+
+  afterEach(async () => {
+    await ndb.close();
+    await ndb.changes.close();
+    await fs.rimraf(location);
+  });
+
+  it("should log a block before writing it", async () => {
+    await indexer._indexBlock(entry(1), block(1), null);
+
+    assert.strictEqual(ndb.changes.height, 1);
+    assert.strictEqual(await ndb.getHeight(), 1);
+  });
+
+  it("should log bulk loaded blocks before their batch is written", async () => {
+    indexer.pending = ndb.sortedBatch();
+
+    await indexer._indexBlock(entry(1), block(1), null);
+
+    // Buffered, so neither written nor logged.
+    assert.strictEqual(await ndb.getHeight(), 0);
+    assert.strictEqual(ndb.changes.height, -1);
+    assert.strictEqual(ndb.changes.offset, 0);
+
+    await indexer._indexBlock(entry(2), block(2), null);
+
+    assert.strictEqual(await ndb.getHeight(), 2);
+
+    const all = await readAll(ndb.changes);
+
+    assert.deepStrictEqual(all.map(e => e.height), [1, 2]);
+    assert.strictEqual(all[0].addresses.get(ADDR.getHash("hex"))[1], 1000);
+
+    indexer.pending = null;
+  });
+
+  it("should replay a bulk batch lost after it was logged", async () => {
+    indexer.pending = ndb.sortedBatch();
+    indexer.pending.write = async () => {
+      throw new Error("crash");
+    };
+
+    await indexer._indexBlock(entry(1), block(1), null);
+    await assert.rejects(
+      indexer._indexBlock(entry(2), block(2), null),
+      /crash/
+    );
+
+    // Logged, but never written.
+    assert.strictEqual(ndb.changes.height, 2);
+    assert.strictEqual(await ndb.getHeight(), 0);
+
+    indexer.pending = null;
+
+    await indexer._indexBlock(entry(1), block(1), null);
+    await indexer._indexBlock(entry(2), block(2), null);
+
+    const all = await readAll(ndb.changes);
+
+    // The replay rewinds over the lost blocks rather than
+    // leaving them out.
+    assert.deepStrictEqual(all.map(e => e.height), [1, 2, 0, 1, 2]);
+    assert.strictEqual(await ndb.getHeight(), 2);
+  });
+});
@@ -0,0 +1,95 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const { Address } = require("hsd");
+const HotCache = require("../lib/hotcache");
+const { txid, makeTX } = require("./util/common");
+
+const A = Address.fromHash(Buffer.alloc(20, 0x0a), 0);
+const B = Address.fromHash(Buffer.alloc(20, 0x0b), 0);
+
+// Room for two funding outputs per address.
+const CAPACITY = 8 * 2 * 320;
+
+function funding(byte, index, height, value) {
+  return {
+    tx_hash: txid(byte).toString("hex"),
+    height,
+    output_index: index,
+    value
+  };
+}
+
+describe("Hot cache", function() {
+  let cache;
+
+  beforeEach(() => {
+    cache = new HotCache(CAPACITY);
+    cache.reset(1);
+  });
+
+  it("should update cached addresses from connected blocks", () => {
+    const hash = A.getHash();
+
+    cache.set(hash, "funding", [funding(0x01, 0, 1, 500)], 1);
+    cache.set(hash, "spent", [], 1);
+
+    // Spends A's output to B, with change to A.
+    const block = {
+      txs: [makeTX(txid(0x02), [[txid(0x01), 0]], [[B, 400], [A, 99]])]
+    };
+
+    cache.connect(block, 2, null);
+
+    assert.deepStrictEqual(cache.get(hash, "funding"), [
+      funding(0x01, 0, 1, 500),
+      funding(0x02, 1, 2, 99)
+    ]);
+
+    assert.deepStrictEqual(cache.get(hash, "spent"), [
+      {
+        tx_hash: txid(0x02).toString("hex"),
+        height: 2,
+        funding_output: [txid(0x01).toString("hex"), 0],
+        value: 500
+      }
+    ]);
+
+    // B was not cached, so it is not now.
+    assert.strictEqual(cache.get(B.getHash(), "funding"), null);
+    assert.strictEqual(cache.getStats().updates, 2);
+  });
+
+  it("should skip results larger than their share", () => {
+    const outputs = [0, 1, 2].map(i => funding(0x01, i, 1, 10));
+
+    cache.set(A.getHash(), "funding", outputs, 1);
+
+    assert.strictEqual(cache.get(A.getHash(), "funding"), null);
+    assert.strictEqual(cache.getStats().skipped, 1);
+    assert.strictEqual(cache.size, 0);
+  });
+
+  it("should evict addresses which outgrow their share", () => {
+    const hash = A.getHash();
+    const outputs = [0, 1].map(i => funding(0x01, i, 1, 10));
+
+    cache.set(hash, "funding", outputs, 1);
+    cache.set(B.getHash(), "aggregate", { received: 1 }, 1);
+
+    assert.strictEqual(cache.get(hash, "funding").length, 2);
+
+    cache.connect({ txs: [makeTX(txid(0x02), [], [[A, 5]])] }, 2, null);
+
+    assert.strictEqual(cache.get(hash, "funding"), null);
+    assert.strictEqual(cache.getStats().skipped, 1);
+
+    // Only B is left, with nothing of A's outpoints.
+    assert.strictEqual(cache.getStats().addresses, 1);
+    assert.strictEqual(cache.outpoints.size, 0);
+    assert.strictEqual(cache.size, 160 + 64);
+  });
+});
@@ -0,0 +1,126 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const fs = require("bfile");
+const LMDB = require("../lib/lmdb");
+const { tmpdir } = require("./util/common");
+
+// More than one chunk of rows.
+const ROWS = 600;
+
+function key(num) {
+  const data = Buffer.alloc(5);
+  data[0] = 0x61;
+  data.writeUInt32BE(num, 1);
+  return data;
+}
+
+function hasLMDB() {
+  try {
+    require("node-lmdb");
+    return true;
+  } catch (e) {
+    return false;
+  }
+}
+
+describe("LMDB", function() {
+  const location = tmpdir();
+
+  let db;
+
+  before(function() {
+    // An optional dependency.
+    if (!hasLMDB()) this.skip();
+  });
+
+  beforeEach(async () => {
+    db = new LMDB({ location, mapSize: 64 << 20 });
+    await db.open();
+
+    const b = db.batch();
+
+    for (let i = 0; i < ROWS; i++) b.put(key(i), Buffer.from([i & 0xff]));
+
+    await b.write();
+  });
+
+  afterEach(async () => {
+    await db.close();
+    await fs.rimraf(location);
+  });
+
+  async function collect(options) {
+    const found = [];
+
+    await db.iterator(options).each(key => {
+      found.push(key.readUInt32BE(1));
+    });
+
+    return found;
+  }
+
+  function range(start, end) {
+    const nums = [];
+
+    if (start <= end) for (let i = start; i <= end; i++) nums.push(i);
+    else for (let i = start; i >= end; i--) nums.push(i);
+
+    return nums;
+  }
+
+  it("should iterate across chunks in order", async () => {
+    assert.deepStrictEqual(await collect({}), range(0, ROWS - 1));
+
+    assert.deepStrictEqual(
+      await collect({ gte: key(10), lte: key(500) }),
+      range(10, 500)
+    );
+
+    assert.deepStrictEqual(
+      await collect({ gte: key(10), lte: key(500), reverse: true }),
+      range(500, 10)
+    );
+
+    assert.deepStrictEqual(
+      await collect({ gte: key(3), limit: 300 }),
+      range(3, 302)
+    );
+  });
+
+  it("should see writes between chunks unless a snapshot", async () => {
+    const live = db.iterator({ gte: key(0) });
+    const snap = db.iterator({ gte: key(0), snapshot: true });
+
+    assert(await live.next());
+    assert(await snap.next());
+
+    // Past the first chunk.
+    await db.put(key(ROWS + 1), Buffer.from([1]));
+    await db.del(key(ROWS - 1));
+
+    const seen = [];
+    const held = [];
+
+    while (await live.next()) seen.push(live.key.readUInt32BE(1));
+    while (await snap.next()) held.push(snap.key.readUInt32BE(1));
+
+    assert.deepStrictEqual(seen, range(1, ROWS - 2).concat(ROWS + 1));
+    assert.deepStrictEqual(held, range(1, ROWS - 1));
+
+    live.end();
+    snap.end();
+  });
+
+  it("should not hold a read transaction between chunks", async () => {
+    const iter = db.iterator({ values: true });
+
+    assert(await iter.next());
+    assert.strictEqual(iter.txn, null);
+
+    iter.end();
+  });
+});
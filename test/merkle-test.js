@@ -0,0 +1,128 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const bdb = require("bdb");
+const blake2b = require("bcrypto/lib/blake2b");
+const layout = require("../lib/layout");
+const util = require("../lib/util");
+const { MerkleTree, Proofs } = require("../lib/merkle");
+const { Client, FakeDB, txid } = require("./util/common");
+
+function leaves(count) {
+  const hashes = [];
+
+  for (let i = 0; i < count; i++) hashes.push(txid(i + 1));
+
+  return hashes;
+}
+
+// What the uncached routes compute.
+function expected(hashes, index) {
+  const [branch, root] = util.branchesAndRoot(hashes.slice(), index);
+  return [branch, root.toString("hex")];
+}
+
+function actual(tree, index, last) {
+  const [branch, root] = tree.branch(index, last);
+  return [branch.map(hash => hash.toString("hex")), root.toString("hex")];
+}
+
+/**
+ * Header DB
+ * A FakeDB holding raw headers in `h` rows.
+ */
+
+class HeaderDB extends FakeDB {
+  constructor() {
+    super();
+    this.client = new Client();
+    this.db = bdb.create({ memory: true });
+  }
+
+  async getHeight() {
+    return this.height;
+  }
+
+  async setHeaders(headers) {
+    const b = this.db.batch();
+
+    for (let i = 0; i < headers.length; i++)
+      b.put(layout.h.encode(i), headers[i]);
+
+    this.height = headers.length - 1;
+
+    await b.write();
+  }
+}
+
+describe("Merkle proofs", function() {
+  it("should match the uncached branches for every prefix", () => {
+    const hashes = leaves(17);
+    const tree = new MerkleTree();
+
+    for (const hash of hashes) tree.push(hash);
+
+    for (let last = 0; last < hashes.length; last++) {
+      const prefix = hashes.slice(0, last + 1);
+
+      for (let i = 0; i <= last; i++)
+        assert.deepStrictEqual(actual(tree, i, last), expected(prefix, i));
+    }
+  });
+
+  it("should rebuild the same nodes after truncating", () => {
+    const hashes = leaves(13);
+    const tree = new MerkleTree();
+
+    for (const hash of hashes) tree.push(hash);
+
+    tree.truncate(6);
+
+    assert.strictEqual(tree.size, 6);
+    assert.deepStrictEqual(actual(tree, 5, 5), expected(hashes.slice(0, 6), 5));
+
+    for (const hash of hashes.slice(6)) tree.push(hash);
+
+    for (let i = 0; i < hashes.length; i++)
+      assert.deepStrictEqual(actual(tree, i, 12), expected(hashes, i));
+  });
+
+  it("should drop headers replaced by a reorg", async () => {
+    const ndb = new HeaderDB();
+
+    await ndb.db.open();
+
+    const headers = [];
+
+    for (let i = 0; i < 9; i++) headers.push(Buffer.alloc(236, i));
+
+    await ndb.setHeaders(headers);
+
+    const proofs = new Proofs(ndb, 4);
+    const hashes = headers.map(raw => blake2b.digest(raw));
+
+    let proof = await proofs.headerProof(3, 8);
+    let [branch, root] = expected(hashes, 3);
+
+    assert.deepStrictEqual(proof, { branch, root });
+
+    // Replace the headers from 6 on.
+    for (let i = 6; i < 9; i++) {
+      headers[i] = Buffer.alloc(236, 0x80 + i);
+      hashes[i] = blake2b.digest(headers[i]);
+    }
+
+    await ndb.setHeaders(headers);
+
+    proof = await proofs.headerProof(3, 8);
+    [branch, root] = expected(hashes, 3);
+
+    assert.deepStrictEqual(proof, { branch, root });
+    assert.strictEqual(proofs.headers.size, 9);
+
+    await ndb.db.close();
+  });
+});
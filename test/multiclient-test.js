@@ -0,0 +1,100 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const Logger = require("blgr");
+const MultiClient = require("../lib/multiclient");
+const { Client, txid } = require("./util/common");
+
+/**
+ * Source Client
+ * Answers hash lookups from a list of hashes,
+ * or fails while it is down.
+ */
+
+class SourceClient extends Client {
+  constructor(hashes) {
+    super();
+    this.network = "regtest";
+    this.hashes = hashes;
+    this.down = false;
+    this.tip = { height: hashes.length - 1, hash: hashes[hashes.length - 1] };
+  }
+
+  async open() {}
+
+  async close() {}
+
+  async getHashes(start, end) {
+    if (this.down) throw new Error("connection refused");
+    return this.hashes.slice(start, end + 1);
+  }
+}
+
+function chain(...bytes) {
+  return bytes.map(byte => txid(byte));
+}
+
+describe("Multi client", function() {
+  let clients, multi;
+
+  beforeEach(() => {
+    clients = [
+      new SourceClient(chain(0, 1, 2)),
+      new SourceClient(chain(0, 1, 2)),
+      new SourceClient(chain(0, 1, 2))
+    ];
+
+    multi = new MultiClient({
+      logger: new Logger(),
+      clients,
+      timeout: 1000
+    });
+  });
+
+  it("should re-admit sources which agree with the primary", async () => {
+    const [, a, b] = multi.sources;
+
+    multi.drop(a, "slow");
+    multi.drop(b, "slow");
+
+    assert.deepStrictEqual(multi.healthy(), [multi.primary]);
+
+    // One is still down, the other is on another chain.
+    clients[1].down = true;
+    clients[2].hashes = chain(0, 1, 9);
+
+    await multi.probe();
+
+    assert.deepStrictEqual(multi.healthy(), [multi.primary]);
+
+    clients[1].down = false;
+
+    await multi.probe();
+
+    assert.deepStrictEqual(multi.healthy(), [multi.primary, a]);
+    assert.strictEqual(a.rate, 0);
+    assert(b.dropped);
+  });
+
+  it("should never drop the last source", () => {
+    const [primary, a, b] = multi.sources;
+
+    multi.drop(a, "slow");
+    multi.drop(b, "slow");
+    multi.drop(primary, "slow");
+
+    assert(!primary.dropped);
+    assert.strictEqual(multi.primary, primary);
+  });
+
+  it("should only probe while open", async () => {
+    await multi.open();
+    assert(multi.timer != null);
+
+    await multi.close();
+    assert.strictEqual(multi.timer, null);
+  });
+});
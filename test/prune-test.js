@@ -0,0 +1,144 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const { Address } = require("hsd");
+const NomenclateDB = require("../lib/nomenclatedb");
+const Indexer = require("../lib/indexer");
+const layout = require("../lib/layout");
+const flags = require("../lib/flags");
+const { Client, txid, makeTX, makeEntry } = require("./util/common");
+
+const A = Address.fromHash(Buffer.alloc(20, 0x0a), 0);
+const B = Address.fromHash(Buffer.alloc(20, 0x0b), 0);
+
+// Block 4 spends A's change from block 2, which
+// is below the pruned height by the time it connects.
+const BLOCKS = [
+  { txs: [] },
+  { txs: [makeTX(txid(0x11), [], [[A, 5000]])] },
+  { txs: [makeTX(txid(0x22), [[txid(0x11), 0]], [[B, 3000], [A, 1999]])] },
+  { txs: [makeTX(txid(0x33), [], [[B, 10]])] },
+  { txs: [makeTX(txid(0x44), [[txid(0x22), 1]], [[B, 1000], [A, 999]])] }
+];
+
+/**
+ * Block Client
+ * Serves the blocks above by height.
+ */
+
+class BlockClient extends Client {
+  async getBlocks(start, end) {
+    const blocks = [];
+
+    for (let height = start; height <= end; height++)
+      blocks.push([makeEntry(height), BLOCKS[height]]);
+
+    return blocks;
+  }
+}
+
+function history(...rows) {
+  return rows.map(([byte, height]) => {
+    return { tx_hash: txid(byte).toString("hex"), height };
+  });
+}
+
+describe("Pruning", function() {
+  let ndb, indexer;
+
+  async function connect(height) {
+    await indexer._indexBlock(makeEntry(height), BLOCKS[height], null);
+  }
+
+  async function count(prefix) {
+    let rows = 0;
+
+    await ndb.db
+      .iterator({ gte: prefix.min(), lte: prefix.max() })
+      .each(() => {
+        rows += 1;
+      });
+
+    return rows;
+  }
+
+  beforeEach(async () => {
+    const client = new BlockClient();
+
+    ndb = new NomenclateDB({
+      network: "regtest",
+      memory: true,
+      location: "test",
+      client,
+      features: flags.ADDRESS | flags.SPEND | flags.BALANCE,
+      addressFilter: false,
+      hotCacheSize: 0,
+      warmStart: false
+    });
+
+    indexer = new Indexer({ network: "regtest", client, ndb });
+
+    await ndb.open();
+
+    for (let height = 1; height <= 3; height++) await connect(height);
+  });
+
+  afterEach(async () => {
+    await ndb.close();
+  });
+
+  it("should delete history below the target and keep coins", async () => {
+    await indexer.prune(3);
+
+    assert.strictEqual(ndb.pruneHeight, 3);
+    assert.strictEqual(await ndb.getPruneHeight(), 3);
+
+    assert.deepStrictEqual(await ndb.addressHistory(A), []);
+    assert.deepStrictEqual(await ndb.addressHistory(B), history([0x33, 3]));
+
+    // Spend rows are gone, while coin rows are kept for later spends.
+    assert.strictEqual(await count(layout.t), 0);
+    assert.strictEqual(await count(layout.c), 4);
+  });
+
+  it("should keep balances across blocks spending pruned coins", async () => {
+    await indexer.prune(3);
+    await connect(4);
+
+    assert.deepStrictEqual(await ndb.addressBalance(A), {
+      confirmed: 999,
+      unconfirmed: 999,
+      received: 7998,
+      spent: 6999
+    });
+
+    assert.deepStrictEqual(await ndb.addressBalance(B), {
+      confirmed: 4010,
+      unconfirmed: 4010,
+      received: 4010,
+      spent: 0
+    });
+
+    assert.deepStrictEqual(await ndb.addressHistory(A), history([0x44, 4]));
+    assert.deepStrictEqual(
+      await ndb.addressHistory(B),
+      history([0x33, 3], [0x44, 4])
+    );
+  });
+
+  it("should refuse a pruning depth inside the undo window", () => {
+    const { keepBlocks } = ndb.network.block;
+
+    assert.throws(() => {
+      return new Indexer({
+        network: "regtest",
+        client: ndb.client,
+        ndb,
+        pruneDepth: keepBlocks - 1
+      });
+    }, /Pruning must keep/);
+  });
+});
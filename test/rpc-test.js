@@ -0,0 +1,314 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const net = require("net");
+const EventEmitter = require("events");
+const Logger = require("blgr");
+const { Address } = require("hsd");
+const RPCServer = require("../lib/rpc");
+const NomenclateDB = require("../lib/nomenclatedb");
+const pkg = require("../package.json");
+const common = require("./util/common");
+
+const { errors } = RPCServer;
+
+const ADDR = Address.fromHash(Buffer.alloc(20, 0x0a), 0);
+
+function txid(byte) {
+  return Buffer.alloc(32, byte).toString("hex");
+}
+
+class FakeDB extends common.FakeDB {
+  constructor() {
+    super();
+
+    this.indexes = new Set(["address", "spend", "name", "balance"]);
+    this.history = [
+      { tx_hash: txid(0x02), height: 2 },
+      { tx_hash: txid(0x01), height: 1 }
+    ];
+    this.mempool = [{ tx_hash: txid(0x03), height: 0, fee: 200 }];
+    this.status = "00";
+    this.lookups = 0;
+  }
+
+  hasStatus() {
+    return true;
+  }
+
+  async addressStatus(addr) {
+    assert.bufferEqual(addr.getHash(), ADDR.getHash());
+    this.lookups += 1;
+    return this.status;
+  }
+
+  async addressHistory(addr) {
+    assert.bufferEqual(addr.getHash(), ADDR.getHash());
+    return this.history.slice();
+  }
+
+  async addressMempool(addr) {
+    assert.bufferEqual(addr.getHash(), ADDR.getHash());
+    return this.mempool.slice();
+  }
+
+  async getHeight() {
+    return 0;
+  }
+
+  async getHeaders(height) {
+    // Slow enough for several tips to arrive meanwhile.
+    await new Promise(resolve => setTimeout(resolve, 20));
+    return Buffer.from([height]);
+  }
+}
+
+class FakeClient extends common.Client {
+  constructor(mempool) {
+    super();
+    this.mempool = mempool || new Map();
+  }
+
+  async getMempoolTXs(addr) {
+    return Array.from(this.mempool.values(), ([tx]) => tx);
+  }
+
+  async hasMempoolTX(hash) {
+    return this.mempool.has(hash);
+  }
+
+  async getMempoolFee(hash) {
+    const item = this.mempool.get(hash);
+    return item ? item[1] : null;
+  }
+}
+
+// A line based connection to the server.
+class Peer {
+  constructor(port) {
+    this.socket = net.connect(port, "127.0.0.1");
+    this.buffer = "";
+    this.lines = [];
+    this.waiting = null;
+
+    this.socket.setEncoding("utf8");
+    this.socket.on("data", data => {
+      this.buffer += data;
+
+      let i;
+
+      while ((i = this.buffer.indexOf("\n")) !== -1) {
+        this.lines.push(JSON.parse(this.buffer.slice(0, i)));
+        this.buffer = this.buffer.slice(i + 1);
+      }
+
+      if (this.waiting && this.lines.length > 0) this.waiting();
+    });
+  }
+
+  write(msg) {
+    if (typeof msg !== "string") msg = JSON.stringify(msg);
+
+    this.socket.write(msg + "\n");
+  }
+
+  async read() {
+    if (this.lines.length === 0)
+      await new Promise(resolve => (this.waiting = resolve));
+
+    this.waiting = null;
+
+    return this.lines.shift();
+  }
+
+  async call(method, params = []) {
+    this.write({ jsonrpc: "2.0", id: 1, method, params });
+    return this.read();
+  }
+
+  close() {
+    this.socket.destroy();
+  }
+}
+
+describe("RPC Server", function() {
+  let server, peer, indexer;
+
+  beforeEach(async () => {
+    indexer = new EventEmitter();
+
+    server = new RPCServer({
+      network: "regtest",
+      logger: new Logger(),
+      ndb: new FakeDB(),
+      client: new FakeClient(),
+      indexer,
+      port: 0
+    });
+
+    await server.open();
+
+    peer = new Peer(server.server.address().port);
+  });
+
+  afterEach(async () => {
+    peer.close();
+    await server.close();
+  });
+
+  it("should answer server.version", async () => {
+    const res = await peer.call("server.version", ["test", "1.4"]);
+
+    assert.strictEqual(res.jsonrpc, "2.0");
+    assert.strictEqual(res.id, 1);
+    assert.deepStrictEqual(res.result, [
+      "Nomenclate " + pkg.version,
+      pkg.protocol[pkg.protocol.length - 1]
+    ]);
+  });
+
+  it("should report parse errors and unknown methods", async () => {
+    peer.write("{");
+
+    const bad = await peer.read();
+
+    assert.strictEqual(bad.id, null);
+    assert.strictEqual(bad.error.code, errors.PARSE_ERROR);
+
+    const res = await peer.call("server.nothing");
+
+    assert.strictEqual(res.id, 1);
+    assert.strictEqual(res.error.code, errors.METHOD_NOT_FOUND);
+  });
+
+  it("should answer batches and skip notifications", async () => {
+    peer.write([
+      { jsonrpc: "2.0", id: "a", method: "server.ping" },
+      { jsonrpc: "2.0", method: "server.ping" },
+      { jsonrpc: "2.0", id: "b", method: "server.banner" }
+    ]);
+
+    const res = await peer.read();
+
+    assert(Array.isArray(res));
+    assert.deepStrictEqual(res.map(r => r.id), ["a", "b"]);
+    assert.strictEqual(res[0].result, null);
+    assert.strictEqual(typeof res[1].result, "string");
+
+    // A lone notification gets no answer at all.
+    peer.write({ jsonrpc: "2.0", method: "server.ping" });
+    peer.write([]);
+
+    const next = await peer.read();
+
+    assert.strictEqual(next.error.code, errors.INVALID_REQUEST);
+  });
+
+  it("should notify of tips in order, skipping superseded ones", async () => {
+    await peer.call("blockchain.headers.subscribe");
+
+    for (let height = 1; height <= 4; height++) indexer.emit("tip", height);
+
+    const first = await peer.read();
+    const second = await peer.read();
+
+    assert.strictEqual(first.method, "blockchain.headers.subscribe");
+    assert.strictEqual(first.params[0].height, 1);
+    assert.strictEqual(second.params[0].height, 4);
+
+    await server.notifying;
+
+    assert.strictEqual(peer.lines.length, 0);
+  });
+
+  it("should only look up the addresses a block touched", async () => {
+    const addr = ADDR.toString("regtest");
+    const key = ADDR.getHash("hex");
+
+    await peer.call("blockchain.address.subscribe", [addr]);
+
+    server.ndb.lookups = 0;
+    server.ndb.status = "01";
+
+    indexer.emit("tip", 1, new Set([txid(0x01)]));
+    await server.notifying;
+
+    assert.strictEqual(server.ndb.lookups, 0);
+
+    indexer.emit("tip", 2, new Set([key]));
+    await server.notifying;
+
+    assert.strictEqual(server.ndb.lookups, 1);
+
+    const msg = await peer.read();
+
+    assert.strictEqual(msg.method, "blockchain.address.subscribe");
+    assert.deepStrictEqual(msg.params, [addr, "01"]);
+  });
+
+  it("should list history oldest first, then the mempool", async () => {
+    const addr = ADDR.toString("regtest");
+    const res = await peer.call("blockchain.address.get_history", [addr]);
+
+    assert.deepStrictEqual(res.result, [
+      { tx_hash: txid(0x01), height: 1 },
+      { tx_hash: txid(0x02), height: 2 },
+      { tx_hash: txid(0x03), height: 0, fee: 200 }
+    ]);
+
+    const mempool = await peer.call("blockchain.address.get_mempool", [addr]);
+
+    assert.deepStrictEqual(mempool.result, [
+      { tx_hash: txid(0x03), height: 0, fee: 200 }
+    ]);
+  });
+
+  it("should refuse history once it has been pruned", async () => {
+    server.ndb.pruneHeight = 2;
+
+    const addr = ADDR.toString("regtest");
+    const res = await peer.call("blockchain.address.get_history", [addr]);
+
+    assert.strictEqual(res.error.code, errors.NOT_AVAILABLE);
+  });
+
+  it("should reject a bad address", async () => {
+    const res = await peer.call("blockchain.address.get_history", ["x"]);
+
+    assert.strictEqual(res.error.code, errors.INVALID_PARAMS);
+  });
+});
+
+describe("NomenclateDB#addressMempool", function() {
+  function tx(hash, prev) {
+    return {
+      txid: () => hash,
+      inputs: [{ prevout: { txid: () => prev } }]
+    };
+  }
+
+  it("should mark unconfirmed parents and sort by txid", async () => {
+    const mempool = new Map([
+      [txid(0x09), [tx(txid(0x09), txid(0x01)), 300]],
+      [txid(0x05), [tx(txid(0x05), txid(0x09)), 100]]
+    ]);
+
+    const ndb = new NomenclateDB({
+      network: "regtest",
+      memory: true,
+      location: "test",
+      client: new FakeClient(mempool),
+      addressFilter: false,
+      hotCacheSize: 0,
+      warmStart: false
+    });
+
+    assert.deepStrictEqual(await ndb.addressMempool(ADDR), [
+      { tx_hash: txid(0x05), height: -1, fee: 100 },
+      { tx_hash: txid(0x09), height: 0, fee: 300 }
+    ]);
+  });
+});
@@ -0,0 +1,195 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const { Address } = require("hsd");
+const NomenclateDB = require("../lib/nomenclatedb");
+const Indexer = require("../lib/indexer");
+const flags = require("../lib/flags");
+const { SEGMENT_ROWS } = require("../lib/records");
+const { Client } = require("./util/common");
+
+const A = Address.fromHash(Buffer.alloc(20, 0x0a), 0);
+const B = Address.fromHash(Buffer.alloc(20, 0x0b), 0);
+
+// Txids sort in the reverse of their position in the block,
+// so rows keyed by txid would come out in the wrong order.
+function txid(height, pos) {
+  const hash = Buffer.alloc(32, 0x00);
+  hash.writeUInt16BE(0xffff - pos, 0);
+  hash[2] = height;
+  return hash.toString("hex");
+}
+
+function coinbase() {
+  return { isCoinbase: () => true };
+}
+
+// Just enough of a transaction for the balance index.
+function tx(height, pos, addr, value) {
+  return {
+    txid: () => txid(height, pos),
+    inputs: [coinbase()],
+    outputs: [{ address: addr, value }]
+  };
+}
+
+function entry(height) {
+  return { height, hash: Buffer.alloc(32, height) };
+}
+
+// Block 1 pays A from every transaction, block 2 from every
+// other one, so the first segment of A ends inside block 2.
+function block(height) {
+  const txs = [];
+
+  for (let pos = 0; pos < 1000; pos++) {
+    if (height === 1 && pos >= 600) break;
+
+    const addr = height === 1 || pos % 2 === 0 ? A : B;
+
+    txs.push(tx(height, pos, addr, 1000 + pos));
+  }
+
+  return { txs };
+}
+
+// Position of the nth history row of A, oldest first.
+function rowOf(n) {
+  if (n < 600) return txid(1, n);
+  return txid(2, (n - 600) * 2);
+}
+
+describe("Address history segments", function() {
+  let ndb, indexer;
+
+  async function connect(height) {
+    const b = ndb.batch();
+    await indexer.indexBalance(ndb, b, entry(height), block(height));
+    await b.write();
+  }
+
+  async function disconnect(height) {
+    const b = ndb.batch();
+    await indexer.unindexBalance(ndb, b, entry(height), block(height));
+    await b.write();
+  }
+
+  beforeEach(async () => {
+    const client = new Client();
+
+    ndb = new NomenclateDB({
+      network: "regtest",
+      memory: true,
+      location: "test",
+      client,
+      features: flags.BALANCE,
+      addressFilter: false,
+      hotCacheSize: 0,
+      warmStart: false
+    });
+
+    indexer = new Indexer({ network: "regtest", client, ndb });
+
+    await ndb.open();
+    await connect(1);
+    await connect(2);
+  });
+
+  afterEach(async () => {
+    await ndb.close();
+  });
+
+  it("should cut segments every SEGMENT_ROWS rows", async () => {
+    const segments = await ndb.getSegments(A.getHash());
+
+    assert.strictEqual(SEGMENT_ROWS, 1000);
+    assert.deepStrictEqual(segments.map(seg => seg.count), [1000, 100]);
+
+    const [first, last] = segments;
+
+    assert.strictEqual(first.start, 1);
+    assert.strictEqual(first.pos, 0);
+    assert.strictEqual(last.start, 2);
+    assert.strictEqual(last.pos, 800);
+    assert.strictEqual(last.end, 2);
+  });
+
+  it("should start a segment inside a block at its first row", async () => {
+    const hash = A.getHash();
+    const [first, last] = await ndb.getSegments(hash);
+
+    const head = await ndb.getSegmentRows(hash, first);
+    const tail = await ndb.getSegmentRows(hash, last);
+
+    assert.strictEqual(head.length, 1000);
+    assert.strictEqual(tail.length, 100);
+
+    for (let n = 0; n < 1100; n++) {
+      const row = n < 1000 ? head[n] : tail[n - 1000];
+      assert.strictEqual(row.tx_hash, rowOf(n));
+    }
+
+    let received = 0;
+
+    for (const row of tail) received += row.received;
+
+    assert.strictEqual(received, last.received);
+  });
+
+  it("should page history across a segment boundary", async () => {
+    const page = await ndb.addressHistoryPage(A, 95, 10);
+
+    assert.strictEqual(page.total, 1100);
+    assert.deepStrictEqual(
+      page.result.map(row => row.tx_hash),
+      [1004, 1003, 1002, 1001, 1000, 999, 998, 997, 996, 995].map(rowOf)
+    );
+
+    const newest = await ndb.addressHistoryPage(A, 0, 2);
+
+    assert.deepStrictEqual(newest.result, [
+      { tx_hash: rowOf(1099), height: 2 },
+      { tx_hash: rowOf(1098), height: 2 }
+    ]);
+
+    const start = await ndb.addressHistoryPage(A, 0, 2000, 2);
+
+    assert.strictEqual(start.total, 500);
+    assert.strictEqual(start.result[499].tx_hash, rowOf(600));
+  });
+
+  it("should sum segments for the balance at a height", async () => {
+    let received = 0;
+
+    for (let pos = 0; pos < 600; pos++) received += 1000 + pos;
+
+    const balance = await ndb.addressBalanceAt(A, 1);
+
+    assert.strictEqual(balance.received, received);
+    assert.strictEqual(balance.spent, 0);
+  });
+
+  it("should take disconnected rows off the last segments", async () => {
+    await disconnect(2);
+
+    const hash = A.getHash();
+    const segments = await ndb.getSegments(hash);
+
+    assert.deepStrictEqual(segments.map(seg => seg.count), [600]);
+
+    const page = await ndb.addressHistoryPage(A, 0, 1);
+
+    assert.strictEqual(page.total, 600);
+    assert.strictEqual(page.result[0].tx_hash, rowOf(599));
+
+    await connect(2);
+
+    const again = await ndb.getSegments(hash);
+
+    assert.deepStrictEqual(again.map(seg => seg.count), [1000, 100]);
+    assert.strictEqual(again[1].pos, 800);
+  });
+});
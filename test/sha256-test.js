@@ -0,0 +1,82 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const crypto = require("crypto");
+const bio = require("bufio");
+const SHA256 = require("../lib/sha256");
+
+// FIPS 180-2 examples.
+const vectors = [
+  ["", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"],
+  ["abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"],
+  [
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"
+  ]
+];
+
+function resume(ctx) {
+  const raw = ctx.write(bio.write(ctx.getSize())).render();
+  return new SHA256().read(bio.read(raw));
+}
+
+describe("SHA256", function() {
+  it("should match the test vectors", () => {
+    for (const [msg, expect] of vectors) {
+      const ctx = new SHA256().update(Buffer.from(msg, "ascii"));
+      assert.strictEqual(ctx.digest().toString("hex"), expect);
+    }
+
+    const ctx = new SHA256();
+    const chunk = Buffer.alloc(1000, "a");
+
+    for (let i = 0; i < 1000; i++) ctx.update(chunk);
+
+    assert.strictEqual(
+      ctx.digest().toString("hex"),
+      "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"
+    );
+  });
+
+  it("should keep hashing after a digest", () => {
+    const ctx = new SHA256().update(Buffer.from("ab", "ascii"));
+
+    ctx.digest();
+    ctx.update(Buffer.from("c", "ascii"));
+
+    assert.strictEqual(ctx.digest().toString("hex"), vectors[1][1]);
+  });
+
+  it("should resume from a saved midstate", () => {
+    const data = crypto.randomBytes(300);
+
+    for (let split = 0; split <= data.length; split += 7) {
+      const ctx = resume(new SHA256().update(data.slice(0, split)));
+
+      assert.strictEqual(ctx.getSize(), 41 + (split % 64));
+
+      ctx.update(data.slice(split));
+
+      assert.bufferEqual(
+        ctx.digest(),
+        crypto
+          .createHash("sha256")
+          .update(data)
+          .digest()
+      );
+    }
+  });
+
+  it("should refuse a corrupt midstate", () => {
+    const ctx = new SHA256().update(Buffer.alloc(10));
+    const raw = ctx.write(bio.write(ctx.getSize())).render();
+
+    // The tail length no longer matches the message length.
+    raw[40] = 11;
+
+    assert.throws(() => new SHA256().read(bio.read(raw)));
+  });
+});
@@ -0,0 +1,117 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const path = require("path");
+const fs = require("bfile");
+const NomenclateDB = require("../lib/nomenclatedb");
+const flags = require("../lib/flags");
+const { Client, tmpdir } = require("./util/common");
+
+describe("Shadow rebuilds", function() {
+  let dir, location, ndb;
+
+  function createDB() {
+    return new NomenclateDB({
+      network: "regtest",
+      memory: false,
+      location,
+      client: new Client(),
+      features: flags.ADDRESS,
+      addressFilter: false,
+      hotCacheSize: 0,
+      warmStart: false
+    });
+  }
+
+  async function setHeight(db, height) {
+    const b = db.batch();
+    db.putHeight(b, height);
+    await b.write();
+  }
+
+  async function listing() {
+    return (await fs.readdir(dir)).sort();
+  }
+
+  beforeEach(async () => {
+    dir = tmpdir();
+    location = path.join(dir, "nomenclate");
+
+    await fs.mkdirp(dir);
+
+    ndb = createDB();
+
+    await ndb.open();
+    await setHeight(ndb, 1);
+  });
+
+  afterEach(async () => {
+    await ndb.close();
+    await fs.rimraf(dir);
+  });
+
+  it("should serve a swapped shadow and promote it on open", async () => {
+    const shadow = await ndb.openShadow();
+
+    assert.strictEqual(shadow.location, location + ".shadow-1");
+
+    await setHeight(shadow, 2);
+    await ndb.swap(shadow);
+
+    // Served from the shadow's directory until the next open.
+    assert.strictEqual(ndb.height, 2);
+    assert.strictEqual(ndb.location, shadow.location);
+    assert.deepStrictEqual(await listing(), [
+      "nomenclate.current",
+      "nomenclate.shadow-1"
+    ]);
+
+    await ndb.close();
+
+    ndb = createDB();
+
+    await ndb.open();
+
+    assert.strictEqual(ndb.height, 2);
+    assert.strictEqual(ndb.location, location);
+    assert.deepStrictEqual(await listing(), ["nomenclate"]);
+  });
+
+  it("should give every shadow a directory of its own", async () => {
+    const first = await ndb.openShadow();
+
+    await setHeight(first, 2);
+    await ndb.swap(first);
+
+    // The next rebuild must not remove the index being served.
+    const second = await ndb.openShadow();
+
+    assert.notStrictEqual(second.location, first.location);
+    assert(await fs.exists(first.location));
+
+    await ndb.dropShadow(second);
+
+    assert(!(await fs.exists(second.location)));
+    assert.strictEqual(await ndb.getHeight(), 2);
+  });
+
+  it("should remove an unfinished rebuild on open", async () => {
+    const shadow = await ndb.openShadow();
+
+    await setHeight(shadow, 2);
+
+    // Stopped before the swap.
+    await shadow.close();
+    await ndb.close();
+
+    ndb = createDB();
+
+    await ndb.open();
+
+    assert.strictEqual(ndb.height, 1);
+    assert.deepStrictEqual(await listing(), ["nomenclate"]);
+  });
+});
@@ -0,0 +1,254 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const layout = require("../lib/layout");
+const ShardedDB = require("../lib/sharded");
+
+const HEIGHT = layout.H.encode();
+const SHARDS = 4;
+
+function addr(byte) {
+  return Buffer.alloc(20, byte);
+}
+
+function txid(byte) {
+  return Buffer.alloc(32, byte);
+}
+
+function u32(num) {
+  const data = Buffer.alloc(4);
+  data.writeUInt32LE(num, 0);
+  return data;
+}
+
+describe("ShardedDB", function() {
+  let db;
+
+  beforeEach(async () => {
+    db = new ShardedDB({ memory: true, location: "test", shards: SHARDS });
+    await db.open();
+  });
+
+  afterEach(async () => {
+    await db.close();
+  });
+
+  it("should route hash keyed rows by the first byte of the hash", () => {
+    for (const byte of [0x00, 0x01, 0x02, 0x03, 0x7e, 0xff]) {
+      const shard = byte % SHARDS;
+
+      assert.strictEqual(db.route(layout.a.encode(addr(byte))), shard);
+      assert.strictEqual(db.route(layout.r.min(addr(byte))), shard);
+      assert.strictEqual(db.route(layout.g.encode(addr(byte), 3)), shard);
+      assert.strictEqual(
+        db.route(layout.o.encode(addr(byte), 10, 0, txid(0xaa))),
+        shard
+      );
+      assert.strictEqual(
+        db.route(layout.u.encode(addr(byte), txid(0xaa), 1)),
+        shard
+      );
+      assert.strictEqual(db.route(layout.i.encode(txid(byte), 0)), shard);
+    }
+  });
+
+  it("should keep chain metadata on the first shard", () => {
+    assert.strictEqual(db.route(layout.V.encode()), 0);
+    assert.strictEqual(db.route(layout.O.encode()), 0);
+    assert.strictEqual(db.route(HEIGHT), 0);
+    assert.strictEqual(db.route(layout.h.encode(0xff030201)), 0);
+    assert.strictEqual(db.route(layout.P.encode()), 0);
+  });
+
+  it("should write each row to its shard only", async () => {
+    const b = db.batch();
+
+    for (let byte = 0; byte < 8; byte++)
+      b.put(layout.a.encode(addr(byte)), Buffer.from([byte]));
+
+    await b.write();
+
+    for (let byte = 0; byte < 8; byte++) {
+      const key = layout.a.encode(addr(byte));
+
+      for (let i = 0; i < SHARDS; i++) {
+        const value = await db.stores[i].get(key);
+
+        if (i === byte % SHARDS) assert.bufferEqual(value, Buffer.from([byte]));
+        else assert.strictEqual(value, null);
+      }
+
+      assert.bufferEqual(await db.get(key), Buffer.from([byte]));
+    }
+  });
+
+  it("should read the range of one hash from a single shard", () => {
+    const gte = layout.r.min(addr(0x06));
+    const lte = layout.r.max(addr(0x06));
+
+    assert.strictEqual(db.routeRange(gte, lte), 0x06 % SHARDS);
+    assert.strictEqual(db.routeRange(layout.a.min(), layout.a.max()), -1);
+  });
+
+  it("should merge ranges across shards in key order", async () => {
+    const b = db.batch();
+    const keys = [];
+
+    for (const byte of [0x09, 0x02, 0x07, 0x00, 0x05, 0x03]) {
+      const key = layout.a.encode(addr(byte));
+      keys.push(key);
+      b.put(key, Buffer.from([byte]));
+    }
+
+    await b.write();
+
+    keys.sort(Buffer.compare);
+
+    const iter = db.iterator({
+      gte: layout.a.min(),
+      lte: layout.a.max(),
+      values: true
+    });
+
+    const found = [];
+
+    await iter.each((key, value) => {
+      // Keys hold the length of the hash, then the hash.
+      assert.strictEqual(value[0], key[2]);
+      found.push(key);
+    });
+
+    assert.deepStrictEqual(found, keys);
+
+    const reverse = db.iterator({
+      gte: layout.a.min(),
+      lte: layout.a.max(),
+      reverse: true
+    });
+
+    const back = [];
+
+    await reverse.each(key => back.push(key));
+
+    assert.deepStrictEqual(back, keys.slice().reverse());
+  });
+
+  it("should apply a limit across shards", async () => {
+    const b = db.batch();
+
+    for (let byte = 0; byte < 8; byte++)
+      b.put(layout.a.encode(addr(byte)), Buffer.from([byte]));
+
+    await b.write();
+
+    const iter = db.iterator({
+      gte: layout.a.min(),
+      lte: layout.a.max(),
+      limit: 3
+    });
+
+    const found = [];
+
+    await iter.each(key => found.push(key[2]));
+
+    assert.deepStrictEqual(found, [0, 1, 2]);
+  });
+
+  it("should write the height to every shard with a block", async () => {
+    const b = db.batch();
+
+    b.put(layout.a.encode(addr(0x01)), Buffer.from([1]));
+    b.put(HEIGHT, u32(3));
+
+    // Not visible until every shard has it.
+    assert.strictEqual(db.height, 0);
+
+    await b.write();
+
+    assert.strictEqual(db.height, 3);
+
+    for (const store of db.stores)
+      assert.bufferEqual(await store.get(HEIGHT), u32(3));
+  });
+
+  it("should take the lowest height of any shard as committed", async () => {
+    const b = db.batch();
+
+    b.put(HEIGHT, u32(9));
+
+    await b.write();
+
+    // A crash after some shards committed the next block.
+    await db.stores[2].put(HEIGHT, u32(10));
+    await db.stores[3].put(HEIGHT, u32(10));
+
+    assert.bufferEqual(await db.get(HEIGHT), u32(9));
+
+    // A shard which never committed a block.
+    await db.stores[1].del(HEIGHT);
+
+    assert.strictEqual(await db.get(HEIGHT), null);
+  });
+
+  it("should undo a block on the shards which have it only", async () => {
+    const header = Buffer.alloc(8, 0x0a);
+    const b = db.batch();
+
+    b.put(layout.a.encode(addr(0x01)), Buffer.from([1]));
+    b.put(HEIGHT, u32(9));
+
+    await b.write();
+
+    // A crash after shard 2 committed block 10.
+    const tip = Buffer.concat([u32(10), header]);
+
+    await db.stores[2].put(layout.a.encode(addr(0x02)), Buffer.from([2]));
+    await db.stores[2].put(layout.T.encode(), tip);
+    await db.stores[2].put(HEIGHT, u32(10));
+
+    // As read on open.
+    db.heights[2] = 10;
+
+    assert.strictEqual(db.height, 9);
+    assert.strictEqual(db.getTop(), 10);
+    assert.bufferEqual(await db.getHeaderAhead(10), header);
+
+    const undo = db.rollbackBatch(10);
+
+    undo.del(layout.a.encode(addr(0x01)));
+    undo.del(layout.a.encode(addr(0x02)));
+    undo.put(HEIGHT, u32(9));
+
+    await undo.write();
+
+    assert.strictEqual(db.getTop(), 9);
+    assert.strictEqual(await db.get(layout.a.encode(addr(0x02))), null);
+    assert.bufferEqual(
+      await db.get(layout.a.encode(addr(0x01))),
+      Buffer.from([1])
+    );
+
+    for (const store of db.stores)
+      assert.bufferEqual(await store.get(HEIGHT), u32(9));
+  });
+
+  it("should record the header of each block on every shard", async () => {
+    const header = Buffer.alloc(8, 0x0b);
+    const b = db.batch();
+
+    b.put(layout.h.encode(4), header);
+    b.put(HEIGHT, u32(4));
+
+    await b.write();
+
+    for (const store of db.stores) {
+      assert.bufferEqual(
+        await store.get(layout.T.encode()),
+        Buffer.concat([u32(4), header])
+      );
+    }
+  });
+});
@@ -0,0 +1,173 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const path = require("path");
+const fs = require("bfile");
+const { Address, Network } = require("hsd");
+const NomenclateDB = require("../lib/nomenclatedb");
+const Indexer = require("../lib/indexer");
+const layout = require("../lib/layout");
+const flags = require("../lib/flags");
+const snapshot = require("../lib/snapshot");
+const { Client, tmpdir, txid, makeTX, makeEntry } = require("./util/common");
+
+const A = Address.fromHash(Buffer.alloc(20, 0x0a), 0);
+const B = Address.fromHash(Buffer.alloc(20, 0x0b), 0);
+
+const BLOCKS = [
+  { txs: [] },
+  { txs: [makeTX(txid(0x11), [], [[A, 5000]])] },
+  { txs: [makeTX(txid(0x22), [[txid(0x11), 0]], [[B, 3000], [A, 1999]])] }
+];
+
+// Offset of the first chunk's checksum.
+const CHECKSUM = 9 + 12;
+
+/**
+ * Entry Client
+ * Answers entry lookups with the entries of the blocks above.
+ */
+
+class EntryClient extends Client {
+  async getEntry(height) {
+    if (height >= BLOCKS.length) return null;
+    return makeEntry(height);
+  }
+}
+
+function createDB(client) {
+  return new NomenclateDB({
+    network: "regtest",
+    memory: true,
+    location: "test",
+    client,
+    features: flags.ADDRESS | flags.SPEND,
+    addressFilter: false,
+    hotCacheSize: 0,
+    warmStart: false
+  });
+}
+
+async function rows(ndb) {
+  const result = [];
+
+  await ndb.db.iterator({ values: true }).each((key, value) => {
+    result.push([key.toString("hex"), value.toString("hex")]);
+  });
+
+  return result;
+}
+
+describe("Snapshots", function() {
+  const network = Network.get("regtest");
+
+  let location, file, client, source, target;
+
+  beforeEach(async () => {
+    location = tmpdir();
+    file = path.join(location, "index.snapshot");
+    client = new EntryClient();
+    source = createDB(client);
+    target = createDB(client);
+
+    await fs.mkdirp(location);
+    await source.open();
+    await source.verifyNetwork();
+    await target.open();
+
+    const indexer = new Indexer({ network: "regtest", client, ndb: source });
+
+    for (let height = 1; height < BLOCKS.length; height++)
+      await indexer._indexBlock(makeEntry(height), BLOCKS[height], null);
+  });
+
+  afterEach(async () => {
+    await source.close();
+    await target.close();
+    await fs.rimraf(location);
+  });
+
+  it("should import every row of an exported index", async () => {
+    let opened = false;
+
+    const result = await source.exportSnapshot(file, () => {
+      opened = true;
+    });
+
+    assert(opened);
+    assert.strictEqual(result.height, 2);
+
+    const info = await target.readSnapshot(file);
+
+    assert.strictEqual(info.height, 2);
+    assert.strictEqual(info.rows, result.rows);
+    assert.bufferEqual(info.hash, makeEntry(2).hash);
+
+    await target.importSnapshot(file, info);
+
+    assert.strictEqual(target.height, 2);
+    assert.deepStrictEqual(await rows(target), await rows(source));
+    assert.deepStrictEqual(
+      await target.addressHistory(A),
+      await source.addressHistory(A)
+    );
+  });
+
+  it("should refuse a snapshot of another chain", async () => {
+    const indexer = new Indexer({ network: "regtest", client, ndb: target });
+
+    await source.exportSnapshot(file, null);
+
+    client.getEntry = async height => makeEntry(height, 1);
+
+    await assert.rejects(indexer.importSnapshot(file), /not in the main chain/);
+
+    assert.strictEqual(await target.db.get(layout.H.encode()), null);
+  });
+
+  it("should refuse a snapshot of another network", async () => {
+    await source.exportSnapshot(file, null);
+
+    await assert.rejects(
+      snapshot.readInfo(file, Network.get("main")),
+      /Network mismatch/
+    );
+  });
+
+  it("should leave no height behind after a bad chunk", async () => {
+    await source.exportSnapshot(file, null);
+
+    const info = await snapshot.readInfo(file, network);
+    const data = await fs.readFile(file);
+
+    data[CHECKSUM] ^= 1;
+
+    await fs.writeFile(file, data);
+
+    await assert.rejects(target.importSnapshot(file, info), /checksum/);
+
+    assert.strictEqual(await target.db.get(layout.H.encode()), null);
+    assert.strictEqual(target.height, 0);
+  });
+
+  it("should refuse a truncated snapshot", async () => {
+    await source.exportSnapshot(file, null);
+
+    const data = await fs.readFile(file);
+
+    await fs.writeFile(file, data.slice(0, data.length - 1));
+
+    await assert.rejects(snapshot.readInfo(file, network), /Truncated/);
+  });
+
+  it("should not import into an index which has a height", async () => {
+    await source.exportSnapshot(file, null);
+
+    const info = await source.readSnapshot(file);
+
+    await assert.rejects(source.importSnapshot(file, info), /non-empty/);
+  });
+});
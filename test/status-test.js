@@ -0,0 +1,137 @@
+/* eslint-env mocha */
+/* eslint prefer-arrow-callback: "off" */
+
+"use strict";
+
+const assert = require("bsert");
+const crypto = require("crypto");
+const { Address } = require("hsd");
+const NomenclateDB = require("../lib/nomenclatedb");
+const Indexer = require("../lib/indexer");
+const layout = require("../lib/layout");
+const flags = require("../lib/flags");
+const { Client, txid, makeTX, makeEntry } = require("./util/common");
+
+const A = Address.fromHash(Buffer.alloc(20, 0x0a), 0);
+const B = Address.fromHash(Buffer.alloc(20, 0x0b), 0);
+
+// Block 2 spends A's coin from block 1 to B with change
+// back to A, so A has a funding and a spend row for one
+// transaction. Block 2 salted 1 is a competing block.
+function block(height, salt = 0) {
+  if (height === 1) return { txs: [makeTX(txid(0x11), [], [[A, 5000]])] };
+
+  if (salt === 1) return { txs: [makeTX(txid(0x31), [], [[A, 42]])] };
+
+  return {
+    txs: [
+      makeTX(txid(0x21), [], [[B, 1]]),
+      makeTX(txid(0x22), [[txid(0x11), 0]], [[B, 3000], [A, 1999]]),
+      makeTX(txid(0x23), [], [[A, 700]])
+    ]
+  };
+}
+
+// The status as Electrum defines it, from the history oldest first.
+function electrum(history) {
+  const ctx = crypto.createHash("sha256");
+
+  for (const [hash, height] of history)
+    ctx.update(hash.toString("hex") + ":" + height + ":", "ascii");
+
+  return ctx.digest("hex");
+}
+
+describe("Address status", function() {
+  let ndb, indexer;
+
+  async function connect(height, salt = 0) {
+    await indexer._indexBlock(makeEntry(height, salt), block(height, salt));
+  }
+
+  async function disconnect(height, salt = 0) {
+    await indexer._unindexBlock(makeEntry(height, salt), block(height, salt));
+  }
+
+  async function undoRows(height) {
+    let count = 0;
+
+    await ndb.db
+      .iterator({ gte: layout.E.min(height), lte: layout.E.max(height) })
+      .each(() => {
+        count += 1;
+      });
+
+    return count;
+  }
+
+  beforeEach(async () => {
+    const client = new Client();
+
+    ndb = new NomenclateDB({
+      network: "regtest",
+      memory: true,
+      location: "test",
+      client,
+      features: flags.ADDRESS,
+      addressFilter: false,
+      hotCacheSize: 0,
+      warmStart: false
+    });
+
+    indexer = new Indexer({ network: "regtest", client, ndb });
+
+    await ndb.open();
+    await connect(1);
+    await connect(2);
+  });
+
+  afterEach(async () => {
+    await ndb.close();
+  });
+
+  it("should match the Electrum status of the merged history", async () => {
+    assert(ndb.hasStatus());
+
+    assert.strictEqual(
+      await ndb.addressStatus(A),
+      electrum([[txid(0x11), 1], [txid(0x22), 2], [txid(0x23), 2]])
+    );
+
+    assert.strictEqual(
+      await ndb.addressStatus(B),
+      electrum([[txid(0x21), 2], [txid(0x22), 2]])
+    );
+
+    // The same as hashing the history rows again.
+    const status = await ndb.computeStatus(A.getHash(), 2);
+
+    assert.strictEqual(
+      status.ctx.digest().toString("hex"),
+      await ndb.addressStatus(A)
+    );
+  });
+
+  it("should restore statuses from undo rows on a reorg", async () => {
+    assert.strictEqual(await undoRows(2), 2);
+
+    await disconnect(2);
+
+    assert.strictEqual(await undoRows(2), 0);
+    assert.strictEqual(await ndb.addressStatus(A), electrum([[txid(0x11), 1]]));
+    assert.strictEqual(await ndb.addressStatus(B), null);
+
+    await connect(2, 1);
+
+    assert.strictEqual(
+      await ndb.addressStatus(A),
+      electrum([[txid(0x11), 1], [txid(0x31), 2]])
+    );
+  });
+
+  it("should refuse to hash statuses again once pruned", async () => {
+    ndb.pruneHeight = 2;
+
+    await assert.rejects(ndb.computeStatus(A.getHash(), 2), /pruned/);
+  });
+});
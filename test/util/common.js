@@ -0,0 +1,147 @@
+/*!
+ * common.js - shared test helpers for nomenclate
+ * Copyright (c) 2018-2019, Handshake Alliance Developers (MIT License).
+ * https://github.com/handshakealliance/nomenclate
+ */
+
+"use strict";
+
+const os = require("os");
+const path = require("path");
+const EventEmitter = require("events");
+const { Headers } = require("hsd");
+
+/**
+ * Client
+ * Stands in for the chain client of a NomenclateDB or an
+ * indexer which is fed blocks directly by the test.
+ */
+
+class Client extends EventEmitter {
+  constructor() {
+    super();
+    this.tip = { height: 0 };
+  }
+
+  getTip() {
+    return this.tip;
+  }
+
+  bind(type, handler) {
+    return this.on(type, handler);
+  }
+
+  async getMempoolTXs() {
+    return [];
+  }
+}
+
+/**
+ * Fake DB
+ * The part of a NomenclateDB every server reads. Tests
+ * extend it with only what the tested methods read.
+ */
+
+class FakeDB {
+  constructor(height = 0) {
+    this.height = height;
+    this.pruneHeight = 0;
+    this.indexes = new Set(["address"]);
+  }
+
+  get pruned() {
+    return this.pruneHeight > 0;
+  }
+
+  hasIndex(...names) {
+    return names.every(name => this.indexes.has(name));
+  }
+
+  touch() {}
+
+  isUnknown() {
+    return false;
+  }
+}
+
+/**
+ * Get a fresh directory name under the system temp directory.
+ * @returns {String}
+ */
+
+function tmpdir() {
+  const name = "nomenclate-test-" + process.pid + "-" + Date.now();
+  return path.join(os.tmpdir(), name + "-" + Math.random().toString(36));
+}
+
+/**
+ * Get a txid made of one repeated byte.
+ * @param {Number} byte
+ * @returns {Buffer}
+ */
+
+function txid(byte) {
+  return Buffer.alloc(32, byte);
+}
+
+/**
+ * Make just enough of a transaction for the indexer. Inputs
+ * spend `[txid, index]` pairs (none for a coinbase), outputs
+ * pay `[address, value]` pairs.
+ * @param {Buffer} hash
+ * @param {Array[]} inputs
+ * @param {Array[]} outputs
+ * @returns {Object}
+ */
+
+function makeTX(hash, inputs, outputs) {
+  const coinbase = inputs.length === 0;
+
+  return {
+    txid: () => hash.toString("hex"),
+    inputs: coinbase
+      ? [{ isCoinbase: () => true }]
+      : inputs.map(([prev, index]) => ({
+          isCoinbase: () => false,
+          prevout: { txid: () => prev.toString("hex"), index }
+        })),
+    outputs: outputs.map(([address, value]) => ({
+      address,
+      value,
+      covenant: { isName: () => false }
+    }))
+  };
+}
+
+/**
+ * Make a chain entry with a real header, so its hash is
+ * the one read back from the header rows. Entries at the
+ * same height with another `salt` are competing blocks.
+ * @param {Number} height
+ * @param {Number} [salt=0]
+ * @returns {Object}
+ */
+
+function makeEntry(height, salt = 0) {
+  const headers = new Headers();
+
+  headers.time = height;
+  headers.nonce = salt;
+
+  return {
+    height,
+    hash: headers.hash(),
+    toHeaders: () => headers
+  };
+}
+
+/*
+ * Expose
+ */
+
+exports.Client = Client;
+exports.FakeDB = FakeDB;
+exports.tmpdir = tmpdir;
+exports.txid = txid;
+exports.makeTX = makeTX;
+exports.makeEntry = makeEntry;